@@ -35,6 +35,14 @@ function check_project_struct {
   find_file_or_dir_in_project ${PROJECT_PATH} log_output
 }
 
+# build the program, so the tests never run a stale binary
+function build_project {
+  if ! make -C ${PROJECT_PATH}/src > /dev/null; then
+    echo -e "[${color_red}FAIL${color_norm}]: building ${PROJECT_PATH}/src failed"
+    exit 1
+  fi
+}
+
 # setup testing output folder
 function setup_testing_input_output {
   TEST_OUTPUT_PATH=${GRADER_ROOT}/temp
@@ -51,25 +59,42 @@ function setup_testing_input_output {
 
   rm -r ${TEST_OUTPUT_PATH}/log_input/*
   rm -r ${TEST_OUTPUT_PATH}/log_output/*
-  cp -r ${GRADER_ROOT}/tests/${test_folder}/log_input/batch_log.json ${TEST_OUTPUT_PATH}/log_input/batch_log.json
-  cp -r ${GRADER_ROOT}/tests/${test_folder}/log_input/stream_log.json ${TEST_OUTPUT_PATH}/log_input/stream_log.json
+  cp -r ${GRADER_ROOT}/tests/${test_folder}/log_input/* ${TEST_OUTPUT_PATH}/log_input/
+}
+
+# run the test: once without options, or once for every line of the test's
+# options file (e.g. a run writing a snapshot, then a run resuming from it)
+function run_test {
+  cd ${GRADER_ROOT}/temp
+  if [ -f ../tests/${test_folder}/options ]; then
+    while read -r options; do
+      bash run.sh ${options} 2>&1 < /dev/null
+    done < ../tests/${test_folder}/options
+  else
+    bash run.sh 2>&1
+  fi
+  cd ../
 }
 
+# compare every file of the test's log_output (flagged_purchases.json, and
+# e.g. the late events of a test for --late-log)
 function compare_outputs {
-  PROJECT_ANSWER_PATH1=${GRADER_ROOT}/temp/log_output/flagged_purchases.json
-  TEST_ANSWER_PATH1=${GRADER_ROOT}/tests/${test_folder}/log_output/flagged_purchases.json
-  
+  local passed=1
+  for TEST_ANSWER_PATH1 in ${GRADER_ROOT}/tests/${test_folder}/log_output/*; do
+    PROJECT_ANSWER_PATH1=${GRADER_ROOT}/temp/log_output/$(basename ${TEST_ANSWER_PATH1})
+    DIFF_RESULT1=$(diff -wubB ${PROJECT_ANSWER_PATH1} ${TEST_ANSWER_PATH1} 2>&1 | wc -l)
+    if [ "${DIFF_RESULT1}" -ne "0" ] || [ ! -f ${PROJECT_ANSWER_PATH1} ]; then
+      passed=0
+      diff -wubB ${PROJECT_ANSWER_PATH1} ${TEST_ANSWER_PATH1}
+    fi
+  done
 
-  DIFF_RESULT1=$(diff -wubB ${PROJECT_ANSWER_PATH1} ${TEST_ANSWER_PATH1} | wc -l)
-  if [ "${DIFF_RESULT1}" -eq "0" ] && [ -f ${PROJECT_ANSWER_PATH1} ]; then
+  if [ "${passed}" -eq "1" ]; then
     echo -e "[${color_green}PASS${color_norm}]: ${test_folder}"
     PASS_CNT=$(($PASS_CNT+1))
   else
     echo -e "[${color_red}FAIL${color_norm}]: ${test_folder}"
-    diff -wubB ${PROJECT_ANSWER_PATH1} ${TEST_ANSWER_PATH1}
   fi
-
- 
 }
 
 function run_all_tests {
@@ -82,9 +107,7 @@ function run_all_tests {
 
     setup_testing_input_output
 
-    cd ${GRADER_ROOT}/temp
-    bash run.sh 2>&1
-    cd ../
+    run_test
 
     compare_outputs
   done
@@ -94,4 +117,5 @@ function run_all_tests {
 }
 
 check_project_struct
+build_project
 run_all_tests
@@ -1,5 +1,5 @@
 #!/bin/bash
 
 
-./src/anomaly_detection ./log_input/batch_log.json ./log_input/stream_log.json ./log_output/flagged_purchases.json
+./src/anomaly_detection "$@" ./log_input/batch_log.json ./log_input/stream_log.json ./log_output/flagged_purchases.json
 
@@ -0,0 +1,172 @@
+/*
+ * bench_event_parsing.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ *
+ * measures how fast the events of a log are read into event structs, with
+ * nothing else done to them: the lines of a json log parsed with rapidjson and
+ * read_event (--no-scanner), the same lines read by the event scanner, read
+ * in the fixed layout first (--trusted-input), and the records of the same
+ * log converted by convert_event_log (a mapped binary_event_log). This is the
+ * ceiling of the engine's events/sec for each input path. Before timing,
+ * every line the scanner or the fixed layout reads is checked against
+ * rapidjson.
+ *
+ * usage: bench_event_parsing log.json log.bin [rounds]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include "../binary_event_log.h"
+#include "../event.h"
+#include "../event_scanner.h"
+
+using namespace std;
+using namespace rapidjson;
+
+// sum of the fields read, so that the reading is not optimized away
+static uint64_t checksum = 0;
+
+// function to read the events of a json log
+// inputs: fname - name of the log
+//         use_scanner - true to read the lines with the event scanner when they allow
+//         trusted - true to read the lines in the trusted layout first
+// return: the number of events
+size_t read_json_log(const char* fname, const bool use_scanner, const bool trusted) {
+  ifstream in(fname);
+  size_t events = 0;
+  size_t D, T;
+  event e;
+  for (string line; getline(in, line);) {
+    if (line.empty())
+      continue;
+    const scan_result scanned = use_scanner ?
+        scan_event_line(line, e, D, T, trusted) : scan_result::fallback;
+    if (scanned == scan_result::parameters)
+      continue;
+    if (scanned == scan_result::fallback) {
+      Document doc;
+      doc.Parse(line.c_str());
+      if (!doc.IsObject() || !doc.HasMember("event_type") || !read_event(doc, e))
+        continue;
+    }
+    e.line = std::move(line);
+    checksum += e.time + e.id1 + e.id2;
+    ++events;
+  }
+  return events;
+}
+
+// function to compare the events read by the scanner with those of rapidjson
+// inputs: fname - name of the log
+//         trusted - true to check the lines read in the trusted layout instead
+// output: scanned_lines - reference to the number of lines read
+// return: the number of lines read differently
+size_t check_scanner(const char* fname, const bool trusted, size_t& scanned_lines) {
+  ifstream in(fname);
+  size_t mismatches = 0;
+  size_t D, T;
+  event scanned, parsed;
+  for (string line; getline(in, line);) {
+    if (trusted ? !scan_trusted_event_line(line, scanned)
+        : scan_event_line(line, scanned, D, T) != scan_result::event)
+      continue;
+    ++scanned_lines;
+    Document doc;
+    doc.Parse(line.c_str());
+    if (!doc.IsObject() || !doc.HasMember("event_type") || !read_event(doc, parsed)
+        || scanned.kind != parsed.kind || scanned.time != parsed.time
+        || scanned.timestamp != parsed.timestamp || scanned.id1 != parsed.id1
+        || scanned.id2 != parsed.id2 || scanned.amount != parsed.amount)
+      ++mismatches;
+  }
+  return mismatches;
+}
+
+// function to read the events of a binary log
+// input:  fname - name of the log
+// return: the number of events
+size_t read_binary_log(const char* fname) {
+  binary_event_log in;
+  if (!in.open(fname, 0))
+    return 0;
+  size_t events = 0;
+  binary_record r;
+  event e;
+  while (in.read(r)) {
+    if (r.type == binary_record_type::parameters)
+      continue;
+    binary_record_to_event(r, e);
+    checksum += e.time + e.id1 + e.id2;
+    ++events;
+  }
+  return events;
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " log.json log.bin [rounds]" << endl;
+    return EXIT_FAILURE;
+  }
+  const size_t rounds = argc > 3 ? max<size_t>(strtoull(argv[3], nullptr, 10), 1) : 3;
+
+  size_t scanned_lines = 0, trusted_lines = 0;
+  const size_t scanner_mismatches = check_scanner(argv[1], false, scanned_lines);
+  if (scanner_mismatches > 0)
+    cerr << "Error: the scanner read " << scanner_mismatches << " lines differently" << endl;
+  const size_t trusted_mismatches = check_scanner(argv[1], true, trusted_lines);
+  if (trusted_mismatches > 0)
+    cerr << "Error: the trusted layout read " << trusted_mismatches << " lines differently"
+        << endl;
+  const size_t mismatches = scanner_mismatches + trusted_mismatches;
+
+  // the best of several rounds, with the files in the page cache
+  double json_seconds = 1e9, scanner_seconds = 1e9, trusted_seconds = 1e9;
+  double binary_seconds = 1e9;
+  size_t json_events = 0, scanner_events = 0, trusted_events = 0, binary_events = 0;
+  for (size_t i = 0; i < rounds; ++i) {
+    auto start = chrono::steady_clock::now();
+    json_events = read_json_log(argv[1], false, false);
+    json_seconds = min(json_seconds,
+        chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+    start = chrono::steady_clock::now();
+    scanner_events = read_json_log(argv[1], true, false);
+    scanner_seconds = min(scanner_seconds,
+        chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+    start = chrono::steady_clock::now();
+    trusted_events = read_json_log(argv[1], true, true);
+    trusted_seconds = min(trusted_seconds,
+        chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+    start = chrono::steady_clock::now();
+    binary_events = read_binary_log(argv[2]);
+    binary_seconds = min(binary_seconds,
+        chrono::duration<double>(chrono::steady_clock::now() - start).count());
+  }
+  if (json_events != scanner_events || json_events != trusted_events
+      || json_events != binary_events)
+    cerr << "Warning: the logs hold different events" << endl;
+
+  cout << fixed << setprecision(0)
+      << "rapidjson: " << json_events << " events, " << json_events / json_seconds
+      << " events/s\n"
+      << "scanner:   " << scanner_events << " events, " << scanner_events / scanner_seconds
+      << " events/s (" << event_scanner_variant() << ", " << scanned_lines
+      << " lines scanned)\n"
+      << "trusted:   " << trusted_events << " events, " << trusted_events / trusted_seconds
+      << " events/s (" << trusted_lines << " lines in the fixed layout)\n"
+      << "binary:    " << binary_events << " events, " << binary_events / binary_seconds
+      << " events/s\n" << setprecision(1)
+      << "speedup over rapidjson: scanner " << json_seconds / scanner_seconds
+      << "x, trusted " << json_seconds / trusted_seconds << "x (over the scanner "
+      << scanner_seconds / trusted_seconds << "x), binary " << json_seconds / binary_seconds << "x (checksum "
+      << checksum % 1000 << ")\n";
+  return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
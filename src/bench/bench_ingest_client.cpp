@@ -0,0 +1,217 @@
+/*
+ * bench_ingest_client.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ *
+ * load generator for the ingest server (anomaly_detection --listen=...):
+ * sends the lines of a stream log, repeated as needed, over one or more
+ * connections, keeping at most a window of unacknowledged events per
+ * connection, and reports the sustained events/sec and the latency from
+ * writing an event to receiving the ack of its batch
+ *
+ * usage: bench_ingest_client unix:PATH|tcp:PORT stream_log.json [events]
+ *                            [window] [connections]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+using namespace std;
+
+// the result of one connection
+struct client_result {
+  vector<double> latencies;
+  size_t flagged = 0;
+  bool ok = false;
+};
+
+// function to connect to the server
+// input:  address - unix:PATH or tcp:PORT
+// return: the socket, or -1
+int connect_to(const string& address) {
+  if (!address.compare(0, 5, "unix:")) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, address.c_str() + 5, sizeof(addr.sun_path) - 1);
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0)
+      return fd;
+    if (fd >= 0)
+      close(fd);
+  } else if (!address.compare(0, 4, "tcp:")) {
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(atoi(address.c_str() + 4));
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd >= 0 && connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0)
+      return fd;
+    if (fd >= 0)
+      close(fd);
+  }
+  return -1;
+}
+
+// function to send events on a connection and collect their acks
+// inputs:  address - the server
+//          lines - the lines to send (repeated)
+//          n_events - the number of events to send
+//          window - the maximum number of unacknowledged events
+// output:  result - reference to the latencies and counters
+void run_client(const string& address, const vector<string>& lines,
+    const size_t n_events, const size_t window, client_result& result) {
+  const int fd = connect_to(address);
+  if (fd < 0) {
+    cerr << "Error: cannot connect to " << address << ": " << strerror(errno) << endl;
+    return;
+  }
+
+  vector<chrono::steady_clock::time_point> send_times(n_events);
+  size_t sent = 0, acked = 0;
+  string out, in;
+  // the index of the event ending at each byte offset of out
+  vector<pair<size_t, size_t>> line_ends;
+  size_t out_position = 0;
+  char buffer[1 << 16];
+  result.latencies.reserve(n_events);
+
+  while (acked < n_events) {
+    // fill the window
+    while (sent < n_events && sent - acked < window && out.size() - out_position < (1 << 16)) {
+      out += lines[sent % lines.size()];
+      out += '\n';
+      line_ends.emplace_back(out.size(), sent);
+      ++sent;
+    }
+
+    struct pollfd pfd = {fd, POLLIN, 0};
+    if (out_position < out.size())
+      pfd.events |= POLLOUT;
+    if (poll(&pfd, 1, -1) < 0 && errno != EINTR)
+      break;
+
+    if (pfd.revents & POLLOUT) {
+      const ssize_t n = send(fd, out.data() + out_position, out.size() - out_position,
+          MSG_DONTWAIT | MSG_NOSIGNAL);
+      if (n < 0 && errno != EAGAIN)
+        break;
+      if (n > 0) {
+        out_position += n;
+        const auto now = chrono::steady_clock::now();
+        size_t i = 0;
+        for (; i < line_ends.size() && line_ends[i].first <= out_position; ++i)
+          send_times[line_ends[i].second] = now;
+        line_ends.erase(line_ends.begin(), line_ends.begin() + i);
+        if (out_position == out.size()) {
+          out.clear();
+          out_position = 0;
+          line_ends.clear();
+        }
+      }
+    }
+
+    if (pfd.revents & (POLLIN | POLLHUP)) {
+      const ssize_t n = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+      if (n == 0 || (n < 0 && errno != EAGAIN))
+        break;
+      if (n > 0) {
+        in.append(buffer, n);
+        const auto now = chrono::steady_clock::now();
+        size_t start = 0;
+        for (size_t newline; (newline = in.find('\n', start)) != string::npos;
+            start = newline + 1) {
+          if (!in.compare(start, 8, "{\"ack\": ")) {
+            // the ack covers the next N events in order
+            const size_t n_acked = strtoull(in.c_str() + start + 8, nullptr, 10);
+            for (size_t i = 0; i < n_acked && acked < n_events; ++i, ++acked) {
+              result.latencies.push_back(
+                  chrono::duration<double>(now - send_times[acked]).count());
+            }
+          } else {
+            ++result.flagged;
+          }
+        }
+        in.erase(0, start);
+      }
+    }
+  }
+  result.ok = acked == n_events;
+  close(fd);
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " unix:PATH|tcp:PORT stream_log.json [events]"
+        " [window] [connections]" << endl;
+    return EXIT_FAILURE;
+  }
+  const string address = argv[1];
+  const size_t n_events = argc > 3 ? strtoull(argv[3], nullptr, 10) : 100000;
+  const size_t window = argc > 4 ? strtoull(argv[4], nullptr, 10) : 1000;
+  const size_t n_connections = argc > 5 ? max<size_t>(strtoull(argv[5], nullptr, 10), 1) : 1;
+
+  vector<string> lines;
+  ifstream in(argv[2]);
+  for (string line; getline(in, line);) {
+    if (!line.empty())
+      lines.push_back(line);
+  }
+  if (lines.empty()) {
+    cerr << "Error: no events in " << argv[2] << endl;
+    return EXIT_FAILURE;
+  }
+
+  vector<client_result> results(n_connections);
+  vector<thread> clients;
+  const auto start = chrono::steady_clock::now();
+  for (size_t i = 0; i < n_connections; ++i) {
+    clients.emplace_back(run_client, address, cref(lines),
+        n_events / n_connections + (i < n_events % n_connections ? 1 : 0),
+        window, ref(results[i]));
+  }
+  for (thread& client : clients)
+    client.join();
+  const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  vector<double> latencies;
+  size_t flagged = 0;
+  bool ok = true;
+  for (const client_result& result : results) {
+    latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+    flagged += result.flagged;
+    ok &= result.ok;
+  }
+  if (latencies.empty()) {
+    cerr << "Error: no events were acknowledged" << endl;
+    return EXIT_FAILURE;
+  }
+  sort(latencies.begin(), latencies.end());
+
+  cout << "connections " << n_connections << ", window " << window << "\n"
+      << "acked events " << latencies.size() << " in " << fixed << setprecision(3)
+      << seconds << " s: " << setprecision(0) << latencies.size() / seconds
+      << " events/s\n"
+      << "ack latency us: p50 " << latencies[latencies.size() / 2] * 1e6
+      << ", p99 " << latencies[latencies.size() * 99 / 100] * 1e6
+      << ", max " << latencies.back() * 1e6 << "\n"
+      << "flagged purchases received " << flagged << "\n";
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
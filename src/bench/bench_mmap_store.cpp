@@ -0,0 +1,120 @@
+/*
+ * bench_mmap_store.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ *
+ * out-of-core benchmark of the memory-mapped user store: writes a synthetic
+ * graph directly to the files (the users are never held in memory), then
+ * scores skewed queries and reports queries/sec, page faults and resident
+ * memory. Choose the number of users so the files are 2x or 4x the RAM of the
+ * machine, e.g. with degree 20 and T 50 a user takes about 1.4 KB of files.
+ *
+ * usage: bench_mmap_store [users] [degree] [T] [D] [queries] [path prefix]
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <sys/resource.h>
+#include "../mmap_store.h"
+
+using namespace std;
+
+// users are grouped into communities, so most friends have nearby ids
+static const size_t community_size = 1000;
+
+// function to print the page faults and resident memory so far
+void print_usage_line(const string& label, const double seconds, const size_t count) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  cout << setw(8) << label << setw(12) << fixed << setprecision(3) << seconds
+      << setw(14) << setprecision(0) << count / seconds
+      << setw(14) << usage.ru_majflt << setw(14) << usage.ru_minflt
+      << setw(14) << usage.ru_maxrss << "\n";
+}
+
+int main(int argc, char** argv) {
+  const size_t n_users = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+  const size_t degree = argc > 2 ? strtoull(argv[2], nullptr, 10) : 20;
+  const size_t T = argc > 3 ? strtoull(argv[3], nullptr, 10) : 50;
+  const size_t D = argc > 4 ? strtoull(argv[4], nullptr, 10) : 2;
+  const size_t n_queries = argc > 5 ? strtoull(argv[5], nullptr, 10) : 10000;
+  const string prefix = argc > 6 ? argv[6] : "/tmp/bench_mmap_" + to_string(getpid());
+
+  cout << "users " << n_users << ", degree " << degree << ", T " << T
+      << ", D " << D << ", queries " << n_queries << "\n";
+  cout << setw(8) << "phase" << setw(12) << "seconds" << setw(14) << "per sec"
+      << setw(14) << "major faults" << setw(14) << "minor faults"
+      << setw(14) << "max RSS KB" << "\n";
+
+  // each user's friends and purchases are generated from its id, so the
+  // graph is written one user at a time
+  vector<user_id_t> ids(n_users);
+  for (size_t i = 0; i < n_users; ++i)
+    ids[i] = i;
+
+  mmap_store store(prefix, T, n_users);
+  auto start = chrono::steady_clock::now();
+  const bool built = store.build(ids, [&](const user_id_t user_id,
+      vector<uint64_t>& friends, vector<purchase_info>& purchases) {
+    mt19937_64 rng(user_id);
+    const size_t community = user_id / community_size * community_size;
+    uniform_int_distribution<size_t> pick_local(community,
+        min(n_users, community + community_size) - 1);
+    uniform_int_distribution<size_t> pick_any(0, n_users - 1);
+    uniform_real_distribution<double> pick(0.0, 1.0);
+    for (size_t i = 0; i < degree; ++i) {
+      const user_id_t friend_id = pick(rng) < 0.8 ? pick_local(rng) : pick_any(rng);
+      if (friend_id != user_id)
+        friends.push_back(friend_id);
+    }
+    sort(friends.begin(), friends.end());
+    friends.erase(unique(friends.begin(), friends.end()), friends.end());
+
+    for (size_t i = 0; i < T; ++i) {
+      const size_t order = (user_id * T + T - i) * 2;
+      purchases.push_back(purchase_info{{order, order}, 50.0 + 20.0 * pick(rng)});
+    }
+  });
+  if (!built) {
+    cerr << "Error: writing " << prefix << " failed" << endl;
+    return EXIT_FAILURE;
+  }
+  print_usage_line("build", chrono::duration<double>(
+      chrono::steady_clock::now() - start).count(), n_users);
+
+  // queries are skewed toward low ids, as a few users are far more active
+  mt19937_64 rng(2017);
+  uniform_real_distribution<double> pick(0.0, 1.0);
+  size_t network_users = 0;
+  double checksum = 0.0;
+  start = chrono::steady_clock::now();
+  for (size_t i = 0; i < n_queries; ++i) {
+    const user_id_t user_id = static_cast<user_id_t>(pow(pick(rng), 3.0) * n_users);
+    const unordered_set<user_id_t> friends = store.get_friends_network(user_id, D);
+    const vector<purchase_info> purchases = store.friend_purchases(friends, 0, T);
+    network_users += friends.size();
+    for (const purchase_info& purchase : purchases)
+      checksum += purchase.amount;
+  }
+  print_usage_line("query", chrono::duration<double>(
+      chrono::steady_clock::now() - start).count(), n_queries);
+
+  cout << "average network size " << network_users / max<size_t>(n_queries, 1)
+      << ", checksum " << setprecision(2) << checksum << "\n";
+  store.print_stats(cout);
+
+  if (argc <= 6) {
+    for (const char* suffix : {".ids", ".offsets", ".adjacency", ".purchases"})
+      remove((prefix + suffix).c_str());
+  }
+  return 0;
+}
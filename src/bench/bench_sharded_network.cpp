@@ -0,0 +1,130 @@
+/*
+ * bench_sharded_network.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ *
+ * scaling benchmark of the sharded network: processes the same synthetic stream
+ * with 1 to 32 shards, reports events/sec, and checks that the flagged purchases
+ * match the single-threaded network
+ *
+ * usage: bench_sharded_network [users] [batch events] [stream events] [D]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+#include "../network.h"
+
+using namespace std;
+
+// function to write a synthetic log of purchases and friendships
+// inputs: fname - output file name
+//         header - true to write the D/T line
+//         n_users, n_events, D - size of the log and degree of separation
+//         rng - random number generator
+void write_log(const string& fname, const bool header, const size_t n_users,
+    const size_t n_events, const size_t D, mt19937_64& rng) {
+  ofstream out(fname);
+  if (header)
+    out << "{\"D\":\"" << D << "\", \"T\":\"50\"}\n";
+
+  uniform_int_distribution<size_t> pick_user(0, n_users - 1);
+  uniform_real_distribution<double> pick(0.0, 1.0);
+  normal_distribution<double> amount(50.0, 20.0);
+  for (size_t i = 0; i < n_events; ++i) {
+    const double r = pick(rng);
+    if (r < 0.7) {
+      double value = std::abs(amount(rng));
+      if (!header && pick(rng) < 0.01)
+        value += 500.0;
+      out << "{\"event_type\":\"purchase\", \"timestamp\":\"2017-06-13 11:33:01\", \"id\": \""
+          << pick_user(rng) << "\", \"amount\": \"" << fixed << setprecision(2) << value
+          << "\"}\n";
+    } else {
+      out << "{\"event_type\":\"" << (r < 0.97 ? "befriend" : "unfriend")
+          << "\", \"timestamp\":\"2017-06-13 11:33:01\", \"id1\": \"" << pick_user(rng)
+          << "\", \"id2\": \"" << pick_user(rng) << "\"}\n";
+    }
+  }
+}
+
+// function to run the detector over the synthetic logs
+// inputs: n_shards - the number of shards, 0 for the single-threaded network
+//         fname_batch, fname_stream, fname_out - file names
+// return: seconds spent processing the stream
+double run(const size_t n_shards, const string& fname_batch, const string& fname_stream,
+    const string& fname_out) {
+  network user_network;
+  // without the cache every purchase traverses the network through the shards
+  user_network.set_cache_enabled(false);
+
+  ifstream in_batch_log(fname_batch);
+  user_network.read_batch_log(in_batch_log);
+  if (n_shards > 0)
+    user_network.start_shards(n_shards);
+
+  ifstream in_stream_log(fname_stream);
+  ofstream out_flagged_log(fname_out);
+  const auto start = chrono::steady_clock::now();
+  user_network.process_stream_log(in_stream_log, out_flagged_log);
+  return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// function to read a whole file
+string read_file(const string& fname) {
+  ifstream in(fname);
+  ostringstream os;
+  os << in.rdbuf();
+  return os.str();
+}
+
+int main(int argc, char** argv) {
+  const size_t n_users = argc > 1 ? strtoull(argv[1], nullptr, 10) : 100000;
+  const size_t n_batch = argc > 2 ? strtoull(argv[2], nullptr, 10) : 1000000;
+  const size_t n_stream = argc > 3 ? strtoull(argv[3], nullptr, 10) : 20000;
+  const size_t D = argc > 4 ? strtoull(argv[4], nullptr, 10) : 2;
+
+  const string prefix = "/tmp/bench_sharded_" + to_string(getpid());
+  const string fname_batch = prefix + "_batch.json";
+  const string fname_stream = prefix + "_stream.json";
+  const string fname_out = prefix + "_out.json";
+
+  mt19937_64 rng(2017);
+  write_log(fname_batch, true, n_users, n_batch, D, rng);
+  write_log(fname_stream, false, n_users, n_stream, D, rng);
+
+  cout << "users " << n_users << ", batch events " << n_batch
+      << ", stream events " << n_stream << ", D " << D
+      << ", hardware threads " << thread::hardware_concurrency() << "\n";
+  cout << setw(8) << "shards" << setw(12) << "seconds" << setw(14) << "events/sec"
+      << setw(10) << "speedup" << setw(10) << "output" << "\n";
+
+  const double base_seconds = run(0, fname_batch, fname_stream, fname_out);
+  const string base_output = read_file(fname_out);
+  cout << setw(8) << "-" << setw(12) << fixed << setprecision(3) << base_seconds
+      << setw(14) << setprecision(0) << n_stream / base_seconds
+      << setw(10) << setprecision(2) << 1.0 << setw(10) << "ref" << "\n";
+
+  for (const size_t n_shards : {1, 2, 4, 8, 16, 32}) {
+    const double seconds = run(n_shards, fname_batch, fname_stream, fname_out);
+    const bool same = read_file(fname_out) == base_output;
+    cout << setw(8) << n_shards << setw(12) << setprecision(3) << seconds
+        << setw(14) << setprecision(0) << n_stream / seconds
+        << setw(10) << setprecision(2) << base_seconds / seconds
+        << setw(10) << (same ? "same" : "DIFFERS") << "\n";
+  }
+
+  remove(fname_batch.c_str());
+  remove(fname_stream.c_str());
+  remove(fname_out.c_str());
+  return 0;
+}
@@ -0,0 +1,134 @@
+/*
+ * bench_shm_ingest.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ *
+ * producer benchmark of the shared-memory ingest (anomaly_detection
+ * --shm-ring=PATH): converts the lines of a stream log to binary records,
+ * sends them (repeated as needed) from one or more producer threads through
+ * libshm_producer.a while a reader thread takes the flagged purchases, and
+ * reports the events/sec until the engine has processed every event and the
+ * latency from sending a flagged purchase to reading its result. Compare with
+ * the file path (the same events in a stream log) and the socket path
+ * (bench_ingest_client). With a rate the events are paced to that many per
+ * second in total, so the latency is measured below the engine's limit rather
+ * than behind a full ring.
+ *
+ * usage: bench_shm_ingest PATH stream_log.json [events] [producers] [spin]
+ *                         [rate]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include <cstdlib>
+#include "../shm_producer.h"
+#include "../event.h"
+
+using namespace std;
+using namespace rapidjson;
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " PATH stream_log.json [events] [producers] [spin]"
+        " [rate]" << endl;
+    return EXIT_FAILURE;
+  }
+  const string path = argv[1];
+  const size_t n_events = argc > 3 ? strtoull(argv[3], nullptr, 10) : 100000;
+  const size_t n_producers = argc > 4 ? max<size_t>(strtoull(argv[4], nullptr, 10), 1) : 1;
+  const size_t spin = argc > 5 ? strtoull(argv[5], nullptr, 10) : 1000;
+  const double rate = argc > 6 ? strtod(argv[6], nullptr) : 0.0;
+
+  // the events are converted before the clock starts, as a producer would
+  // have them in binary form already
+  vector<shm_event_record> records;
+  ifstream in(argv[2]);
+  for (string line; getline(in, line);) {
+    Document doc;
+    doc.Parse(line.c_str());
+    event e;
+    if (!doc.IsObject() || !doc.HasMember("event_type") || !read_event(doc, e))
+      continue;
+    shm_event_record record = {0, e.time, e.id1, e.id2, e.amount,
+        static_cast<uint32_t>(e.kind), 0};
+    records.push_back(record);
+  }
+  if (records.empty()) {
+    cerr << "Error: no events in " << argv[2] << endl;
+    return EXIT_FAILURE;
+  }
+
+  // every producer thread attaches on its own, like a separate process
+  vector<unique_ptr<shm_producer>> producers;
+  for (size_t i = 0; i < n_producers; ++i) {
+    producers.emplace_back(new shm_producer());
+    if (!producers.back()->attach(path, spin)) {
+      cerr << "Error: cannot attach to " << path << ".events" << endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  vector<chrono::steady_clock::time_point> send_times(n_events);
+  vector<double> latencies;
+  atomic<bool> done(false);
+  thread reader([&] {
+    shm_result_record result;
+    while (!done.load(memory_order_acquire)) {
+      while (producers[0]->read_result(result, 10)) {
+        latencies.push_back(chrono::duration<double>(
+            chrono::steady_clock::now() - send_times[result.event.tag]).count());
+      }
+    }
+  });
+
+  const auto start = chrono::steady_clock::now();
+  vector<thread> senders;
+  for (size_t p = 0; p < n_producers; ++p) {
+    senders.emplace_back([&, p] {
+      for (size_t i = p; i < n_events; i += n_producers) {
+        shm_event_record record = records[i % records.size()];
+        record.tag = i;
+        if (rate > 0.0)
+          this_thread::sleep_until(start + chrono::duration_cast<chrono::steady_clock::duration>(
+              chrono::duration<double>(i / rate)));
+        send_times[i] = chrono::steady_clock::now();
+        producers[p]->send(record);
+      }
+    });
+  }
+  for (thread& sender : senders)
+    sender.join();
+  while (producers[0]->processed() < n_events)
+    this_thread::sleep_for(chrono::microseconds(50));
+  const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  // the last results arrive right after the last event is processed
+  this_thread::sleep_for(chrono::milliseconds(50));
+  done.store(true, memory_order_release);
+  reader.join();
+  producers.clear();
+
+  sort(latencies.begin(), latencies.end());
+  cout << "producers " << n_producers << ", spin " << spin;
+  if (rate > 0.0)
+    cout << ", rate " << rate;
+  cout << "\n"
+      << "processed events " << n_events << " in " << fixed << setprecision(3) << seconds
+      << " s: " << setprecision(0) << n_events / seconds << " events/s\n"
+      << "flagged purchases received " << latencies.size() << "\n";
+  if (!latencies.empty()) {
+    cout << "send-to-result latency us: p50 " << latencies[latencies.size() / 2] * 1e6
+        << ", p99 " << latencies[latencies.size() * 99 / 100] * 1e6
+        << ", max " << latencies.back() * 1e6 << "\n";
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,107 @@
+/*
+ * bench_stats_kernel.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ *
+ * microbenchmark of the sum and sum-of-squares kernels for T from 2 to 10,000:
+ * times the scalar loop over the purchase records against copying the amounts
+ * and running every vector kernel, checks that all of them give the same sums
+ * to the last bit, and reports the relative error against a long double reference
+ */
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+#include "../stats_kernel.h"
+
+using namespace std;
+
+// a purchase as the network stores it
+struct purchase_record {
+  uint64_t purchase_time;
+  size_t purchase_order;
+  double amount;
+};
+
+int main() {
+  const size_t sizes[] = {2, 5, 10, 50, 100, 500, 1000, 2000, 5000, 10000};
+  const char* kernels[] = {"scalar", "sse2", "avx2", "avx512"};
+
+  mt19937_64 rng(2017);
+  // high-magnitude amounts with cents make rounding errors visible
+  uniform_real_distribution<double> dist(1.0e6, 1.0e6 + 100.0);
+
+  cout << "selected kernel: " << sum_kernel_name()
+      << ", vector kernel from " << vector_kernel_min_length << " amounts\n";
+  cout << setw(8) << "T" << setw(10) << "kernel" << setw(14) << "ns/call"
+      << setw(14) << "rel.err sum" << setw(14) << "rel.err sum2" << "\n";
+
+  bool identical = true;
+  for (const size_t n : sizes) {
+    vector<double> amounts(n);
+    vector<purchase_record> records(n);
+    long double ref_sum = 0.0L, ref_sum2 = 0.0L;
+    for (size_t i = 0; i < n; ++i) {
+      amounts[i] = std::round(dist(rng) * 100.0) / 100.0;
+      records[i] = {0, i, amounts[i]};
+      ref_sum += amounts[i];
+      ref_sum2 += (long double)amounts[i] * amounts[i];
+    }
+    // repeat small sizes so every measurement covers about 10^7 amounts
+    const size_t repeats = std::max<size_t>(10000000 / n, 10);
+
+    // the scalar path: the lanes are filled from the records directly
+    double strided_sum = 0.0, strided_sum2 = 0.0;
+    {
+      const auto start = chrono::steady_clock::now();
+      for (size_t r = 0; r < repeats; ++r) {
+        sum_amounts_in_lanes(records.cbegin(), n, 0.0, strided_sum, strided_sum2);
+        __asm__ __volatile__("" : : "g"(&strided_sum), "g"(&strided_sum2) : "memory");
+      }
+      const double ns = chrono::duration<double, nano>(
+          chrono::steady_clock::now() - start).count() / repeats;
+      cout << setw(8) << n << setw(10) << "strided" << setw(14) << fixed
+          << setprecision(1) << ns << setw(14) << scientific << setprecision(2)
+          << fabs((strided_sum - ref_sum) / ref_sum) << setw(14)
+          << fabs((strided_sum2 - ref_sum2) / ref_sum2) << "\n";
+    }
+
+    // the vector path: the amounts are copied, as compute_stats does, then summed
+    vector<double> buffer;
+    for (const char* name : kernels) {
+      const sum_kernel_t kernel = find_sum_kernel(name);
+      if (kernel == nullptr)
+        continue;
+
+      double sum = 0.0, sum2 = 0.0;
+      const auto start = chrono::steady_clock::now();
+      for (size_t r = 0; r < repeats; ++r) {
+        buffer.resize(n);
+        for (size_t i = 0; i < n; ++i)
+          buffer[i] = records[i].amount;
+        kernel(buffer.data(), n, 0.0, sum, sum2);
+        __asm__ __volatile__("" : : "g"(&sum), "g"(&sum2) : "memory");
+      }
+      const double ns = chrono::duration<double, nano>(
+          chrono::steady_clock::now() - start).count() / repeats;
+
+      const bool same = sum == strided_sum && sum2 == strided_sum2;
+      identical = identical && same;
+      cout << setw(8) << n << setw(10) << name << setw(14) << fixed
+          << setprecision(1) << ns << setw(14) << scientific << setprecision(2)
+          << fabs((sum - ref_sum) / ref_sum) << setw(14)
+          << fabs((sum2 - ref_sum2) / ref_sum2) << (same ? "" : "  differs") << "\n";
+    }
+  }
+
+  cout << (identical ? "all kernels give the sums of the scalar loop\n"
+      : "some kernels differ from the scalar loop\n");
+  return identical ? 0 : 1;
+}
@@ -0,0 +1,123 @@
+/*
+ * bench_stream_merge.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ *
+ * measures how fast stream_merger hands out the events of several stream
+ * logs, with nothing done to them, against reading and parsing each log
+ * alone on one thread (the rate of every input by itself). The merged feed
+ * is also checked to be in time order when every input is.
+ *
+ * usage: bench_stream_merge log.json... [rounds=N]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include "../stream_merger.h"
+#include "../event_scanner.h"
+
+using namespace std;
+
+// sum of the fields read, so that the reading is not optimized away
+static uint64_t checksum = 0;
+
+// function to read and parse the events of one log on the calling thread
+// input:  fname - name of the log
+// output: sorted - reference to a flag cleared if the log is not in time order
+// return: the number of events
+size_t read_log(const char* fname, bool& sorted) {
+  ifstream in(fname);
+  size_t events = 0;
+  size_t D, T;
+  uint64_t last_time = 0;
+  event e;
+  for (string line; getline(in, line);) {
+    if (scan_event_line(line, e, D, T) != scan_result::event)
+      continue;
+    sorted = sorted && e.time >= last_time;
+    last_time = e.time;
+    checksum += e.time + e.id1;
+    ++events;
+  }
+  return events;
+}
+
+int main(int argc, char** argv) {
+  vector<const char*> fnames;
+  size_t rounds = 3;
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+    if (!arg.compare(0, 7, "rounds="))
+      rounds = max<size_t>(strtoull(argv[i] + 7, nullptr, 10), 1);
+    else
+      fnames.push_back(argv[i]);
+  }
+  if (fnames.empty()) {
+    cerr << "usage: " << argv[0] << " log.json... [rounds=N]" << endl;
+    return EXIT_FAILURE;
+  }
+
+  // every input alone
+  bool inputs_sorted = true;
+  size_t total_events = 0;
+  double slowest_rate = 1e18, sequential_seconds = 0.0;
+  for (const char* fname : fnames) {
+    double seconds = 1e9;
+    size_t events = 0;
+    for (size_t i = 0; i < rounds; ++i) {
+      const auto start = chrono::steady_clock::now();
+      events = read_log(fname, inputs_sorted);
+      seconds = min(seconds, chrono::duration<double>(
+          chrono::steady_clock::now() - start).count());
+    }
+    total_events += events;
+    sequential_seconds += seconds;
+    slowest_rate = min(slowest_rate, events / seconds);
+    cout << fixed << setprecision(0) << fname << ": " << events << " events, "
+        << events / seconds << " events/s alone\n";
+  }
+
+  // the merged feed
+  double merge_seconds = 1e9;
+  size_t merged = 0;
+  bool merged_sorted = true;
+  for (size_t i = 0; i < rounds; ++i) {
+    const auto start = chrono::steady_clock::now();
+    stream_merger merger;
+    if (!merger.open(fnames, true, false)) {
+      cerr << "Error: cannot open the logs" << endl;
+      return EXIT_FAILURE;
+    }
+    event e;
+    uint64_t last_time = 0;
+    merged = 0;
+    while (merger.next(e)) {
+      merged_sorted = merged_sorted && e.time >= last_time;
+      last_time = e.time;
+      checksum += e.time + e.id1;
+      ++merged;
+    }
+    merge_seconds = min(merge_seconds, chrono::duration<double>(
+        chrono::steady_clock::now() - start).count());
+  }
+  if (merged != total_events)
+    cerr << "Error: the merge handed out " << merged << " of " << total_events
+        << " events" << endl;
+  if (inputs_sorted && !merged_sorted)
+    cerr << "Error: the merged events are not in time order" << endl;
+
+  cout << "merged: " << merged << " events, " << merged / merge_seconds
+      << " events/s (" << thread::hardware_concurrency() << " cores)\n"
+      << "all inputs one after another on one thread: "
+      << total_events / sequential_seconds << " events/s\n" << setprecision(2)
+      << "merged rate over the slowest input alone: "
+      << merged / merge_seconds / slowest_rate << "x (checksum " << checksum % 1000 << ")\n";
+  return merged == total_events && (merged_sorted || !inputs_sorted) ?
+      EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,164 @@
+/*
+ * bench_uring_io.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ *
+ * measures reading a log line by line with an ifstream and with
+ * uring_istream, with the file in the page cache and after dropping it from
+ * the cache (posix_fadvise, so the reads go to the device), and writing
+ * lines with an ofstream and with uring_ostream, flushing every line as the
+ * engine does with endl and flushing only at the end. The lines read and the
+ * files written are checked to be the same.
+ *
+ * usage: bench_uring_io log.json output_file [rounds]
+ */
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include "../uring_io.h"
+
+using namespace std;
+
+// function to drop a file from the page cache
+// input: fname - name of the file
+void drop_cache(const char* fname) {
+  const int fd = open(fname, O_RDONLY);
+  if (fd < 0)
+    return;
+  fdatasync(fd);
+  posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+  close(fd);
+}
+
+// function to read the lines of a stream
+// input:  in - the stream
+// output: checksum - reference to a sum of the line lengths and first bytes
+// return: the number of lines
+size_t read_lines(istream& in, uint64_t& checksum) {
+  size_t lines = 0;
+  checksum = 0;
+  for (string line; getline(in, line); ++lines)
+    checksum += line.size() * 131 + (line.empty() ? 0 : line[0]);
+  return lines;
+}
+
+// function to time the reading of a file with both streams
+// inputs: fname - name of the file
+//         cold - true to drop the file from the cache before every read
+//         rounds - the number of rounds (the best is kept)
+void bench_read(const char* fname, const bool cold, const size_t rounds) {
+  double stream_seconds = 1e9, uring_seconds = 1e9;
+  size_t stream_lines = 0, uring_lines = 0;
+  uint64_t stream_checksum = 0, uring_checksum = 0;
+  for (size_t i = 0; i < rounds; ++i) {
+    if (cold)
+      drop_cache(fname);
+    auto start = chrono::steady_clock::now();
+    {
+      ifstream in(fname);
+      stream_lines = read_lines(in, stream_checksum);
+    }
+    stream_seconds = min(stream_seconds,
+        chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+    if (cold)
+      drop_cache(fname);
+    start = chrono::steady_clock::now();
+    {
+      uring_istream in;
+      if (!in.open(fname, 0)) {
+        cerr << "Error: io_uring is not available" << endl;
+        exit(EXIT_FAILURE);
+      }
+      uring_lines = read_lines(in, uring_checksum);
+    }
+    uring_seconds = min(uring_seconds,
+        chrono::duration<double>(chrono::steady_clock::now() - start).count());
+  }
+  if (stream_lines != uring_lines || stream_checksum != uring_checksum)
+    cerr << "Error: the streams read different lines" << endl;
+  cout << fixed << setprecision(0) << (cold ? "read, cold:  " : "read, cached: ")
+      << "ifstream " << stream_lines / stream_seconds << " lines/s, io_uring "
+      << uring_lines / uring_seconds << " lines/s" << setprecision(2) << " ("
+      << stream_seconds / uring_seconds << "x)\n";
+}
+
+// function to write lines to a stream
+// inputs: out - the stream
+//         lines - the lines
+//         flush_lines - true to flush every line
+void write_lines(ostream& out, const vector<string>& lines, const bool flush_lines) {
+  for (const string& line : lines) {
+    if (flush_lines)
+      out << line << endl;
+    else
+      out << line << '\n';
+  }
+  out.flush();
+}
+
+// function to time the writing of lines with both streams
+// inputs: fname - name of the output file
+//         lines - the lines
+//         flush_lines - true to flush every line
+//         rounds - the number of rounds (the best is kept)
+void bench_write(const char* fname, const vector<string>& lines, const bool flush_lines,
+    const size_t rounds) {
+  const string fname_uring = string(fname) + ".uring";
+  double stream_seconds = 1e9, uring_seconds = 1e9;
+  for (size_t i = 0; i < rounds; ++i) {
+    auto start = chrono::steady_clock::now();
+    {
+      ofstream out(fname, ios::out | ios::trunc);
+      write_lines(out, lines, flush_lines);
+    }
+    stream_seconds = min(stream_seconds,
+        chrono::duration<double>(chrono::steady_clock::now() - start).count());
+
+    start = chrono::steady_clock::now();
+    {
+      uring_ostream out;
+      out.open(fname_uring, false);
+      write_lines(out, lines, flush_lines);
+    }
+    uring_seconds = min(uring_seconds,
+        chrono::duration<double>(chrono::steady_clock::now() - start).count());
+  }
+  ifstream a(fname), b(fname_uring);
+  uint64_t checksum_a = 0, checksum_b = 0;
+  if (read_lines(a, checksum_a) != read_lines(b, checksum_b) || checksum_a != checksum_b)
+    cerr << "Error: the streams wrote different files" << endl;
+  unlink(fname_uring.c_str());
+  cout << fixed << setprecision(0) << (flush_lines ? "write, flush per line: " :
+      "write, flush at the end: ") << "ofstream " << lines.size() / stream_seconds
+      << " lines/s, io_uring " << lines.size() / uring_seconds << " lines/s"
+      << setprecision(2) << " (" << stream_seconds / uring_seconds << "x)\n";
+}
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " log.json output_file [rounds]" << endl;
+    return EXIT_FAILURE;
+  }
+  const size_t rounds = argc > 3 ? max<size_t>(strtoull(argv[3], nullptr, 10), 1) : 3;
+
+  bench_read(argv[1], false, rounds);
+  bench_read(argv[1], true, rounds);
+
+  vector<string> lines;
+  ifstream in(argv[1]);
+  for (string line; getline(in, line);)
+    lines.push_back(line);
+  bench_write(argv[2], lines, false, rounds);
+  bench_write(argv[2], lines, true, rounds);
+  unlink(argv[2]);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,310 @@
+/*
+ * binary_event_log.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <cstring>
+#include <cstdio>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "binary_event_log.h"
+
+using namespace std;
+
+const char binary_log_magic[8] = {'A', 'D', 'E', 'V', 'L', 'O', 'G', '1'};
+
+// the decimals of an amount stored as the bits of its double
+static const uint8_t raw_amount_decimals = 255;
+// the most digits of an amount stored in fixed point: below 2^53, the units
+// and 10^decimals are exact doubles, so their quotient is the correctly
+// rounded value of the text, as parsed by stod
+static const size_t max_amount_digits = 15;
+
+// the byte length of the fields of each record type, after the type byte
+static const size_t purchase_fields = 25;
+static const size_t friend_fields = 24;
+static const size_t parameters_fields = 8;
+
+static const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+    1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+
+bool is_binary_event_log(const string& fname) {
+  ifstream in(fname, ios::binary);
+  char magic[sizeof(binary_log_magic)];
+  return in.read(magic, sizeof(magic)) && !memcmp(magic, binary_log_magic, sizeof(magic));
+}
+
+// function to convert the text of an amount to a fixed-point number
+// input:   text - the amount as written in the log
+// outputs: units, decimals - references to the number (units / 10^decimals)
+// return:  false if the text is not a plain decimal number of at most
+//          max_amount_digits digits
+static bool parse_amount(const string& text, int64_t& units, uint8_t& decimals) {
+  size_t i = 0;
+  const bool negative = !text.empty() && text[0] == '-';
+  if (negative)
+    ++i;
+  int64_t value = 0;
+  size_t digits = 0, fraction_digits = 0;
+  bool in_fraction = false;
+  for (; i < text.size(); ++i) {
+    const char c = text[i];
+    if (c == '.' && !in_fraction) {
+      in_fraction = true;
+    } else if (c >= '0' && c <= '9') {
+      if (++digits > max_amount_digits)
+        return false;
+      value = value * 10 + (c - '0');
+      fraction_digits += in_fraction;
+    } else {
+      return false;
+    }
+  }
+  // -0 is a double of its own
+  if (digits == 0 || (negative && value == 0))
+    return false;
+  units = negative ? -value : value;
+  decimals = static_cast<uint8_t>(fraction_digits);
+  return true;
+}
+
+void make_binary_record(const event& e, const string& amount_text, binary_record& r) {
+  r = binary_record();
+  r.time = e.time;
+  r.id1 = e.id1;
+  switch (e.kind) {
+    case event_kind::purchase:
+      r.type = binary_record_type::purchase;
+      if (!parse_amount(amount_text, r.amount_units, r.amount_decimals)) {
+        memcpy(&r.amount_units, &e.amount, sizeof(e.amount));
+        r.amount_decimals = raw_amount_decimals;
+      }
+      break;
+    case event_kind::befriend:
+    case event_kind::unfriend:
+      r.type = e.kind == event_kind::befriend ?
+          binary_record_type::befriend : binary_record_type::unfriend;
+      r.id2 = e.id2;
+      break;
+  }
+}
+
+// function to obtain the double value of a fixed-point amount
+// input:  r - a purchase record
+// return: the amount
+static double record_amount(const binary_record& r) {
+  if (r.amount_decimals == raw_amount_decimals) {
+    double amount;
+    memcpy(&amount, &r.amount_units, sizeof(amount));
+    return amount;
+  }
+  return static_cast<double>(r.amount_units) / powers_of_ten[r.amount_decimals];
+}
+
+void binary_record_to_event(const binary_record& r, event& e) {
+  e.time = r.time;
+  e.id1 = r.id1;
+  if (r.type == binary_record_type::purchase) {
+    e.kind = event_kind::purchase;
+    e.id2 = 0;
+    e.amount = record_amount(r);
+  } else {
+    e.kind = r.type == binary_record_type::befriend ?
+        event_kind::befriend : event_kind::unfriend;
+    e.id2 = r.id2;
+    e.amount = 0.0;
+  }
+}
+
+// function to write a fixed-point amount as its text
+// input:  r - a purchase record
+// return: the text
+static string format_amount(const binary_record& r) {
+  char buffer[40];
+  if (r.amount_decimals == raw_amount_decimals) {
+    snprintf(buffer, sizeof(buffer), "%.17g", record_amount(r));
+    return buffer;
+  }
+  // the digits of the units, with a point before the last decimals
+  const uint64_t magnitude = r.amount_units < 0 ?
+      -static_cast<uint64_t>(r.amount_units) : static_cast<uint64_t>(r.amount_units);
+  string digits = to_string(magnitude);
+  if (r.amount_decimals > 0) {
+    if (digits.size() <= r.amount_decimals)
+      digits.insert(0, r.amount_decimals + 1 - digits.size(), '0');
+    digits.insert(digits.size() - r.amount_decimals, 1, '.');
+  }
+  return r.amount_units < 0 ? "-" + digits : digits;
+}
+
+string format_event_line(const binary_record& r) {
+  string line = "{\"event_type\":\"";
+  if (r.type == binary_record_type::purchase) {
+    line += "purchase\", \"timestamp\":\"" + convert_timet2string(r.time)
+        + "\", \"id\": \"" + to_string(r.id1)
+        + "\", \"amount\": \"" + format_amount(r) + "\"}";
+  } else {
+    line += r.type == binary_record_type::befriend ? "befriend" : "unfriend";
+    line += "\", \"timestamp\":\"" + convert_timet2string(r.time)
+        + "\", \"id1\": \"" + to_string(r.id1)
+        + "\", \"id2\": \"" + to_string(r.id2) + "\"}";
+  }
+  return line;
+}
+
+// function to append a field to a record being encoded
+// inputs: value - the field
+//         p - reference to the write position, moved past the field
+template <typename V>
+static void put_field(const V& value, char*& p) {
+  memcpy(p, &value, sizeof(value));
+  p += sizeof(value);
+}
+
+// function to read a field of a record being decoded
+// inputs: p - reference to the read position, moved past the field
+// output: value - reference to the field
+template <typename V>
+static void get_field(const char*& p, V& value) {
+  memcpy(&value, p, sizeof(value));
+  p += sizeof(value);
+}
+
+bool binary_event_writer::open(const string& fname) {
+  out_.open(fname, ios::binary | ios::trunc);
+  if (out_.fail())
+    return false;
+  out_.write(binary_log_magic, sizeof(binary_log_magic));
+  bytes_ = sizeof(binary_log_magic);
+  return !out_.fail();
+}
+
+void binary_event_writer::write(const binary_record& r) {
+  char buffer[64];
+  char* p = buffer + sizeof(uint16_t);
+  put_field(static_cast<uint8_t>(r.type), p);
+  switch (r.type) {
+    case binary_record_type::purchase:
+      put_field(r.time, p);
+      put_field(r.id1, p);
+      put_field(r.amount_units, p);
+      put_field(r.amount_decimals, p);
+      break;
+    case binary_record_type::befriend:
+    case binary_record_type::unfriend:
+      put_field(r.time, p);
+      put_field(r.id1, p);
+      put_field(r.id2, p);
+      break;
+    case binary_record_type::parameters:
+      put_field(r.D, p);
+      put_field(r.T, p);
+      break;
+  }
+  const uint16_t length = static_cast<uint16_t>(p - buffer - sizeof(uint16_t));
+  memcpy(buffer, &length, sizeof(length));
+  out_.write(buffer, p - buffer);
+  bytes_ += p - buffer;
+}
+
+bool binary_event_writer::close() {
+  out_.close();
+  return !out_.fail();
+}
+
+binary_event_log::~binary_event_log() {
+  if (data_ != nullptr)
+    munmap(const_cast<char*>(data_), size_);
+}
+
+bool binary_event_log::open(const string& fname, const uint64_t offset) {
+  const int fd = ::open(fname.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(binary_log_magic)) {
+    close(fd);
+    return false;
+  }
+  size_ = st.st_size;
+  void* base = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED)
+    return false;
+  data_ = static_cast<const char*>(base);
+  madvise(base, size_, MADV_SEQUENTIAL);
+  if (memcmp(data_, binary_log_magic, sizeof(binary_log_magic)))
+    return false;
+  position_ = min<uint64_t>(max<uint64_t>(offset, sizeof(binary_log_magic)), size_);
+  return true;
+}
+
+bool binary_event_log::read(binary_record& r) {
+  for (;;) {
+    // the length prefix and the bytes it counts must be in the file
+    uint16_t length = 0;
+    const size_t left = size_ - position_;
+    if (left >= sizeof(length))
+      memcpy(&length, data_ + position_, sizeof(length));
+    if (left < sizeof(length) || left - sizeof(length) < length) {
+      if (left > 0 && !truncated_) {
+        cerr << "Error: the binary event log ends with a truncated record" << endl;
+        truncated_ = true;
+      }
+      return false;
+    }
+    const char* p = data_ + position_ + sizeof(length);
+    position_ += sizeof(length) + length;
+
+    if (length == 0) {
+      ++skipped_records_;
+      continue;
+    }
+    // the bytes of the fields after the type byte
+    const size_t fields = length - 1u;
+    uint8_t type;
+    get_field(p, type);
+    r.type = static_cast<binary_record_type>(type);
+    switch (r.type) {
+      case binary_record_type::purchase:
+        if (fields < purchase_fields)
+          break;
+        get_field(p, r.time);
+        get_field(p, r.id1);
+        get_field(p, r.amount_units);
+        get_field(p, r.amount_decimals);
+        if (r.amount_decimals > max_amount_digits && r.amount_decimals != raw_amount_decimals)
+          break;
+        ++records_;
+        return true;
+      case binary_record_type::befriend:
+      case binary_record_type::unfriend:
+        if (fields < friend_fields)
+          break;
+        get_field(p, r.time);
+        get_field(p, r.id1);
+        get_field(p, r.id2);
+        ++records_;
+        return true;
+      case binary_record_type::parameters:
+        if (fields < parameters_fields)
+          break;
+        get_field(p, r.D);
+        get_field(p, r.T);
+        ++records_;
+        return true;
+    }
+    ++skipped_records_;
+  }
+}
+
+void binary_event_log::print_stats(ostream& out, const char* name) const {
+  out << name << " binary records: " << records_ << ", skipped: " << skipped_records_
+      << (truncated_ ? ", truncated at the end" : "") << "\n";
+}
@@ -0,0 +1,140 @@
+/*
+ * binary_event_log.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef BINARY_EVENT_LOG_H_
+#define BINARY_EVENT_LOG_H_
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <fstream>
+#include <iosfwd>
+#include "event.h"
+
+// A binary event log starts with the 8 bytes of binary_log_magic, followed by
+// records. Every record is a 2-byte length (the bytes that follow it), a
+// 1-byte binary_record_type and the fields of its type, in the byte order of
+// the host (little-endian on x86):
+//   purchase:            time (8), id (8), amount units (8), amount decimals (1)
+//   befriend, unfriend:  time (8), id1 (8), id2 (8)
+//   parameters:          D (4), T (4)
+// Times are seconds since the epoch and ids are 64-bit. An amount is the
+// fixed-point number units / 10^decimals, so it converts to exactly the double
+// parsed from its text; an amount text that does not fit is stored as the bits
+// of that double with decimals 255. Readers skip records of unknown types and
+// the bytes after the known fields, so fields can be added at the end.
+extern const char binary_log_magic[8];
+
+enum class binary_record_type : uint8_t {
+  purchase = 0,
+  befriend = 1,
+  unfriend = 2,
+  parameters = 3
+};
+
+// binary_record holds the fields of one record of a binary event log
+struct binary_record {
+  binary_record_type type = binary_record_type::purchase;
+  uint64_t time = 0;
+  uint64_t id1 = 0;
+  uint64_t id2 = 0;
+  int64_t amount_units = 0;
+  uint8_t amount_decimals = 0;
+  // D and T of a parameters record
+  uint32_t D = 0;
+  uint32_t T = 0;
+};
+
+// function to check if a file is a binary event log
+// input:  fname - name of the file
+// return: true if the file starts with binary_log_magic
+bool is_binary_event_log(const std::string& fname);
+
+// function to make the record of a parsed event of a json log
+// inputs:  e - the event
+//          amount_text - the amount as written in the log (purchases only)
+// output:  r - reference to the record
+void make_binary_record(const event& e, const std::string& amount_text, binary_record& r);
+
+// function to fill an event from a record of a binary event log
+// input:  r - a purchase, befriend or unfriend record
+// output: e - reference to the event (the timestamp and the line are not filled)
+void binary_record_to_event(const binary_record& r, event& e);
+
+// function to write a record as a line of a json log, in the layout of the
+//          logs in log_input
+// input:  r - a purchase, befriend or unfriend record
+// return: the line without its newline
+std::string format_event_line(const binary_record& r);
+
+// binary_event_writer appends records to a new binary event log
+class binary_event_writer {
+  private:
+    std::ofstream out_{};
+    uint64_t bytes_ = 0;
+
+  public:
+    // function to create the log and write its magic
+    // input:  fname - name of the file
+    // return: true if the file is created
+    bool open(const std::string& fname);
+
+    // function to append a record
+    // input: r - the record
+    void write(const binary_record& r);
+
+    // function to flush and close the log
+    // return: true if every record was written
+    bool close();
+
+    uint64_t bytes() const {return bytes_;}
+};
+
+// binary_event_log reads the records of a binary event log mapped into memory:
+// a record is a few fixed-size loads, with nothing to parse.
+class binary_event_log {
+  private:
+    const char* data_ = nullptr;
+    std::size_t size_ = 0;
+    // byte offset of the next record
+    std::size_t position_ = 0;
+
+    // counters
+    std::size_t records_ = 0;
+    std::size_t skipped_records_ = 0;
+    bool truncated_ = false;
+
+  public:
+    binary_event_log() = default;
+    // destructor: unmaps the log
+    ~binary_event_log();
+
+    binary_event_log(const binary_event_log&) = delete;
+    binary_event_log& operator=(const binary_event_log&) = delete;
+
+    // function to map a log
+    // inputs: fname - name of the file
+    //         offset - byte offset of the first record to read
+    //                  (0: the first record of the log)
+    // return: true if the file is a binary event log and is mapped
+    bool open(const std::string& fname, const uint64_t offset);
+
+    // function to read the next record; records of unknown types are skipped
+    // output: r - reference to the record
+    // return: false at the end of the log (or of its last complete record)
+    bool read(binary_record& r);
+
+    // function to obtain the byte offset of the next record
+    uint64_t offset() const {return position_;}
+
+    // function to write the counters of the log to a stream
+    // inputs: out - output stream
+    //         name - the name of the log in the messages
+    void print_stats(std::ostream& out, const char* name) const;
+};
+
+#endif /* BINARY_EVENT_LOG_H_ */
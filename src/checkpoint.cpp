@@ -0,0 +1,189 @@
+/*
+ * checkpoint.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+#include <fcntl.h>
+#include <unistd.h>
+#include "checkpoint.h"
+
+using namespace std;
+
+const char base_snapshot_magic[8] = {'A', 'D', 'S', 'N', 'A', 'P', '0', '3'};
+const char delta_checkpoint_magic[8] = {'A', 'D', 'D', 'E', 'L', 'T', 'A', '1'};
+
+// header of a user record
+struct user_record_header {
+  uint64_t user_id;
+  uint32_t n_friends;
+  uint32_t n_purchases;
+};
+
+// the bytes of a purchase in a record
+static const size_t purchase_bytes = sizeof(uint64_t) * 2 + sizeof(double);
+
+// function to write a value to a binary stream
+template <typename T>
+static inline void write_value(ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+// function to force a file or directory to disk
+// input:  path - name of the file or directory
+// return: true if it is synced
+static bool sync_path(const string& path) {
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+  const bool synced = fsync(fd) == 0;
+  close(fd);
+  return synced;
+}
+
+string delta_checkpoint_name(const string& fname_snapshot, const uint64_t sequence) {
+  return fname_snapshot + ".delta." + to_string(sequence);
+}
+
+void write_checkpoint_header(ostream& out, const char* magic,
+    const checkpoint_header& header, const uint64_t n_users) {
+  out.write(magic, sizeof(base_snapshot_magic));
+  write_value(out, header);
+  write_value(out, n_users);
+}
+
+bool read_checkpoint_header(istream& in, const char* magic,
+    checkpoint_header& header, uint64_t& n_users) {
+  char file_magic[sizeof(base_snapshot_magic)];
+  in.read(file_magic, sizeof(file_magic));
+  in.read(reinterpret_cast<char*>(&header), sizeof(header));
+  in.read(reinterpret_cast<char*>(&n_users), sizeof(n_users));
+  return in && !memcmp(file_magic, magic, sizeof(file_magic));
+}
+
+void write_user_record(ostream& out, const user_id_t user_id, const user_info& user) {
+  const friend_set& friends = user.get_friend_list();
+  const purchase_record& purchases = user.get_purchase_record();
+  const user_record_header header {user_id, static_cast<uint32_t>(friends.size()),
+      static_cast<uint32_t>(purchases.size())};
+  write_value(out, header);
+  for (const user_id_t friend_id : friends)
+    write_value<uint64_t>(out, friend_id);
+  for (const purchase_info& purchase : purchases) {
+    write_value<uint64_t>(out, purchase.tm_info.purchase_time);
+    write_value<uint64_t>(out, purchase.tm_info.purchase_order);
+    write_value<double>(out, purchase.amount);
+  }
+}
+
+bool read_user_record(istream& in, user_id_t& user_id, string& record) {
+  user_record_header header;
+  if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)))
+    return false;
+  const size_t body_bytes = header.n_friends * sizeof(uint64_t)
+      + header.n_purchases * purchase_bytes;
+  record.resize(sizeof(header) + body_bytes);
+  memcpy(&record[0], &header, sizeof(header));
+  in.read(&record[sizeof(header)], body_bytes);
+  user_id = header.user_id;
+  return static_cast<bool>(in);
+}
+
+void restore_user(const string& record, user_info& user) {
+  user_record_header header;
+  memcpy(&header, record.data(), sizeof(header));
+  const char* p = record.data() + sizeof(header);
+  for (uint32_t i = 0; i < header.n_friends; ++i, p += sizeof(uint64_t)) {
+    uint64_t friend_id;
+    memcpy(&friend_id, p, sizeof(friend_id));
+    user.add_friend(friend_id);
+  }
+
+  // the purchases are stored most recent first, so the oldest is added first
+  for (uint32_t i = header.n_purchases; i-- > 0;) {
+    const char* purchase = p + i * purchase_bytes;
+    uint64_t purchase_time, purchase_order;
+    double amount;
+    memcpy(&purchase_time, purchase, sizeof(purchase_time));
+    memcpy(&purchase_order, purchase + sizeof(uint64_t), sizeof(purchase_order));
+    memcpy(&amount, purchase + sizeof(uint64_t) * 2, sizeof(amount));
+    user.update_purchases(purchase_time, purchase_order, amount,
+        numeric_limits<size_t>::max());
+  }
+}
+
+bool commit_checkpoint_file(const string& fname_tmp, const string& fname) {
+  const size_t slash = fname.rfind('/');
+  const string dir = slash == string::npos ? "." : fname.substr(0, slash + 1);
+  if (!sync_path(fname_tmp) || rename(fname_tmp.c_str(), fname.c_str()) != 0
+      || !sync_path(dir)) {
+    remove(fname_tmp.c_str());
+    return false;
+  }
+  return true;
+}
+
+bool compact_checkpoints(const string& fname_snapshot, const uint64_t last_delta) {
+  ifstream in_base(fname_snapshot, ios::binary);
+  checkpoint_header header;
+  uint64_t n_base_users = 0;
+  if (!read_checkpoint_header(in_base, base_snapshot_magic, header, n_base_users))
+    return false;
+  const uint64_t first_delta = header.delta_sequence + 1;
+
+  // the latest record of every user changed in the deltas
+  unordered_map<user_id_t, string> changed_users;
+  user_id_t user_id;
+  string record;
+  for (uint64_t sequence = first_delta; sequence <= last_delta; ++sequence) {
+    ifstream in_delta(delta_checkpoint_name(fname_snapshot, sequence), ios::binary);
+    uint64_t n_users = 0;
+    if (!read_checkpoint_header(in_delta, delta_checkpoint_magic, header, n_users))
+      return false;
+    for (uint64_t i = 0; i < n_users; ++i) {
+      if (!read_user_record(in_delta, user_id, record))
+        return false;
+      changed_users[user_id].swap(record);
+    }
+  }
+
+  // copy the base, replacing the changed users, then add the new users;
+  // the header of the last delta describes the new base
+  const string fname_tmp = fname_snapshot + ".compact";
+  ofstream out(fname_tmp, ios::binary | ios::trunc);
+  header.delta_sequence = last_delta;
+  write_checkpoint_header(out, base_snapshot_magic, header, 0);
+  uint64_t n_users = 0;
+  for (uint64_t i = 0; i < n_base_users; ++i) {
+    if (!read_user_record(in_base, user_id, record))
+      return false;
+    const auto iter_changed = changed_users.find(user_id);
+    if (iter_changed != changed_users.end()) {
+      out.write(iter_changed->second.data(), iter_changed->second.size());
+      changed_users.erase(iter_changed);
+    } else
+      out.write(record.data(), record.size());
+    ++n_users;
+  }
+  for (const auto& changed : changed_users) {
+    out.write(changed.second.data(), changed.second.size());
+    ++n_users;
+  }
+  out.seekp(0);
+  write_checkpoint_header(out, base_snapshot_magic, header, n_users);
+  out.close();
+  if (!out || !commit_checkpoint_file(fname_tmp, fname_snapshot))
+    return false;
+
+  // the merged deltas are no longer read
+  for (uint64_t sequence = first_delta; sequence <= last_delta; ++sequence)
+    remove(delta_checkpoint_name(fname_snapshot, sequence).c_str());
+  return true;
+}
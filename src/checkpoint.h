@@ -0,0 +1,105 @@
+/*
+ * checkpoint.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef CHECKPOINT_H_
+#define CHECKPOINT_H_
+
+#include <cstdint>
+#include <string>
+#include <iosfwd>
+#include "user_info.h"
+
+// The state of the network is checkpointed to a chain of files:
+//   FILE          base snapshot with every user
+//   FILE.delta.N  delta N with the users changed since delta N-1 (or the base)
+// Both start with a magic string, a checkpoint_header and the number of users,
+// followed by one record per user: the user id, the numbers of friends and
+// purchases, the friend ids and the purchases (time, order, amount), most
+// recent first. Each file is written under a temporary name, synced and
+// renamed into place, so a file in the chain is always complete.
+// A base lists the last delta it includes; loading applies the base and then
+// the following deltas in order, a later record of a user replacing the earlier.
+
+// the first bytes of a base snapshot and of a delta
+extern const char base_snapshot_magic[8];
+extern const char delta_checkpoint_magic[8];
+
+// checkpoint_header holds the parameters and the position of the stream
+struct checkpoint_header {
+  uint64_t D;
+  uint64_t T;
+  uint64_t purchase_order;
+  // sequence number of the last event in the write-ahead log included
+  uint64_t wal_sequence;
+  uint64_t latest_time;
+  // id of the checkpoint (base or delta), counted over the whole run
+  uint64_t snapshot_id;
+  // byte offset of the next line of the stream log
+  uint64_t stream_offset;
+  // bytes written to the output
+  uint64_t output_bytes;
+  // the last delta included: the delta's own number, or in a base,
+  // the number of the last delta compacted into it
+  uint64_t delta_sequence;
+};
+
+// function to obtain the file name of a delta
+// inputs: fname_snapshot - name of the base snapshot
+//         sequence - number of the delta
+// return: the file name
+std::string delta_checkpoint_name(const std::string& fname_snapshot,
+    const uint64_t sequence);
+
+// function to write the beginning of a base or a delta
+// inputs: out - output stream
+//         magic - base_snapshot_magic or delta_checkpoint_magic
+//         header - the checkpoint header
+//         n_users - the number of user records that follow
+void write_checkpoint_header(std::ostream& out, const char* magic,
+    const checkpoint_header& header, const uint64_t n_users);
+
+// function to read the beginning of a base or a delta
+// inputs:  in - input stream
+//          magic - the expected magic string
+// outputs: header - reference to the checkpoint header
+//          n_users - reference to the number of user records that follow
+// return:  true if the magic string matches and the header is read
+bool read_checkpoint_header(std::istream& in, const char* magic,
+    checkpoint_header& header, uint64_t& n_users);
+
+// function to write the record of a user
+// inputs: out - output stream
+//         user_id, user - the user
+void write_user_record(std::ostream& out, const user_id_t user_id, const user_info& user);
+
+// function to read the record of a user as raw bytes
+// inputs:  in - input stream
+// outputs: user_id - reference to the user id
+//          record - reference to the whole record
+// return:  true if a complete record is read
+bool read_user_record(std::istream& in, user_id_t& user_id, std::string& record);
+
+// function to fill a user from a record
+// inputs:  record - a record read with read_user_record
+// outputs: user - reference to an empty user
+void restore_user(const std::string& record, user_info& user);
+
+// function to sync a file written under a temporary name and rename it into place
+// inputs: fname_tmp - the temporary file
+//         fname - the final name
+// return: true if the file is durable under the final name
+bool commit_checkpoint_file(const std::string& fname_tmp, const std::string& fname);
+
+// function to merge deltas into a new base snapshot, then remove them;
+//          only the files are read, so it may run in a background thread
+//          while later deltas are written
+// inputs: fname_snapshot - name of the base snapshot
+//         last_delta - number of the last delta to merge
+// return: true if the new base is in place
+bool compact_checkpoints(const std::string& fname_snapshot, const uint64_t last_delta);
+
+#endif /* CHECKPOINT_H_ */
@@ -0,0 +1,103 @@
+/*
+ * convert_event_log.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ *
+ * converts a batch_log.json or stream_log.json to the binary event format
+ * (binary_event_log.h), which anomaly_detection reads in place of the json
+ * log. Lines the engine would skip are skipped with the same messages. The
+ * engine writes a flagged purchase of a binary log in the layout of the logs
+ * in log_input, so the purchases whose lines are laid out differently are
+ * counted: their output lines would differ from those of the json log.
+ *
+ * usage: convert_event_log input.json output.bin
+ */
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <string>
+#include <stdexcept>
+#include <cstdlib>
+#include "binary_event_log.h"
+#include "event.h"
+
+using namespace std;
+using namespace rapidjson;
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    cerr << "usage: " << argv[0] << " input.json output.bin" << endl;
+    return EXIT_FAILURE;
+  }
+  ifstream in(argv[1]);
+  if (in.fail()) {
+    cerr << "Error: cannot open " << argv[1] << endl;
+    return EXIT_FAILURE;
+  }
+  binary_event_writer writer;
+  if (!writer.open(argv[2])) {
+    cerr << "Error: cannot create " << argv[2] << endl;
+    return EXIT_FAILURE;
+  }
+
+  const auto start = chrono::steady_clock::now();
+  size_t lines = 0, records = 0, skipped = 0, relaid_purchases = 0;
+  uint64_t input_bytes = 0;
+  event e;
+  binary_record r;
+  for (string line; getline(in, line);) {
+    ++lines;
+    input_bytes += line.size() + 1;
+    if (line.empty())
+      continue;
+
+    Document doc;
+    doc.Parse(line.c_str());
+    if (!doc.IsObject()) {
+      cerr << "Error: doc is not object" << endl;
+      ++skipped;
+      continue;
+    }
+
+    try {
+      if (doc.HasMember("D")) {
+        r = binary_record();
+        r.type = binary_record_type::parameters;
+        r.D = stoi(doc["D"].GetString());
+        r.T = stoi(doc["T"].GetString());
+      } else if (doc.HasMember("event_type")) {
+        if (!read_event(doc, e)) {
+          ++skipped;
+          continue;
+        }
+        make_binary_record(e, e.kind == event_kind::purchase ?
+            doc["amount"].GetString() : "", r);
+        if (e.kind == event_kind::purchase && format_event_line(r) != line)
+          ++relaid_purchases;
+      } else {
+        cerr << "Error: event_type is present in this line" << endl;
+        ++skipped;
+        continue;
+      }
+    } catch (const logic_error& error) {
+      cerr << "Error: invalid number in line " << lines << ": " << error.what() << endl;
+      ++skipped;
+      continue;
+    }
+    writer.write(r);
+    ++records;
+  }
+  if (!writer.close()) {
+    cerr << "Error: cannot write " << argv[2] << endl;
+    return EXIT_FAILURE;
+  }
+
+  const double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  cout << "lines " << lines << ", records " << records << ", skipped " << skipped << "\n"
+      << "bytes " << input_bytes << " -> " << writer.bytes() << "\n"
+      << "purchases laid out differently from log_input " << relaid_purchases << "\n"
+      << "seconds " << seconds << "\n";
+  return EXIT_SUCCESS;
+}
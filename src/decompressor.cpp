@@ -0,0 +1,366 @@
+/*
+ * decompressor.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <zlib.h>
+#include "decompressor.h"
+
+using namespace std;
+
+// the size and the number of the decompressed chunks, and the size of the
+// compressed reads
+static const size_t chunk_size = 1 << 20;
+static const size_t n_chunks = 4;
+static const size_t input_size = 1 << 18;
+
+compression_format detect_compression(const string& fname) {
+  unsigned char magic[4] = {0, 0, 0, 0};
+  const int fd = ::open(fname.c_str(), O_RDONLY);
+  if (fd < 0)
+    return compression_format::none;
+  const ssize_t n = ::read(fd, magic, sizeof(magic));
+  ::close(fd);
+  if (n >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+    return compression_format::gzip;
+  if (n == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+    return compression_format::zstd;
+  return compression_format::none;
+}
+
+const char* compression_name(const compression_format format) {
+  switch (format) {
+    case compression_format::gzip:
+      return "gzip";
+    case compression_format::zstd:
+      return "zstd";
+    default:
+      return "none";
+  }
+}
+
+// the part of the libzstd streaming API that is used; the library is loaded
+// at run time, so that the program does not need it unless a log is zstd
+namespace {
+
+struct zstd_in_buffer {
+  const void* src;
+  size_t size;
+  size_t pos;
+};
+
+struct zstd_out_buffer {
+  void* dst;
+  size_t size;
+  size_t pos;
+};
+
+struct zstd_api {
+  void* handle = nullptr;
+  void* (*create_dstream)() = nullptr;
+  size_t (*init_dstream)(void*) = nullptr;
+  size_t (*decompress_stream)(void*, zstd_out_buffer*, zstd_in_buffer*) = nullptr;
+  size_t (*free_dstream)(void*) = nullptr;
+  unsigned (*is_error)(size_t) = nullptr;
+  const char* (*get_error_name)(size_t) = nullptr;
+};
+
+// function to load libzstd once
+// return: the API, whose handle is null if the library cannot be loaded
+const zstd_api& load_zstd() {
+  static const zstd_api api = [] {
+    zstd_api loaded;
+    void* handle = dlopen("libzstd.so.1", RTLD_NOW);
+    if (handle == nullptr)
+      handle = dlopen("libzstd.so", RTLD_NOW);
+    if (handle == nullptr)
+      return loaded;
+    loaded.create_dstream = reinterpret_cast<void* (*)()>(
+        dlsym(handle, "ZSTD_createDStream"));
+    loaded.init_dstream = reinterpret_cast<size_t (*)(void*)>(
+        dlsym(handle, "ZSTD_initDStream"));
+    loaded.decompress_stream = reinterpret_cast<size_t (*)(void*, zstd_out_buffer*,
+        zstd_in_buffer*)>(dlsym(handle, "ZSTD_decompressStream"));
+    loaded.free_dstream = reinterpret_cast<size_t (*)(void*)>(
+        dlsym(handle, "ZSTD_freeDStream"));
+    loaded.is_error = reinterpret_cast<unsigned (*)(size_t)>(
+        dlsym(handle, "ZSTD_isError"));
+    loaded.get_error_name = reinterpret_cast<const char* (*)(size_t)>(
+        dlsym(handle, "ZSTD_getErrorName"));
+    if (loaded.create_dstream && loaded.init_dstream && loaded.decompress_stream
+        && loaded.free_dstream && loaded.is_error && loaded.get_error_name)
+      loaded.handle = handle;
+    else
+      dlclose(handle);
+    return loaded;
+  }();
+  return api;
+}
+
+}
+
+decompressing_istream::decompressing_istream() : istream(nullptr), buffer_(*this) {
+  rdbuf(&buffer_);
+}
+
+decompressing_istream::~decompressing_istream() {
+  close();
+}
+
+bool decompressing_istream::open(const string& fname, const compression_format format) {
+  close();
+  if (format == compression_format::none)
+    return false;
+  if (format == compression_format::zstd && load_zstd().handle == nullptr) {
+    cerr << "Error: libzstd.so.1 cannot be loaded to read " << fname << endl;
+    return false;
+  }
+  fd_ = ::open(fname.c_str(), O_RDONLY);
+  if (fd_ < 0)
+    return false;
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+  format_ = format;
+  finished_ = false;
+  stopping_ = false;
+  error_.clear();
+  full_chunks_.clear();
+  free_chunks_.assign(n_chunks, vector<char>());
+  for (auto& chunk : free_chunks_)
+    chunk.reserve(chunk_size);
+  compressed_bytes_ = decompressed_bytes_ = 0;
+  decompress_seconds_ = thread_wait_seconds_ = reader_wait_seconds_ = 0.0;
+  clear();
+  thread_ = thread(&decompressing_istream::run, this);
+  return true;
+}
+
+void decompressing_istream::close() {
+  if (thread_.joinable()) {
+    {
+      lock_guard<mutex> lock(mutex_);
+      stopping_ = true;
+    }
+    emptied_.notify_all();
+    thread_.join();
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+}
+
+void decompressing_istream::run() {
+  const auto start = chrono::steady_clock::now();
+  const bool complete = format_ == compression_format::gzip ?
+      inflate_gzip() : decompress_zstd();
+  decompress_seconds_ = chrono::duration<double>(
+      chrono::steady_clock::now() - start).count() - thread_wait_seconds_;
+
+  lock_guard<mutex> lock(mutex_);
+  if (!complete && error_.empty() && !stopping_)
+    error_ = "the compressed data is truncated";
+  finished_ = true;
+  filled_.notify_all();
+}
+
+long decompressing_istream::read_input(vector<char>& input) {
+  for (;;) {
+    const ssize_t n = ::read(fd_, input.data(), input.size());
+    if (n >= 0) {
+      compressed_bytes_ += n;
+      return n;
+    }
+    if (errno != EINTR) {
+      lock_guard<mutex> lock(mutex_);
+      error_ = string("reading failed: ") + strerror(errno);
+      return -1;
+    }
+  }
+}
+
+bool decompressing_istream::take_free_chunk(vector<char>& chunk) {
+  unique_lock<mutex> lock(mutex_);
+  if (free_chunks_.empty() && !stopping_) {
+    const auto start = chrono::steady_clock::now();
+    emptied_.wait(lock, [this] {return !free_chunks_.empty() || stopping_;});
+    thread_wait_seconds_ += chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+  }
+  if (stopping_)
+    return false;
+  chunk = std::move(free_chunks_.back());
+  free_chunks_.pop_back();
+  chunk.resize(chunk_size);
+  return true;
+}
+
+void decompressing_istream::push_full_chunk(vector<char>& chunk) {
+  decompressed_bytes_ += chunk.size();
+  {
+    lock_guard<mutex> lock(mutex_);
+    full_chunks_.push_back(std::move(chunk));
+  }
+  filled_.notify_one();
+}
+
+bool decompressing_istream::inflate_gzip() {
+  z_stream z;
+  memset(&z, 0, sizeof(z));
+  // 15 + 32: the largest window, with the gzip header detected
+  if (inflateInit2(&z, 15 + 32) != Z_OK) {
+    lock_guard<mutex> lock(mutex_);
+    error_ = "zlib cannot be initialized";
+    return false;
+  }
+  vector<char> input(input_size), chunk;
+  bool in_member = true, end_of_input = false, failed = false;
+  while (!failed && !(end_of_input && !in_member) && take_free_chunk(chunk)) {
+    size_t used = 0;
+    while (used < chunk.size()) {
+      if (z.avail_in == 0 && !end_of_input) {
+        const long n = read_input(input);
+        failed = n < 0;
+        end_of_input = n <= 0;
+        z.next_in = reinterpret_cast<Bytef*>(input.data());
+        z.avail_in = static_cast<uInt>(max(n, 0L));
+      }
+      if (failed || (end_of_input && !in_member))
+        break;
+      // another member may follow the end of one (as written by cat a.gz b.gz)
+      if (!in_member) {
+        inflateReset(&z);
+        in_member = true;
+      }
+      z.next_out = reinterpret_cast<Bytef*>(chunk.data() + used);
+      z.avail_out = static_cast<uInt>(chunk.size() - used);
+      const int status = inflate(&z, Z_NO_FLUSH);
+      const size_t produced = chunk.size() - z.avail_out - used;
+      used += produced;
+      if (status == Z_STREAM_END) {
+        in_member = false;
+      } else if (status != Z_OK && status != Z_BUF_ERROR) {
+        lock_guard<mutex> lock(mutex_);
+        error_ = string("gzip data is corrupted: ") + (z.msg ? z.msg : "unknown error");
+        failed = true;
+      } else if (end_of_input && produced == 0) {
+        // the input ends inside a member
+        failed = true;
+      }
+      if (failed)
+        break;
+    }
+    chunk.resize(used);
+    if (used > 0)
+      push_full_chunk(chunk);
+  }
+  inflateEnd(&z);
+  return !failed && end_of_input && !in_member;
+}
+
+bool decompressing_istream::decompress_zstd() {
+  const zstd_api& zstd = load_zstd();
+  void* stream = zstd.create_dstream();
+  if (stream == nullptr || zstd.is_error(zstd.init_dstream(stream))) {
+    if (stream != nullptr)
+      zstd.free_dstream(stream);
+    lock_guard<mutex> lock(mutex_);
+    error_ = "zstd cannot be initialized";
+    return false;
+  }
+  vector<char> input(input_size), chunk;
+  zstd_in_buffer in = {input.data(), 0, 0};
+  // 0 once a frame has been completely decoded and flushed
+  size_t remaining = 0;
+  bool end_of_input = false, failed = false;
+  while (!failed && !(end_of_input && remaining == 0) && take_free_chunk(chunk)) {
+    zstd_out_buffer out = {chunk.data(), chunk.size(), 0};
+    while (out.pos < out.size) {
+      if (in.pos == in.size && !end_of_input) {
+        const long n = read_input(input);
+        failed = n < 0;
+        end_of_input = n <= 0;
+        in.size = static_cast<size_t>(max(n, 0L));
+        in.pos = 0;
+      }
+      if (failed || (end_of_input && remaining == 0))
+        break;
+      // the next frame, if any, is read by the same call after one ends
+      const size_t before = out.pos;
+      remaining = zstd.decompress_stream(stream, &out, &in);
+      if (zstd.is_error(remaining)) {
+        lock_guard<mutex> lock(mutex_);
+        error_ = string("zstd data is corrupted: ") + zstd.get_error_name(remaining);
+        failed = true;
+      } else if (end_of_input && out.pos == before) {
+        // the input ends inside a frame
+        failed = true;
+      }
+      if (failed)
+        break;
+    }
+    chunk.resize(out.pos);
+    if (out.pos > 0)
+      push_full_chunk(chunk);
+  }
+  zstd.free_dstream(stream);
+  return !failed && end_of_input && remaining == 0;
+}
+
+bool decompressing_istream::next_chunk(vector<char>& chunk) {
+  unique_lock<mutex> lock(mutex_);
+  if (chunk.capacity() > 0) {
+    chunk.clear();
+    free_chunks_.push_back(std::move(chunk));
+    chunk = vector<char>();
+    emptied_.notify_one();
+  }
+  if (full_chunks_.empty() && !finished_) {
+    const auto start = chrono::steady_clock::now();
+    filled_.wait(lock, [this] {return !full_chunks_.empty() || finished_;});
+    reader_wait_seconds_ += chrono::duration<double>(
+        chrono::steady_clock::now() - start).count();
+  }
+  if (full_chunks_.empty()) {
+    // the end of the data, reported once
+    if (!error_.empty()) {
+      cerr << "Error: " << compression_name(format_) << " log: " << error_ << endl;
+      error_.clear();
+    }
+    return false;
+  }
+  chunk = std::move(full_chunks_.front());
+  full_chunks_.pop_front();
+  return true;
+}
+
+decompressing_istream::chunk_buffer::int_type
+decompressing_istream::chunk_buffer::underflow() {
+  if (gptr() < egptr())
+    return traits_type::to_int_type(*gptr());
+  if (!owner_.next_chunk(chunk_)) {
+    setg(nullptr, nullptr, nullptr);
+    return traits_type::eof();
+  }
+  setg(chunk_.data(), chunk_.data(), chunk_.data() + chunk_.size());
+  return traits_type::to_int_type(*gptr());
+}
+
+void decompressing_istream::print_stats(ostream& out, const char* name) {
+  close();
+  out << name << " " << compression_name(format_) << " bytes: " << compressed_bytes_
+      << " -> " << decompressed_bytes_ << "\n"
+      << name << " decompression seconds: " << decompress_seconds_
+      << " (parser waiting " << reader_wait_seconds_
+      << ", decompressor waiting " << thread_wait_seconds_ << ")\n";
+}
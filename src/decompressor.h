@@ -0,0 +1,134 @@
+/*
+ * decompressor.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef DECOMPRESSOR_H_
+#define DECOMPRESSOR_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <istream>
+#include <streambuf>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+
+// the compression of an input log, recognized by its first bytes
+enum class compression_format {
+  none,
+  gzip,
+  zstd
+};
+
+// function to recognize the compression of a file
+// input:  fname - name of the file
+// return: gzip (1f 8b), zstd (28 b5 2f fd), or none
+compression_format detect_compression(const std::string& fname);
+
+// function to obtain the name of a compression format
+const char* compression_name(const compression_format format);
+
+// decompressing_istream reads a gzip or zstd file as the text it holds. A
+// thread reads and decompresses the file into a few large chunks, which the
+// reader takes in turn through the stream buffer, so the decompression of
+// the next chunks overlaps the parsing of the current one. Concatenated gzip
+// members and zstd frames are read one after another. gzip is read with zlib;
+// zstd with libzstd.so.1, loaded when a zstd file is opened.
+class decompressing_istream : public std::istream {
+  private:
+    // the stream buffer handing out the decompressed chunks
+    class chunk_buffer : public std::streambuf {
+      private:
+        decompressing_istream& owner_;
+        std::vector<char> chunk_{};
+
+      protected:
+        int_type underflow() override;
+
+      public:
+        explicit chunk_buffer(decompressing_istream& owner) : owner_(owner) {}
+    };
+
+    chunk_buffer buffer_;
+    int fd_ = -1;
+    compression_format format_ = compression_format::none;
+    std::thread thread_{};
+
+    // the chunks filled by the thread, and the empty ones it can fill
+    std::mutex mutex_{};
+    std::condition_variable filled_{};
+    std::condition_variable emptied_{};
+    std::deque<std::vector<char>> full_chunks_{};
+    std::vector<std::vector<char>> free_chunks_{};
+    bool finished_ = false;
+    std::atomic<bool> stopping_{false};
+    std::string error_{};
+
+    // counters; those of the thread are read after it is joined
+    uint64_t compressed_bytes_ = 0;
+    uint64_t decompressed_bytes_ = 0;
+    double decompress_seconds_ = 0.0;
+    double thread_wait_seconds_ = 0.0;
+    double reader_wait_seconds_ = 0.0;
+
+    // function run by the thread: decompress the file into chunks
+    void run();
+
+    // function to decompress a gzip file
+    // return: true if the whole file is decompressed
+    bool inflate_gzip();
+
+    // function to decompress a zstd file
+    // return: true if the whole file is decompressed
+    bool decompress_zstd();
+
+    // function to read the next compressed bytes of the file
+    // output: input - reference to the buffer receiving the bytes
+    // return: the number of bytes, 0 at the end of the file, -1 on an error
+    long read_input(std::vector<char>& input);
+
+    // function to obtain an empty chunk, waiting while the reader holds all of them
+    // output: chunk - reference to the chunk
+    // return: false once the stream is closed
+    bool take_free_chunk(std::vector<char>& chunk);
+
+    // function to queue a filled chunk for the reader
+    // input: chunk - the chunk (moved)
+    void push_full_chunk(std::vector<char>& chunk);
+
+    // function to take the next filled chunk, returning the previous one
+    // output: chunk - reference to the previous chunk, replaced by the next one
+    // return: false at the end of the data
+    bool next_chunk(std::vector<char>& chunk);
+
+  public:
+    decompressing_istream();
+    // destructor: stops the thread and closes the file
+    ~decompressing_istream();
+
+    decompressing_istream(const decompressing_istream&) = delete;
+    decompressing_istream& operator=(const decompressing_istream&) = delete;
+
+    // function to open a compressed file and start decompressing it
+    // inputs: fname - name of the file
+    //         format - gzip or zstd
+    // return: true if the file is opened (and libzstd is loaded for zstd)
+    bool open(const std::string& fname, const compression_format format);
+
+    // function to stop the thread and close the file
+    void close();
+
+    // function to write the counters of the decompression to a stream, once
+    //         the thread is stopped
+    // inputs: out - output stream
+    //         name - the name of the log in the messages
+    void print_stats(std::ostream& out, const char* name);
+};
+
+#endif /* DECOMPRESSOR_H_ */
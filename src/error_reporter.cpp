@@ -0,0 +1,83 @@
+/*
+ * error_reporter.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include "error_reporter.h"
+
+using namespace std;
+
+const char* input_error_name(const input_error kind) {
+  switch (kind) {
+    case input_error::not_object:
+      return "lines not a JSON object";
+    case input_error::missing_event_type:
+      return "lines without event_type";
+    case input_error::unknown_event_type:
+      return "unknown event types";
+    case input_error::invalid_member:
+      return "missing or invalid members";
+    case input_error::same_user:
+      return "befriend or unfriend events for the same user";
+    case input_error::missing_user:
+      return "users not found in a network";
+  }
+  return "unknown errors";
+}
+
+bool error_reporter::count(const input_error kind) {
+  const uint64_t n = ++counts_[static_cast<size_t>(kind)];
+  if (n <= first_messages_) {
+    ++printed_;
+    return true;
+  }
+  // the first error past the messages in full says how the following ones
+  // are sampled; the caller has written the last of those messages by now
+  if (n == first_messages_ + 1 && message_interval_ != 1) {
+    cerr << "Note: further errors of this kind (" << input_error_name(kind) << ") are "
+        << (message_interval_ == 0 ? "only counted" :
+            "reported once every " + to_string(message_interval_)) << '\n';
+  }
+  if (message_interval_ == 0 || (n - first_messages_) % message_interval_ != 0)
+    return false;
+  ++printed_;
+  return true;
+}
+
+void error_reporter::report(const input_error kind, const string& message) {
+  if (count(kind))
+    cerr << message;
+}
+
+void error_reporter::reject(const input_error kind, const string& message, const string& line) {
+  report(kind, message);
+  ++rejected_lines_;
+  if (rejected_log_ != nullptr)
+    *rejected_log_ << line << '\n';
+}
+
+uint64_t error_reporter::total() const {
+  uint64_t n = 0;
+  for (const uint64_t c : counts_)
+    n += c;
+  return n;
+}
+
+void error_reporter::print_summary(ostream& out) const {
+  const uint64_t n = total();
+  if (n == 0)
+    return;
+  out << "Input errors: " << n << " (";
+  const char* separator = "";
+  for (size_t k = 0; k < n_input_errors; ++k) {
+    if (counts_[k] == 0)
+      continue;
+    out << separator << input_error_name(static_cast<input_error>(k)) << " " << counts_[k];
+    separator = ", ";
+  }
+  out << "), messages written: " << printed_ << ", rejected lines: " << rejected_lines_
+      << (rejected_log_ != nullptr ? " (copied to the rejected log)" : "") << "\n";
+}
@@ -0,0 +1,98 @@
+/*
+ * error_reporter.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef ERROR_REPORTER_H_
+#define ERROR_REPORTER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <ostream>
+
+// the kinds of errors found in the input logs
+enum class input_error {
+  // a line that is not a JSON object
+  not_object,
+  // an object without event_type (the message keeps its historical wording)
+  missing_event_type,
+  // an event type other than purchase, befriend and unfriend
+  unknown_event_type,
+  // a member that is missing, not a string, or not a number where one is read
+  invalid_member,
+  // a befriend or unfriend event between a user and itself
+  same_user,
+  // a user in a network that can not be found
+  missing_user
+};
+
+// the number of kinds of input errors
+static const std::size_t n_input_errors = 6;
+
+// function to name a kind of input error in the summary
+// input:  kind - the kind of error
+// return: its name
+const char* input_error_name(const input_error kind);
+
+// error_reporter counts the errors of the input logs by kind and samples
+// their messages: the first few of every kind are written to stderr, then
+// only every Kth, so that a log with millions of bad lines is not slowed
+// down by millions of unbuffered writes. The rejected lines may be copied
+// to a side file, and a summary of the counts is written at the end. It is
+// used by the thread applying the events.
+class error_reporter {
+  private:
+    // the messages of every kind written before sampling starts
+    std::size_t first_messages_ = 10;
+    // then one message of every this many (0: none)
+    std::size_t message_interval_ = 1000;
+    // stream receiving the rejected lines (nullptr: they are only counted)
+    std::ostream* rejected_log_ = nullptr;
+    uint64_t counts_[n_input_errors] = {};
+    uint64_t printed_ = 0;
+    uint64_t rejected_lines_ = 0;
+
+  public:
+    // function to set how the messages are sampled
+    // inputs: first_messages - the messages of every kind written in full
+    //         message_interval - after them, write one message of every this
+    //                            many (0: no more, 1: every message)
+    void set_sampling(const std::size_t first_messages, const std::size_t message_interval) {
+      first_messages_ = first_messages;
+      message_interval_ = message_interval;
+    }
+
+    // function to set a stream receiving the rejected lines
+    // input: rejected_log - output stream, nullptr to only count them
+    void set_rejected_log(std::ostream* rejected_log) {rejected_log_ = rejected_log;}
+
+    // function to count an error and decide whether its message is written
+    // input:  kind - the kind of error
+    // return: true if the caller writes the message of this error to stderr
+    bool count(const input_error kind);
+
+    // function to count an error and write its message if it is sampled
+    // inputs: kind - the kind of error
+    //         message - the message, ending with a newline
+    void report(const input_error kind, const std::string& message);
+
+    // function to count an error of a line that is skipped, write its message
+    //          if it is sampled, and copy the line to the rejected log
+    // inputs: kind - the kind of error
+    //         message - the message, ending with a newline
+    //         line - the rejected line
+    void reject(const input_error kind, const std::string& message, const std::string& line);
+
+    // function to obtain the number of errors of all kinds
+    // return: the number of errors
+    uint64_t total() const;
+
+    // function to write the counts of the errors and of the messages not written
+    // input: out - output stream
+    void print_summary(std::ostream& out) const;
+};
+
+#endif /* ERROR_REPORTER_H_ */
@@ -0,0 +1,122 @@
+/*
+ * event.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <stdexcept>
+#include "event.h"
+
+using namespace std;
+using namespace rapidjson;
+
+// function to find a member holding a string
+// inputs:  entry - rapidjson object
+//          name - the name of the member
+// outputs: value - reference to the string
+//          err - stream receiving the error message
+// return:  true if the member is present and a string, false otherwise
+static bool read_string_member(const Document& entry, const char* name, const char*& value,
+    ostream& err) {
+  const Value::ConstMemberIterator member = entry.FindMember(name);
+  if (member == entry.MemberEnd() || !member->value.IsString()) {
+    err << "Error: " << name << " is missing or not a string in this line" << endl;
+    return false;
+  }
+  value = member->value.GetString();
+  return true;
+}
+
+// function to read a member holding an integer
+// inputs:  entry - rapidjson object
+//          name - the name of the member
+// outputs: value - reference to the integer
+//          err - stream receiving the error message
+// return:  true if the member is a string that stoi reads, false otherwise
+static bool read_int_member(const Document& entry, const char* name, int& value,
+    ostream& err) {
+  const char* text;
+  if (!read_string_member(entry, name, text, err))
+    return false;
+  try {
+    value = stoi(text);
+    return true;
+  } catch (const invalid_argument&) {
+  } catch (const out_of_range&) {
+  }
+  err << "Error: invalid " << name << " in this line: " << text << endl;
+  return false;
+}
+
+// function to read a member holding a double
+// inputs:  entry - rapidjson object
+//          name - the name of the member
+// outputs: value - reference to the double
+//          err - stream receiving the error message
+// return:  true if the member is a string that stod reads, false otherwise
+static bool read_double_member(const Document& entry, const char* name, double& value,
+    ostream& err) {
+  const char* text;
+  if (!read_string_member(entry, name, text, err))
+    return false;
+  try {
+    value = stod(text);
+    return true;
+  } catch (const invalid_argument&) {
+  } catch (const out_of_range&) {
+  }
+  err << "Error: invalid " << name << " in this line: " << text << endl;
+  return false;
+}
+
+bool read_event(const Document& entry, event& e) {
+  input_error error;
+  return read_event(entry, e, cerr, error);
+}
+
+bool read_event(const Document& entry, event& e, ostream& err, input_error& error) {
+
+  error = input_error::invalid_member;
+  const char* type;
+  const char* timestamp;
+  if (!read_string_member(entry, "event_type", type, err)
+      || !read_string_member(entry, "timestamp", timestamp, err))
+    return false;
+  string event_type = type;
+
+  int id1, id2 = 0;
+  double amount = 0.0;
+  if (!event_type.compare("purchase")) {
+    if (!read_int_member(entry, "id", id1, err)
+        || !read_double_member(entry, "amount", amount, err))
+      return false;
+    e.kind = event_kind::purchase;
+  } else if (!event_type.compare("befriend") || !event_type.compare("unfriend")) {
+    if (!read_int_member(entry, "id1", id1, err) || !read_int_member(entry, "id2", id2, err))
+      return false;
+    e.kind = !event_type.compare("befriend") ? event_kind::befriend : event_kind::unfriend;
+  } else {
+    error = input_error::unknown_event_type;
+    err << "Error: can not recognize this event type: "
+        << event_type << endl;
+    return false;
+  }
+
+  e.timestamp = timestamp;
+  e.time = convert_string2timet(e.timestamp);
+  e.id1 = id1;
+  e.id2 = id2;
+  e.amount = amount;
+  return true;
+}
+
+bool read_parameters(const Document& entry, size_t& D, size_t& T, ostream& err) {
+  int value_D, value_T;
+  if (!read_int_member(entry, "D", value_D, err) || !read_int_member(entry, "T", value_T, err))
+    return false;
+  D = value_D;
+  T = value_T;
+  return true;
+}
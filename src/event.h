@@ -0,0 +1,69 @@
+/*
+ * event.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef EVENT_H_
+#define EVENT_H_
+
+#include <string>
+#include <iosfwd>
+#include "user_info.h"
+#include "error_reporter.h"
+#include "include/rapidjson/document.h"
+
+// the kinds of events in batch_log.json and stream_log.json
+enum class event_kind {
+  purchase,
+  befriend,
+  unfriend
+};
+
+// event stores one line of an input log after it is parsed
+struct event {
+  event_kind kind;
+  // the timestamp as written in the log
+  std::string timestamp;
+  // the timestamp in seconds since the epoch
+  uint64_t time;
+  // the buyer of a purchase, or the first user of a befriend/unfriend event
+  user_id_t id1;
+  // the second user of a befriend/unfriend event
+  user_id_t id2;
+  // purchase amount
+  double amount;
+  // the original line, used to write flagged purchases
+  std::string line;
+};
+
+// function to read an event from a parsed line of an input log
+// inputs:  entry - rapidjson object containing an event and its information
+// outputs: e - reference to the event (the line is not filled)
+// return:  true if the event is a purchase, befriend or unfriend event
+//          with valid members, false otherwise (an error is reported)
+bool read_event(const rapidjson::Document& entry, event& e);
+
+// function to read an event from a parsed line of an input log
+//          reporting errors to a given stream
+// inputs:  entry - rapidjson object containing an event and its information
+// outputs: e - reference to the event (the line is not filled)
+//          err - stream receiving the error message
+//          error - reference to the kind of error (unknown_event_type, or
+//                  invalid_member for a member that is missing, not a
+//                  string or not a number)
+// return:  true if the event is a purchase, befriend or unfriend event
+//          false otherwise
+bool read_event(const rapidjson::Document& entry, event& e, std::ostream& err,
+    input_error& error);
+
+// function to read D and T from the first line of a batch log
+// inputs:  entry - rapidjson object containing D and T
+// outputs: D, T - references to the parameters (unchanged on an error)
+//          err - stream receiving the error message
+// return:  true if both are strings holding numbers, false otherwise
+bool read_parameters(const rapidjson::Document& entry, std::size_t& D, std::size_t& T,
+    std::ostream& err);
+
+#endif /* EVENT_H_ */
@@ -0,0 +1,488 @@
+/*
+ * event_scanner.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <cstring>
+#include <stdexcept>
+#include <cstdint>
+#include "event_scanner.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define EVENT_SCANNER_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+// longer lines are left to rapidjson; the lines of the logs are about 100 bytes
+static const size_t max_line_length = 256;
+static const size_t mask_words = max_line_length / 64;
+
+// line_masks has a bit for every byte of a line: bit i of word i / 64
+struct line_masks {
+  uint64_t quotes[mask_words];
+  uint64_t backslashes[mask_words];
+  // bytes below 0x20: whitespace between the members, invalid in a string
+  uint64_t controls[mask_words];
+};
+
+typedef void (*find_characters_t)(const char* text, const size_t blocks, line_masks& masks);
+
+// function to set the bits of the quotes, backslashes and control characters
+// inputs:  text - the line, padded with spaces to a multiple of 16 bytes
+//          blocks - the number of 16-byte blocks
+// outputs: masks - reference to the masks (zeroed by the caller)
+static void find_characters_scalar(const char* text, const size_t blocks, line_masks& masks) {
+  for (size_t i = 0; i < blocks * 16; ++i) {
+    const unsigned char c = text[i];
+    const uint64_t bit = uint64_t(1) << (i % 64);
+    if (c == '"')
+      masks.quotes[i / 64] |= bit;
+    else if (c == '\\')
+      masks.backslashes[i / 64] |= bit;
+    else if (c < 0x20)
+      masks.controls[i / 64] |= bit;
+  }
+}
+
+#ifdef EVENT_SCANNER_X86
+
+__attribute__((target("sse2")))
+static void find_characters_sse2(const char* text, const size_t blocks, line_masks& masks) {
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i last_control = _mm_set1_epi8(0x1f);
+  for (size_t b = 0; b < blocks; ++b) {
+    const __m128i x = _mm_load_si128(reinterpret_cast<const __m128i*>(text + 16 * b));
+    // a byte is a control character if the unsigned maximum with 0x1f is 0x1f
+    const uint64_t quotes = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(x, quote)));
+    const uint64_t backslashes = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(x, backslash)));
+    const uint64_t controls = static_cast<uint32_t>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(x, last_control), last_control)));
+    const unsigned shift = (b % 4) * 16;
+    masks.quotes[b / 4] |= quotes << shift;
+    masks.backslashes[b / 4] |= backslashes << shift;
+    masks.controls[b / 4] |= controls << shift;
+  }
+}
+
+#endif /* EVENT_SCANNER_X86 */
+
+// function to select the variant supported by the CPU
+// output: name - reference to the name of the variant
+// return: the variant
+static find_characters_t select_find_characters(const char*& name) {
+#ifdef EVENT_SCANNER_X86
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("sse2")) {
+    name = "sse2";
+    return find_characters_sse2;
+  }
+#endif
+  name = "scalar";
+  return find_characters_scalar;
+}
+
+// the variant, selected when it is first used
+static const char* selected_name = nullptr;
+
+// function to obtain the selected variant
+// return: the variant
+static find_characters_t find_characters_function() {
+  static const find_characters_t selected = select_find_characters(selected_name);
+  return selected;
+}
+
+const char* event_scanner_variant() {
+  find_characters_function();
+  return selected_name;
+}
+
+// function to find the next quote of a line
+// inputs: masks - the masks of the line
+//         from - the first position to look at
+//         n - the length of the line
+// return: the position of the quote, or n if there is none
+static inline size_t next_quote(const line_masks& masks, const size_t from, const size_t n) {
+  for (size_t w = from / 64; w < mask_words; ++w) {
+    uint64_t bits = masks.quotes[w];
+    if (w == from / 64)
+      bits &= ~uint64_t(0) << (from % 64);
+    if (bits != 0) {
+      const size_t position = w * 64 + __builtin_ctzll(bits);
+      return position < n ? position : n;
+    }
+  }
+  return n;
+}
+
+// function to check if a mask has a bit in a range of positions
+// inputs: mask - the mask
+//         from, to - the range [from, to)
+// return: true if a bit is set
+static bool any_in_range(const uint64_t* mask, const size_t from, const size_t to) {
+  for (size_t i = from; i < to; ++i) {
+    if (mask[i / 64] & (uint64_t(1) << (i % 64)))
+      return true;
+  }
+  return false;
+}
+
+// function to skip the JSON whitespace of a line
+// inputs: text, n - the line
+//         p - the first position to look at
+// return: the position of the first other byte, or n
+static inline size_t skip_whitespace(const char* text, const size_t n, size_t p) {
+  while (p < n && (text[p] == ' ' || text[p] == '\t' || text[p] == '\n' || text[p] == '\r'))
+    ++p;
+  return p;
+}
+
+// the members read by the parser, and the value of each in a line
+enum member_key {key_event_type, key_timestamp, key_id, key_amount, key_id1, key_id2,
+  key_D, key_T, n_member_keys, key_unknown = n_member_keys};
+
+struct member_value {
+  const char* text = nullptr;
+  size_t length = 0;
+};
+
+// function to identify the key of a member
+// inputs: key, length - the key without its quotes
+// return: the key, or key_unknown
+static member_key find_member_key(const char* key, const size_t length) {
+  switch (length) {
+    case 1:
+      return key[0] == 'D' ? key_D : key[0] == 'T' ? key_T : key_unknown;
+    case 2:
+      return !memcmp(key, "id", 2) ? key_id : key_unknown;
+    case 3:
+      return !memcmp(key, "id1", 3) ? key_id1 : !memcmp(key, "id2", 3) ? key_id2 : key_unknown;
+    case 6:
+      return !memcmp(key, "amount", 6) ? key_amount : key_unknown;
+    case 9:
+      return !memcmp(key, "timestamp", 9) ? key_timestamp : key_unknown;
+    case 10:
+      return !memcmp(key, "event_type", 10) ? key_event_type : key_unknown;
+  }
+  return key_unknown;
+}
+
+// function to convert a value to an integer as stoi does
+// input:  value - the value
+// output: result - reference to the integer
+// return: true if the value is converted, false where stoi throws
+static bool value_to_int(const member_value& value, int& result) {
+  // up to 9 digits cannot overflow
+  if (value.length > 0 && value.length <= 9) {
+    result = 0;
+    size_t i = 0;
+    for (; i < value.length && value.text[i] >= '0' && value.text[i] <= '9'; ++i)
+      result = result * 10 + (value.text[i] - '0');
+    if (i == value.length)
+      return true;
+  }
+  try {
+    result = stoi(string(value.text, value.length));
+  } catch (const invalid_argument&) {
+    return false;
+  } catch (const out_of_range&) {
+    return false;
+  }
+  return true;
+}
+
+// function to convert a value to a double as stod does
+// input:  value - the value
+// output: result - reference to the double
+// return: true if the value is converted, false where stod throws
+static bool value_to_double(const member_value& value, double& result) {
+  static const double powers_of_ten[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8,
+      1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+  // up to 15 digits with a point: the digits and the power of ten are exact
+  // doubles, so their quotient is the correctly rounded value stod returns
+  int64_t units = 0;
+  size_t digits = 0, decimals = 0;
+  bool point = false, plain = value.length > 0;
+  for (size_t i = 0; i < value.length && plain; ++i) {
+    const char c = value.text[i];
+    if (c >= '0' && c <= '9' && digits < 15) {
+      units = units * 10 + (c - '0');
+      ++digits;
+      decimals += point;
+    } else if (c == '.' && !point) {
+      point = true;
+    } else {
+      plain = false;
+    }
+  }
+  if (plain && digits > 0) {
+    result = static_cast<double>(units) / powers_of_ten[decimals];
+    return true;
+  }
+  try {
+    result = stod(string(value.text, value.length));
+  } catch (const invalid_argument&) {
+    return false;
+  } catch (const out_of_range&) {
+    return false;
+  }
+  return true;
+}
+
+// function to compare a value with a string
+static inline bool value_is(const member_value& value, const char* s, const size_t length) {
+  return value.length == length && !memcmp(value.text, s, length);
+}
+
+scan_result scan_event_line(const string& line, event& e, size_t& D, size_t& T) {
+  const size_t n = line.size();
+  if (n == 0 || n > max_line_length)
+    return scan_result::fallback;
+
+  // locate the characters in a copy padded to whole blocks
+  alignas(16) char text[max_line_length];
+  const size_t blocks = (n + 15) / 16;
+  memcpy(text, line.data(), n);
+  memset(text + n, ' ', blocks * 16 - n);
+  line_masks masks;
+  memset(&masks, 0, sizeof(masks));
+  find_characters_function()(text, blocks, masks);
+
+  // escapes are left to rapidjson
+  bool has_controls = false;
+  for (size_t w = 0; w < mask_words; ++w) {
+    if (masks.backslashes[w] != 0)
+      return scan_result::fallback;
+    has_controls |= masks.controls[w] != 0;
+  }
+
+  // { "key" : "value" , ... }, with the quotes taken from the mask
+  member_value values[n_member_keys];
+  size_t p = skip_whitespace(text, n, 0);
+  if (p == n || text[p] != '{')
+    return scan_result::fallback;
+  p = skip_whitespace(text, n, p + 1);
+  for (;;) {
+    if (p == n || text[p] != '"')
+      return scan_result::fallback;
+    const size_t key_start = p + 1;
+    const size_t key_end = next_quote(masks, key_start, n);
+    p = skip_whitespace(text, n, key_end + 1);
+    if (key_end == n || p == n || text[p] != ':')
+      return scan_result::fallback;
+    p = skip_whitespace(text, n, p + 1);
+    if (p == n || text[p] != '"')
+      return scan_result::fallback;
+    const size_t value_start = p + 1;
+    const size_t value_end = next_quote(masks, value_start, n);
+    if (value_end == n)
+      return scan_result::fallback;
+    // a control character is invalid inside a string
+    if (has_controls && (any_in_range(masks.controls, key_start, key_end)
+        || any_in_range(masks.controls, value_start, value_end)))
+      return scan_result::fallback;
+
+    // the first of duplicated members is used, as FindMember does
+    const member_key key = find_member_key(text + key_start, key_end - key_start);
+    if (key != key_unknown && values[key].text == nullptr) {
+      values[key].text = text + value_start;
+      values[key].length = value_end - value_start;
+    }
+
+    p = skip_whitespace(text, n, value_end + 1);
+    if (p < n && text[p] == ',') {
+      p = skip_whitespace(text, n, p + 1);
+      continue;
+    }
+    if (p < n && text[p] == '}')
+      break;
+    return scan_result::fallback;
+  }
+  if (skip_whitespace(text, n, p + 1) != n)
+    return scan_result::fallback;
+
+  // the same members are read in the same order as read_batch_log and read_event do
+  if (values[key_D].text != nullptr) {
+    int value_D, value_T;
+    if (values[key_T].text == nullptr || !value_to_int(values[key_D], value_D)
+        || !value_to_int(values[key_T], value_T))
+      return scan_result::fallback;
+    D = value_D;
+    T = value_T;
+    return scan_result::parameters;
+  }
+  const member_value& event_type = values[key_event_type];
+  if (event_type.text == nullptr || values[key_timestamp].text == nullptr)
+    return scan_result::fallback;
+  if (value_is(event_type, "purchase", 8)) {
+    if (values[key_id].text == nullptr || values[key_amount].text == nullptr)
+      return scan_result::fallback;
+    e.kind = event_kind::purchase;
+  } else if (value_is(event_type, "befriend", 8) || value_is(event_type, "unfriend", 8)) {
+    if (values[key_id1].text == nullptr || values[key_id2].text == nullptr)
+      return scan_result::fallback;
+    e.kind = event_type.text[0] == 'b' ? event_kind::befriend : event_kind::unfriend;
+  } else {
+    return scan_result::fallback;
+  }
+
+  // a value that is not a number is left to rapidjson, which reports it
+  int id1, id2 = 0;
+  double amount = 0.0;
+  if (e.kind == event_kind::purchase) {
+    if (!value_to_int(values[key_id], id1) || !value_to_double(values[key_amount], amount))
+      return scan_result::fallback;
+  } else {
+    if (!value_to_int(values[key_id1], id1) || !value_to_int(values[key_id2], id2))
+      return scan_result::fallback;
+  }
+  e.timestamp.assign(values[key_timestamp].text, values[key_timestamp].length);
+  e.time = convert_string2timet(e.timestamp);
+  e.id1 = id1;
+  e.id2 = id2;
+  e.amount = amount;
+  return scan_result::event;
+}
+
+// the layout of the lines written by the upstream systems: the members in
+// this order, separated by ", " and with ": " after the ids' and amount's keys
+// {"event_type":"purchase", "timestamp":"YYYY-MM-DD hh:mm:ss", "id": "N", "amount": "X"}
+// {"event_type":"befriend", "timestamp":"YYYY-MM-DD hh:mm:ss", "id1": "N", "id2": "N"}
+static const char trusted_prefix[] = "{\"event_type\":\"";
+static const size_t trusted_type_offset = sizeof(trusted_prefix) - 1;
+// the event type after its first byte and the key of the timestamp
+static const char trusted_purchase[] = "urchase\", \"timestamp\":\"";
+static const char trusted_befriend[] = "efriend\", \"timestamp\":\"";
+static const char trusted_unfriend[] = "nfriend\", \"timestamp\":\"";
+static const size_t trusted_timestamp_offset =
+    trusted_type_offset + 1 + sizeof(trusted_purchase) - 1;
+static const size_t trusted_timestamp_length = 19;
+// the timestamp with 'D' where a digit is expected
+static const char trusted_timestamp_shape[] = "DDDD-DD-DD DD:DD:DD";
+
+// function to match a literal at a position of a line and move past it
+// inputs: end - the end of the line
+//         p - reference to the position, moved past the literal if it matches
+//         literal, length - the literal
+// return: true if the literal is there
+static inline bool match_literal(const char* end, const char*& p, const char* literal,
+    const size_t length) {
+  if (static_cast<size_t>(end - p) < length || memcmp(p, literal, length))
+    return false;
+  p += length;
+  return true;
+}
+
+// function to check that a timestamp has the layout of the upstream systems
+// input:  p - the first byte of the timestamp (the line is long enough)
+// return: true if the digits and the separators are where they are expected
+static inline bool is_trusted_timestamp(const char* p) {
+  for (size_t i = 0; i < trusted_timestamp_length; ++i) {
+    if (trusted_timestamp_shape[i] == 'D' ? p[i] < '0' || p[i] > '9'
+        : p[i] != trusted_timestamp_shape[i])
+      return false;
+  }
+  return true;
+}
+
+// function to check that an amount is digits with at most one point
+//          (an escape or a sign is left to the strict reading)
+// inputs: first, last - the characters of the amount
+// return: true if the amount is plain
+static inline bool is_plain_amount(const char* first, const char* last) {
+  bool digit = false, point = false;
+  for (; first != last; ++first) {
+    if (*first >= '0' && *first <= '9')
+      digit = true;
+    else if (*first == '.' && !point)
+      point = true;
+    else
+      return false;
+  }
+  return digit;
+}
+
+// function to read the digits of an id value up to its closing quote
+// inputs: end - the end of the line
+//         p - reference to the first digit, moved past the closing quote
+// output: value - reference to the id
+// return: true if the value is 1 to 9 digits followed by a quote
+static inline bool read_trusted_id(const char* end, const char*& p, user_id_t& value) {
+  const char* first = p;
+  int result = 0;
+  for (; p < end && *p >= '0' && *p <= '9' && p - first < 9; ++p)
+    result = result * 10 + (*p - '0');
+  if (p == first || p == end || *p != '"')
+    return false;
+  ++p;
+  value = result;
+  return true;
+}
+
+bool scan_trusted_event_line(const string& line, event& e) {
+  const char* text = line.data();
+  const char* end = text + line.size();
+  if (line.size() < trusted_timestamp_offset + trusted_timestamp_length
+      || memcmp(text, trusted_prefix, trusted_type_offset))
+    return false;
+
+  // the first byte of the event type tells the event and its members
+  const char* p = text + trusted_type_offset + 1;
+  switch (text[trusted_type_offset]) {
+    case 'p':
+      if (!match_literal(end, p, trusted_purchase, sizeof(trusted_purchase) - 1))
+        return false;
+      e.kind = event_kind::purchase;
+      break;
+    case 'b':
+      if (!match_literal(end, p, trusted_befriend, sizeof(trusted_befriend) - 1))
+        return false;
+      e.kind = event_kind::befriend;
+      break;
+    case 'u':
+      if (!match_literal(end, p, trusted_unfriend, sizeof(trusted_unfriend) - 1))
+        return false;
+      e.kind = event_kind::unfriend;
+      break;
+    default:
+      return false;
+  }
+  if (!is_trusted_timestamp(p))
+    return false;
+  p += trusted_timestamp_length;
+
+  if (e.kind == event_kind::purchase) {
+    if (!match_literal(end, p, "\", \"id\": \"", 10)
+        || !read_trusted_id(end, p, e.id1)
+        || !match_literal(end, p, ", \"amount\": \"", 13))
+      return false;
+    const char* amount_end = static_cast<const char*>(memchr(p, '"', end - p));
+    if (amount_end == nullptr || end - amount_end != 2 || amount_end[1] != '}'
+        || !is_plain_amount(p, amount_end))
+      return false;
+    member_value amount;
+    amount.text = p;
+    amount.length = amount_end - p;
+    if (!value_to_double(amount, e.amount))
+      return false;
+    e.id2 = 0;
+  } else {
+    if (!match_literal(end, p, "\", \"id1\": \"", 11)
+        || !read_trusted_id(end, p, e.id1)
+        || !match_literal(end, p, ", \"id2\": \"", 10)
+        || !read_trusted_id(end, p, e.id2)
+        || end - p != 1 || *p != '}')
+      return false;
+    e.amount = 0.0;
+  }
+
+  e.timestamp.assign(text + trusted_timestamp_offset, trusted_timestamp_length);
+  e.time = convert_string2timet(e.timestamp);
+  return true;
+}
@@ -0,0 +1,72 @@
+/*
+ * event_scanner.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef EVENT_SCANNER_H_
+#define EVENT_SCANNER_H_
+
+#include <cstddef>
+#include <string>
+#include "event.h"
+
+// the result of scanning a line of an input log
+enum class scan_result {
+  // the line is a purchase, befriend or unfriend event
+  event,
+  // the line sets D and T
+  parameters,
+  // the line must be parsed with rapidjson
+  fallback
+};
+
+// function to read a line of an input log without building a DOM: the line
+//          must be a flat object of string members without escapes, in any
+//          order and with any JSON whitespace, holding a known event or D and
+//          T. The quotes, backslashes and control characters of the line are
+//          located with SIMD compares; numbers are converted as stoi and stod
+//          do. Any other line (other types of values, escapes, a missing
+//          member, an unknown event type, a malformed line) is left to
+//          rapidjson and read_event, so the results and the error messages
+//          are those of the full parser.
+// input:   line - the line
+// outputs: e - reference to the event, if it is one (the line is not filled)
+//          D, T - references to the parameters, if the line sets them
+// return:  what the line is, or scan_result::fallback
+scan_result scan_event_line(const std::string& line, event& e, std::size_t& D, std::size_t& T);
+
+// function to read a line in the exact layout of the upstream systems'
+//          logs, for input that is already validated: the event type is
+//          told by its first byte, and the members are read at their offsets
+//          in a fixed order ("event_type", "timestamp", then "id" and
+//          "amount" or "id1" and "id2", separated by ", ") without locating
+//          the quotes of the line first. The literal parts of the layout,
+//          the digits and separators of the timestamp and the digits and
+//          point of the amount are still checked, so a line in any other
+//          layout is left to scan_event_line and gives the same results as
+//          in the strict mode.
+// input:   line - the line
+// output:  e - reference to the event (the line is not filled)
+// return:  true if the line has the layout and is read
+bool scan_trusted_event_line(const std::string& line, event& e);
+
+// function to read a line with the trusted layout first if asked, then with
+//          scan_event_line
+// inputs:  line - the line
+//          trusted - true to try scan_trusted_event_line first
+// outputs: e, D, T - as for scan_event_line
+// return:  what the line is, or scan_result::fallback
+inline scan_result scan_event_line(const std::string& line, event& e, std::size_t& D,
+    std::size_t& T, const bool trusted) {
+  if (trusted && scan_trusted_event_line(line, e))
+    return scan_result::event;
+  return scan_event_line(line, e, D, T);
+}
+
+// function to obtain the name of the variant locating the characters
+// return: "sse2" or "scalar"
+const char* event_scanner_variant();
+
+#endif /* EVENT_SCANNER_H_ */
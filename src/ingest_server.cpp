@@ -0,0 +1,386 @@
+/*
+ * ingest_server.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <limits>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include "ingest_server.h"
+
+using namespace std;
+
+// epoll data of the descriptors other than the connections (ids start at 1)
+static const uint64_t listen_id = numeric_limits<uint64_t>::max();
+static const uint64_t wake_id = listen_id - 1;
+static const uint64_t signal_id = listen_id - 2;
+
+// the bytes read from a connection at a time
+static const size_t read_bytes = 1 << 16;
+// a connection is not read while this many reply bytes wait for its client
+static const size_t max_unsent_bytes = 4 << 20;
+// time to write the last replies after the scorer finishes
+static const chrono::seconds final_flush_time(1);
+
+// function to register a descriptor with an epoll instance
+// inputs: epoll_fd - the epoll instance
+//         fd - the descriptor
+//         id - data returned with its events
+//         events - the events to wait for
+// return: true if it is registered
+static bool add_to_epoll(const int epoll_fd, const int fd, const uint64_t id,
+    const uint32_t events) {
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.u64 = id;
+  return epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) == 0;
+}
+
+ingest_server::~ingest_server() {
+  if (io_thread_.joinable())
+    finish();
+  for (auto& entry : connections_)
+    close(entry.second.fd);
+  for (const int fd : {listen_fd_, epoll_fd_, wake_fd_, signal_fd_}) {
+    if (fd >= 0)
+      close(fd);
+  }
+  if (!unix_path_.empty())
+    unlink(unix_path_.c_str());
+}
+
+bool ingest_server::open(const string& address, const size_t capacity_lines) {
+  capacity_lines_ = capacity_lines > 0 ? capacity_lines : 1;
+
+  // the stop signals stay pending until the signalfd is read
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  if (sigprocmask(SIG_BLOCK, &signals, nullptr) != 0)
+    return false;
+  signal_fd_ = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+  if (!address.compare(0, 5, "unix:")) {
+    const string path = address.substr(5);
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path))
+      return false;
+    memcpy(addr.sun_path, path.c_str(), path.size());
+    // a socket file left by an earlier run is replaced
+    unlink(path.c_str());
+    listen_fd_ = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0
+        || bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+      return false;
+    unix_path_ = path;
+  } else if (!address.compare(0, 4, "tcp:")) {
+    char* end;
+    const unsigned long port = strtoul(address.c_str() + 4, &end, 10);
+    if (address.size() == 4 || *end != '\0' || port == 0 || port > 65535)
+      return false;
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    const int on = 1;
+    if (listen_fd_ < 0
+        || setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) != 0
+        || bind(listen_fd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) != 0)
+      return false;
+  } else {
+    return false;
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  return signal_fd_ >= 0 && epoll_fd_ >= 0 && wake_fd_ >= 0
+      && listen(listen_fd_, SOMAXCONN) == 0
+      && add_to_epoll(epoll_fd_, listen_fd_, listen_id, EPOLLIN)
+      && add_to_epoll(epoll_fd_, wake_fd_, wake_id, EPOLLIN)
+      && add_to_epoll(epoll_fd_, signal_fd_, signal_id, EPOLLIN);
+}
+
+void ingest_server::run() {
+  struct epoll_event events[64];
+  chrono::steady_clock::time_point flush_deadline{};
+  for (;;) {
+    const bool finishing = scorer_done_.load(memory_order_acquire);
+    const int n_events = epoll_wait(epoll_fd_, events, 64, finishing ? 100 : -1);
+    if (n_events < 0 && errno != EINTR) {
+      cerr << "Error: epoll_wait failed: " << strerror(errno) << endl;
+      break;
+    }
+
+    for (int i = 0; i < n_events; ++i) {
+      const uint64_t id = events[i].data.u64;
+      if (id == listen_id) {
+        accept_connections();
+      } else if (id == signal_id) {
+        struct signalfd_siginfo info;
+        if (read(signal_fd_, &info, sizeof(info)) != sizeof(info))
+          continue;
+        // no more events are read; the queued ones are still scored and answered
+        stopping_ = true;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, listen_fd_, nullptr);
+        for (auto& entry : connections_)
+          update_events(entry.first, entry.second);
+        lock_guard<mutex> lock(mutex_);
+        stopped_ = true;
+        not_empty_.notify_one();
+      } else if (id == wake_id) {
+        uint64_t count;
+        if (read(wake_fd_, &count, sizeof(count)) < 0 && errno != EAGAIN)
+          continue;
+        take_replies();
+      } else {
+        const auto iter = connections_.find(id);
+        if (iter == connections_.end())
+          continue;
+        connection& conn = iter->second;
+        if (events[i].events & EPOLLIN) {
+          read_connection(id, conn);
+        } else if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+          // the client is gone, so its replies cannot be delivered; the events
+          // it sent are still read, even while reading is paused
+          while (read_connection(id, conn)) {}
+          conn.failed = true;
+          continue;
+        }
+        if ((events[i].events & EPOLLOUT) && !conn.failed) {
+          conn.failed = !write_connection(conn);
+          update_events(id, conn);
+        }
+      }
+    }
+    close_finished();
+
+    // once the scorer is done, the last replies get a limited time
+    if (finishing) {
+      const auto now = chrono::steady_clock::now();
+      if (flush_deadline == chrono::steady_clock::time_point{})
+        flush_deadline = now + final_flush_time;
+      bool unsent = false;
+      for (const auto& entry : connections_)
+        unsent |= entry.second.out_position < entry.second.out.size();
+      if (!unsent || now >= flush_deadline)
+        break;
+    }
+  }
+}
+
+void ingest_server::accept_connections() {
+  for (;;) {
+    const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0)
+      return;
+    const uint64_t id = next_connection_++;
+    connection& conn = connections_[id];
+    conn.fd = fd;
+    if (!add_to_epoll(epoll_fd_, fd, id, 0)) {
+      close(fd);
+      connections_.erase(id);
+      continue;
+    }
+    ++accepted_connections_;
+    update_events(id, conn);
+  }
+}
+
+bool ingest_server::read_connection(const uint64_t id, connection& conn) {
+  char buffer[read_bytes];
+  ssize_t n_read;
+  do {
+    n_read = read(conn.fd, buffer, sizeof(buffer));
+  } while (n_read < 0 && errno == EINTR);
+  if (n_read < 0) {
+    conn.failed = errno != EAGAIN;
+    return false;
+  }
+  if (n_read == 0) {
+    // an incomplete last line is dropped
+    conn.read_closed = true;
+    conn.partial.clear();
+    update_events(id, conn);
+    return false;
+  }
+  received_bytes_ += n_read;
+
+  // the complete lines of this read form one batch
+  ingest_batch batch;
+  batch.connection = id;
+  const char* p = buffer;
+  const char* end = buffer + n_read;
+  for (const char* newline; (newline = static_cast<const char*>(
+      memchr(p, '\n', end - p))) != nullptr; p = newline + 1) {
+    if (conn.partial.empty()) {
+      batch.lines.emplace_back(p, newline);
+    } else {
+      conn.partial.append(p, newline);
+      batch.lines.push_back(std::move(conn.partial));
+      conn.partial.clear();
+    }
+  }
+  conn.partial.append(p, end);
+  if (batch.lines.empty())
+    return true;
+
+  ++conn.pending_batches;
+  ++received_batches_;
+  received_lines_ += batch.lines.size();
+  bool full;
+  {
+    lock_guard<mutex> lock(mutex_);
+    queued_lines_ += batch.lines.size();
+    if (queued_lines_ > max_queued_lines_)
+      max_queued_lines_ = queued_lines_;
+    full = queued_lines_ >= capacity_lines_;
+    batches_.push_back(std::move(batch));
+    not_empty_.notify_one();
+  }
+
+  // the scorer is behind: stop reading until it catches up
+  if (full && !paused_) {
+    paused_ = true;
+    pause_time_ = chrono::steady_clock::now();
+    ++backpressure_pauses_;
+    for (auto& entry : connections_)
+      update_events(entry.first, entry.second);
+  }
+  return true;
+}
+
+bool ingest_server::write_connection(connection& conn) {
+  while (conn.out_position < conn.out.size()) {
+    const ssize_t n_written = send(conn.fd, conn.out.data() + conn.out_position,
+        conn.out.size() - conn.out_position, MSG_NOSIGNAL);
+    if (n_written < 0) {
+      if (errno == EINTR)
+        continue;
+      return errno == EAGAIN;
+    }
+    conn.out_position += n_written;
+    sent_bytes_ += n_written;
+  }
+  conn.out.clear();
+  conn.out_position = 0;
+  return true;
+}
+
+void ingest_server::take_replies() {
+  vector<pair<uint64_t, string>> replies;
+  bool resume;
+  {
+    lock_guard<mutex> lock(mutex_);
+    replies.swap(replies_);
+    resume = paused_ && queued_lines_ <= capacity_lines_ / 2;
+  }
+
+  for (auto& reply : replies) {
+    // the connection may have been closed since its batch was queued
+    const auto iter = connections_.find(reply.first);
+    if (iter == connections_.end())
+      continue;
+    connection& conn = iter->second;
+    --conn.pending_batches;
+    if (conn.failed)
+      continue;
+    conn.out.append(reply.second);
+    conn.failed = !write_connection(conn);
+    update_events(iter->first, conn);
+  }
+
+  if (resume) {
+    paused_ = false;
+    backpressure_seconds_ += chrono::duration<double>(
+        chrono::steady_clock::now() - pause_time_).count();
+    for (auto& entry : connections_)
+      update_events(entry.first, entry.second);
+  }
+}
+
+void ingest_server::update_events(const uint64_t id, connection& conn) {
+  const size_t unsent = conn.out.size() - conn.out_position;
+  uint32_t events = 0;
+  if (!paused_ && !stopping_ && !conn.read_closed && unsent < max_unsent_bytes)
+    events |= EPOLLIN;
+  if (unsent > 0)
+    events |= EPOLLOUT;
+  if (events == conn.events)
+    return;
+  struct epoll_event ev;
+  ev.events = events;
+  ev.data.u64 = id;
+  if (epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &ev) == 0)
+    conn.events = events;
+}
+
+void ingest_server::close_finished() {
+  for (auto iter = connections_.begin(); iter != connections_.end();) {
+    const connection& conn = iter->second;
+    // a closed client is kept until its batches are answered
+    if (conn.failed || (conn.read_closed && conn.pending_batches == 0
+        && conn.out_position == conn.out.size())) {
+      close(conn.fd);
+      iter = connections_.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+}
+
+bool ingest_server::pop_batch(ingest_batch& batch) {
+  unique_lock<mutex> lock(mutex_);
+  not_empty_.wait(lock, [this] {return !batches_.empty() || stopped_;});
+  if (batches_.empty())
+    return false;
+  batch = std::move(batches_.front());
+  batches_.pop_front();
+  queued_lines_ -= batch.lines.size();
+  return true;
+}
+
+void ingest_server::reply(const uint64_t connection_id, string&& bytes) {
+  {
+    lock_guard<mutex> lock(mutex_);
+    replies_.emplace_back(connection_id, std::move(bytes));
+  }
+  const uint64_t one = 1;
+  if (write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    cerr << "Error: waking the ingest thread failed: " << strerror(errno) << endl;
+}
+
+void ingest_server::finish() {
+  scorer_done_.store(true, memory_order_release);
+  const uint64_t one = 1;
+  if (write(wake_fd_, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    cerr << "Error: waking the ingest thread failed: " << strerror(errno) << endl;
+  io_thread_.join();
+}
+
+void ingest_server::print_stats(ostream& out) const {
+  out << "ingest connections: " << accepted_connections_ << "\n"
+      << "ingest lines: " << received_lines_ << " in " << received_batches_ << " batches\n"
+      << "ingest bytes received: " << received_bytes_ << ", sent: " << sent_bytes_ << "\n"
+      << "ingest max queued lines: " << max_queued_lines_ << "\n"
+      << "backpressure pauses: " << backpressure_pauses_ << ", seconds: "
+      << backpressure_seconds_ << "\n";
+}
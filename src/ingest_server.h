@@ -0,0 +1,158 @@
+/*
+ * ingest_server.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef INGEST_SERVER_H_
+#define INGEST_SERVER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <iosfwd>
+
+// ingest_batch holds the complete lines of one read from a connection
+struct ingest_batch {
+  uint64_t connection = 0;
+  std::vector<std::string> lines{};
+};
+
+// ingest_server accepts newline-delimited stream events over a Unix domain
+// socket or a TCP port on localhost. An I/O thread runs an epoll loop: every
+// read from a connection becomes one batch of complete lines in a bounded
+// queue, which the scoring thread takes with pop_batch. When the queue holds
+// its capacity of lines, the I/O thread stops reading from every connection
+// until the scorer has taken half of them; the socket buffers then fill and
+// the producers block (backpressure). The scorer answers every batch with
+// reply(): the bytes are written back on the connection by the I/O thread.
+// SIGINT and SIGTERM are read from a signalfd and stop the server.
+class ingest_server {
+  private:
+    // connection holds the state of a client in the I/O thread
+    struct connection {
+      int fd = -1;
+      // bytes of an incomplete line
+      std::string partial{};
+      // bytes waiting to be written, starting at out_position
+      std::string out{};
+      std::size_t out_position = 0;
+      // batches queued and not answered yet
+      std::size_t pending_batches = 0;
+      // true after the client closed its side
+      bool read_closed = false;
+      // true after a read or a write failed
+      bool failed = false;
+      // the epoll events registered for the socket
+      uint32_t events = 0;
+    };
+
+    int listen_fd_ = -1;
+    int epoll_fd_ = -1;
+    // written by the scorer to wake the I/O thread for replies and resuming
+    int wake_fd_ = -1;
+    int signal_fd_ = -1;
+    std::string unix_path_{};
+    std::size_t capacity_lines_ = 0;
+    std::thread io_thread_{};
+
+    // state of the I/O thread
+    std::unordered_map<uint64_t, connection> connections_{};
+    uint64_t next_connection_ = 1;
+    bool paused_ = false;
+    std::chrono::steady_clock::time_point pause_time_{};
+    // true once a stop signal is received: no more reading
+    bool stopping_ = false;
+
+    // the queue of batches and the replies, shared by the two threads
+    std::mutex mutex_{};
+    std::condition_variable not_empty_{};
+    std::deque<ingest_batch> batches_{};
+    std::size_t queued_lines_ = 0;
+    std::vector<std::pair<uint64_t, std::string>> replies_{};
+    bool stopped_ = false;
+    std::atomic<bool> scorer_done_{false};
+
+    // counters
+    std::size_t accepted_connections_ = 0;
+    std::size_t received_lines_ = 0;
+    std::size_t received_batches_ = 0;
+    uint64_t received_bytes_ = 0;
+    uint64_t sent_bytes_ = 0;
+    std::size_t max_queued_lines_ = 0;
+    std::size_t backpressure_pauses_ = 0;
+    double backpressure_seconds_ = 0.0;
+
+    // function run by the I/O thread
+    void run();
+
+    // function to accept the waiting connections
+    void accept_connections();
+
+    // function to read from a connection and queue its complete lines
+    // inputs: id, conn - the connection
+    // return: true if bytes were read
+    bool read_connection(const uint64_t id, connection& conn);
+
+    // function to write the pending bytes of a connection
+    // input:  conn - the connection
+    // return: false if the connection failed
+    bool write_connection(connection& conn);
+
+    // function to move the replies of the scorer to their connections
+    void take_replies();
+
+    // function to choose the epoll events of a connection from its state
+    // inputs: id, conn - the connection
+    void update_events(const uint64_t id, connection& conn);
+
+    // function to close the connections that are finished or failed
+    void close_finished();
+
+  public:
+    ingest_server() = default;
+    // destructor: stops the I/O thread and closes the sockets
+    ~ingest_server();
+
+    ingest_server(const ingest_server&) = delete;
+    ingest_server& operator=(const ingest_server&) = delete;
+
+    // function to listen for clients; SIGINT and SIGTERM are blocked, so call
+    //          it before any thread is started
+    // inputs: address - "unix:PATH" for a Unix domain socket, or "tcp:PORT"
+    //                   for a TCP port on 127.0.0.1
+    //         capacity_lines - the number of lines queued before reading stops
+    // return: true if the server listens
+    bool open(const std::string& address, const std::size_t capacity_lines);
+
+    // function to start the I/O thread
+    void start() {io_thread_ = std::thread(&ingest_server::run, this);}
+
+    // function to take the next batch, waiting for one
+    // output: batch - reference to the batch
+    // return: false once the server is stopped and every batch is taken
+    bool pop_batch(ingest_batch& batch);
+
+    // function to write bytes back on the connection of a batch; every batch
+    //          is answered exactly once
+    // inputs: connection_id - the connection of the batch
+    //         bytes - the bytes to write
+    void reply(const uint64_t connection_id, std::string&& bytes);
+
+    // function to write the last replies and stop the I/O thread
+    void finish();
+
+    // function to write the counters of the server to a stream
+    // input: out - output stream
+    void print_stats(std::ostream& out) const;
+};
+
+#endif /* INGEST_SERVER_H_ */
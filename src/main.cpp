@@ -5,24 +5,35 @@
 #include <unordered_map>
 #include <queue>
 #include <algorithm>
+#include <unistd.h>
+#include <sys/stat.h>
 #include "network.h"
+#include "options.h"
+#include "stream_follower.h"
+#include "ingest_server.h"
+#include "shm_ingest.h"
+#include "binary_event_log.h"
+#include "decompressor.h"
+#include "uring_io.h"
 
 using namespace std;
 
 int main(int argc, char** argv) {
 
-  // the number of inputs is three:
+  // the number of inputs is three, optionally preceded by options:
   // 1st argument: batch_log.json
   // 2nd argument: stream_log.json
   // 3rd argument: flagged_purchases.json
-  if (argc != 4) {
+  options opts;
+  if (!parse_options(argc, argv, opts)) {
     cout << "Inputs are not correct (they shoud be batch_log.json, stream_log.json, "
         "and flagged_purchases.json)" << endl;
+    print_usage(argv[0]);
     return 1;
   }
-  const char* fname_batch_log = argv[1];
-  const char* fname_stream_log = argv[2];
-  const char* fname_flagged_log = argv[3];
+  const char* fname_batch_log = opts.fname_batch_log;
+  const char* fname_stream_log = opts.fname_stream_log;
+  const char* fname_flagged_log = opts.fname_flagged_log;
 
   ifstream in_batch_log;
   in_batch_log.open(fname_batch_log);
@@ -31,30 +42,313 @@ int main(int argc, char** argv) {
     return EXIT_FAILURE;
   }
   ifstream in_stream_log;
+  uint64_t stream_offset = 0;
   in_stream_log.open(fname_stream_log);
   if (in_stream_log.fail()) {
     std::cout << "stream_log.json opening failed\n";
     return EXIT_FAILURE;
   }
 
+  // either log may be in the binary event format (see convert_event_log),
+  // which is read from a mapping instead of the stream
+  binary_event_log binary_batch_log, binary_stream_log;
+  const bool binary_batch = is_binary_event_log(fname_batch_log);
+  const bool binary_stream = is_binary_event_log(fname_stream_log);
+  if (binary_batch && (opts.recover || opts.resume)) {
+    std::cout << "a binary batch log cannot be used with --recover or --resume\n";
+    return EXIT_FAILURE;
+  }
+  if (binary_stream && opts.follow) {
+    std::cout << "a binary stream log cannot be followed\n";
+    return EXIT_FAILURE;
+  }
+
+  // several stream logs are read by a merger, each by its own thread
+  const bool merge_streams = opts.fname_stream_logs.size() > 1;
+  for (const char* fname : opts.fname_stream_logs) {
+    if (merge_streams && is_binary_event_log(fname)) {
+      std::cout << "a binary stream log cannot be merged\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  // either json log may be compressed with gzip or zstd, in which case it is
+  // read from a stream decompressing it in a thread
+  decompressing_istream compressed_batch_log, compressed_stream_log;
+  const compression_format batch_compression = detect_compression(fname_batch_log);
+  const compression_format stream_compression = merge_streams ?
+      compression_format::none : detect_compression(fname_stream_log);
+  if (stream_compression != compression_format::none && opts.follow) {
+    std::cout << "a compressed stream log cannot be followed\n";
+    return EXIT_FAILURE;
+  }
+  if (batch_compression != compression_format::none) {
+    in_batch_log.close();
+    if (!compressed_batch_log.open(fname_batch_log, batch_compression)) {
+      std::cout << "batch_log.json decompression failed\n";
+      return EXIT_FAILURE;
+    }
+  }
+  if (stream_compression != compression_format::none) {
+    in_stream_log.close();
+    if (!compressed_stream_log.open(fname_stream_log, stream_compression)) {
+      std::cout << "stream_log.json decompression failed\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  // with --io-uring, the other json logs are read and the output is written
+  // through io_uring if the kernel allows it, and with the streams otherwise
+  const bool use_uring = opts.use_io_uring && uring_available();
+  if (opts.use_io_uring && !use_uring)
+    std::cerr << "Warning: io_uring is not available, the files are read and written"
+        " with streams" << endl;
+  uring_istream uring_batch_log, uring_stream_log;
+  const bool uring_batch = use_uring && !binary_batch
+      && batch_compression == compression_format::none;
+  const bool uring_stream = use_uring && !binary_stream && !merge_streams && !opts.follow
+      && stream_compression == compression_format::none;
+  if (uring_batch) {
+    in_batch_log.close();
+    if (!uring_batch_log.open(fname_batch_log, 0)) {
+      std::cout << "batch_log.json opening failed\n";
+      return EXIT_FAILURE;
+    }
+  }
+  istream& batch_log = batch_compression != compression_format::none ?
+      static_cast<istream&>(compressed_batch_log) : uring_batch ?
+      static_cast<istream&>(uring_batch_log) : in_batch_log;
+  istream& stream_log = stream_compression != compression_format::none ?
+      static_cast<istream&>(compressed_stream_log) : in_stream_log;
+
+  // a resumed run keeps the output written up to the checkpoint, and a
+  // recovered run the output of the previous run
+  const bool keep_output = opts.resume || opts.recover;
   ofstream out_flagged_log;
-  out_flagged_log.open(fname_flagged_log);
-  if (out_flagged_log.fail()) {
+  uring_ostream uring_flagged_log;
+  if (use_uring) {
+    uring_flagged_log.open(fname_flagged_log, keep_output);
+    // a checkpoint records the length of the output written before it, and a
+    // live input may go quiet with the last flagged lines still unwritten
+    uring_flagged_log.set_flush_waits(opts.fname_snapshot != nullptr || opts.follow
+        || opts.listen_address != nullptr || opts.path_shm_ring != nullptr);
+  }
+  else
+    out_flagged_log.open(fname_flagged_log,
+        keep_output ? ios::out | ios::app : ios::out | ios::trunc);
+  ostream& flagged_log = use_uring ?
+      static_cast<ostream&>(uring_flagged_log) : out_flagged_log;
+  if (flagged_log.fail()) {
     std::cout << "flagged_purchases.json opening failed\n";
     return EXIT_FAILURE;
   }
 
   // process batch_log.json file and set the initial user network
   network user_network;
-  user_network.read_batch_log(in_batch_log);
+  user_network.set_cache_enabled(opts.use_cache);
+  user_network.set_scanner_enabled(opts.use_scanner);
+  user_network.set_trusted_input(opts.trusted_input);
+  user_network.set_time_window(opts.window_seconds, opts.window_max_purchases);
+
+  // sort out-of-order events, optionally writing late ones to a side file
+  ofstream out_late_log;
+  if (opts.use_reorder_buffer)
+    user_network.set_reorder_buffer(opts.allowed_lateness, opts.reorder_capacity);
+  if (opts.fname_late_log != nullptr) {
+    out_late_log.open(opts.fname_late_log);
+    if (out_late_log.fail()) {
+      std::cout << "late event log opening failed\n";
+      return EXIT_FAILURE;
+    }
+    user_network.set_late_event_log(&out_late_log);
+  }
+
+  // count the errors of the input logs and sample their messages, optionally
+  // copying the rejected lines to a side file
+  ofstream out_rejected_log;
+  if (opts.fname_rejected_log != nullptr) {
+    out_rejected_log.open(opts.fname_rejected_log);
+    if (out_rejected_log.fail()) {
+      std::cout << "rejected line log opening failed\n";
+      return EXIT_FAILURE;
+    }
+  }
+  user_network.set_error_reporting(opts.error_messages, opts.error_interval,
+      opts.fname_rejected_log != nullptr ? &out_rejected_log : nullptr);
+  user_network.set_arena_enabled(opts.use_arena);
+  user_network.set_memory_budget(opts.memory_budget_mb << 20, opts.inactive_horizon);
+  user_network.set_batch_threads(opts.batch_threads);
+  if (opts.fname_spill != nullptr
+      && !user_network.set_spill_file(opts.fname_spill, opts.spill_after)) {
+    std::cout << "spill file opening failed\n";
+    return EXIT_FAILURE;
+  }
+  if (opts.fname_wal != nullptr && !user_network.set_write_ahead_log(opts.fname_wal,
+      opts.recover, opts.wal_group_size, opts.wal_sync_policy, opts.wal_sync_interval_ms)) {
+    std::cout << "write-ahead log opening failed\n";
+    return EXIT_FAILURE;
+  }
+  if (opts.fname_snapshot != nullptr) {
+    user_network.set_snapshots(opts.fname_snapshot, opts.snapshot_interval,
+        opts.snapshot_deltas, opts.snapshot_fork);
+    if (!user_network.set_output_file(fname_flagged_log)) {
+      std::cout << "flagged_purchases.json opening for checkpoints failed\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  // restore the state of a previous run, or build it from the batch log
+  if (opts.recover) {
+    struct stat flagged_log_stat;
+    if (stat(fname_flagged_log, &flagged_log_stat) != 0 || !user_network.recover(
+        batch_log, stream_offset, static_cast<uint64_t>(flagged_log_stat.st_size))) {
+      std::cout << "recovery failed\n";
+      return EXIT_FAILURE;
+    }
+  } else if (opts.resume) {
+    uint64_t output_bytes = 0;
+    if (!user_network.resume(batch_log, stream_offset, output_bytes)) {
+      std::cout << "resuming failed\n";
+      return EXIT_FAILURE;
+    }
+    // purchases flagged after the checkpoint are flagged again, so they are dropped;
+    // a file shorter than the checkpoint records has lost output and is not extended
+    struct stat flagged_log_stat;
+    if (stat(fname_flagged_log, &flagged_log_stat) != 0
+        || static_cast<uint64_t>(flagged_log_stat.st_size) < output_bytes) {
+      std::cout << "flagged_purchases.json is shorter than the checkpoint records ("
+          << output_bytes << " bytes)\n";
+      return EXIT_FAILURE;
+    }
+    if (truncate(fname_flagged_log, output_bytes) != 0) {
+      std::cout << "flagged_purchases.json truncation failed\n";
+      return EXIT_FAILURE;
+    }
+  } else if (binary_batch) {
+    if (!binary_batch_log.open(fname_batch_log, 0)) {
+      std::cout << "batch_log.json mapping failed\n";
+      return EXIT_FAILURE;
+    }
+    user_network.read_binary_batch_log(binary_batch_log);
+  } else
+    user_network.read_batch_log(batch_log);
   in_batch_log.close();
+  compressed_batch_log.close();
+  uring_batch_log.close();
+
+  // a restored run continues the output and the stream where the previous run stopped
+  if (keep_output) {
+    if (use_uring)
+      uring_flagged_log.seek_end();
+    else
+      out_flagged_log.seekp(0, ios::end);
+    // a compressed stream is decompressed again up to the offset; a stream
+    // read with io_uring is opened at it
+    if (stream_compression != compression_format::none)
+      stream_log.ignore(static_cast<streamsize>(stream_offset));
+    else if (!uring_stream)
+      in_stream_log.seekg(stream_offset);
+  }
+
+  // the follower and the servers block the stop signals, so they are opened
+  // before the shards' threads are started
+  stream_follower follower;
+  ingest_server server;
+  shm_ingest shm;
+  if (opts.path_shm_ring != nullptr
+      && !shm.open(opts.path_shm_ring, opts.shm_capacity, opts.shm_spin)) {
+    std::cout << "shared-memory ring " << opts.path_shm_ring << " creation failed\n";
+    return EXIT_FAILURE;
+  }
+  if (opts.listen_address != nullptr
+      && !server.open(opts.listen_address, opts.listen_queue_lines)) {
+    std::cout << "listening on " << opts.listen_address << " failed\n";
+    return EXIT_FAILURE;
+  }
+  if (opts.follow) {
+    in_stream_log.close();
+    if (!follower.open(fname_stream_log, stream_offset, opts.follow_idle_seconds)) {
+      std::cout << "stream_log.json following failed\n";
+      return EXIT_FAILURE;
+    }
+  }
+
+  // hand the users over to worker threads for the stream
+  if (opts.shards > 0)
+    user_network.start_shards(opts.shards);
+  if (opts.path_mmap_store != nullptr
+      && !user_network.start_mmap_store(opts.path_mmap_store, opts.mmap_merge_interval)) {
+    std::cout << "mmap store creation failed\n";
+    return EXIT_FAILURE;
+  }
 
   // process the stream_log.json file:
   // update user network
   // detect anomalous purchases and write them to flagged_purchases.json
-  user_network.process_stream_log(in_stream_log, out_flagged_log);
+  stream_merger merger;
+  if (opts.follow)
+    user_network.follow_stream_log(follower, flagged_log);
+  else if (merge_streams) {
+    if (!merger.open(opts.fname_stream_logs, opts.use_scanner, opts.trusted_input)) {
+      std::cout << "stream log opening failed\n";
+      return EXIT_FAILURE;
+    }
+    user_network.process_merged_stream_logs(merger, flagged_log);
+  } else if (binary_stream) {
+    if (!binary_stream_log.open(fname_stream_log, stream_offset)) {
+      std::cout << "stream_log.json mapping failed\n";
+      return EXIT_FAILURE;
+    }
+    user_network.process_binary_stream_log(binary_stream_log, flagged_log);
+  } else if (uring_stream) {
+    if (!uring_stream_log.open(fname_stream_log, stream_offset)) {
+      std::cout << "stream_log.json opening failed\n";
+      return EXIT_FAILURE;
+    }
+    user_network.process_stream_log(uring_stream_log, flagged_log);
+  } else
+    user_network.process_stream_log(stream_log, flagged_log);
   in_stream_log.close();
+  compressed_stream_log.close();
+  uring_stream_log.close();
+
+  // then the events sent by the clients
+  if (opts.listen_address != nullptr) {
+    server.start();
+    user_network.serve_stream(server, flagged_log, opts.reply_flagged);
+    server.finish();
+  }
+  if (opts.path_shm_ring != nullptr)
+    user_network.serve_shm_ring(shm, flagged_log);
   out_flagged_log.close();
+  uring_flagged_log.close();
+  user_network.print_error_summary(cerr);
+
+  if (opts.print_stats) {
+    user_network.print_stats(cout);
+    if (binary_batch)
+      binary_batch_log.print_stats(cout, "batch log");
+    if (binary_stream)
+      binary_stream_log.print_stats(cout, "stream log");
+    if (batch_compression != compression_format::none)
+      compressed_batch_log.print_stats(cout, "batch log");
+    if (stream_compression != compression_format::none)
+      compressed_stream_log.print_stats(cout, "stream log");
+    if (merge_streams)
+      merger.print_stats(cout);
+    if (uring_batch)
+      uring_batch_log.print_stats(cout, "batch log");
+    if (uring_stream)
+      uring_stream_log.print_stats(cout, "stream log");
+    if (use_uring)
+      uring_flagged_log.print_stats(cout, "output");
+    if (opts.follow)
+      follower.print_stats(cout);
+    if (opts.listen_address != nullptr)
+      server.print_stats(cout);
+    if (opts.path_shm_ring != nullptr)
+      shm.print_stats(cout);
+  }
 
 	puts("\nProgram successfully finished !!!");
 	return EXIT_SUCCESS;
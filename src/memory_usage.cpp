@@ -0,0 +1,43 @@
+/*
+ * memory_usage.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <ostream>
+#include "memory_usage.h"
+
+using namespace std;
+
+void memory_usage::add_users(const user_map& map_users) {
+  users += map_users.size();
+  // every node holds a link, the id and the user_info object
+  user_table_bytes += map_users.bucket_count() * sizeof(void*)
+      + map_users.size() * (sizeof(void*) + sizeof(user_map::value_type));
+  for (const auto& user : map_users) {
+    friend_set_bytes += user.second.friend_set_bytes();
+    purchase_history_bytes += user.second.purchase_record_bytes();
+  }
+}
+
+void memory_usage::add(const memory_usage& other) {
+  users += other.users;
+  user_table_bytes += other.user_table_bytes;
+  friend_set_bytes += other.friend_set_bytes;
+  purchase_history_bytes += other.purchase_history_bytes;
+  cache_bytes += other.cache_bytes;
+}
+
+void memory_usage::print(ostream& out) const {
+  const size_t divisor = users > 0 ? users : 1;
+  out << "memory user table bytes: " << user_table_bytes << "\n"
+      << "memory friend set bytes: " << friend_set_bytes << "\n"
+      << "memory purchase history bytes: " << purchase_history_bytes << "\n"
+      << "memory cache bytes: " << cache_bytes << "\n"
+      << "memory total bytes: " << total_bytes() << "\n"
+      << "memory bytes per user: " << total_bytes() / divisor
+      << " (table " << user_table_bytes / divisor
+      << ", friends " << friend_set_bytes / divisor
+      << ", purchases " << purchase_history_bytes / divisor << ")\n";
+}
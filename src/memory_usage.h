@@ -0,0 +1,47 @@
+/*
+ * memory_usage.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef MEMORY_USAGE_H_
+#define MEMORY_USAGE_H_
+
+#include <cstddef>
+#include <iosfwd>
+#include "user_info.h"
+
+// memory_usage estimates the bytes held by the network, by category.
+// The sizes are computed from the sizes of the containers and the node layouts
+// of the standard library, so they do not include allocator overhead.
+struct memory_usage {
+  // the number of users
+  std::size_t users = 0;
+  // hash-map buckets and nodes of the user table (including the user_info objects)
+  std::size_t user_table_bytes = 0;
+  // buckets and nodes of the users' friend sets
+  std::size_t friend_set_bytes = 0;
+  // blocks of the users' purchase records
+  std::size_t purchase_history_bytes = 0;
+  // cached statistics of users' networks
+  std::size_t cache_bytes = 0;
+
+  // function to add the memory of a user table
+  // input: map_users - the users
+  void add_users(const user_map& map_users);
+
+  // function to add the counts of another estimate
+  // input: other - memory of another part of the network (e.g. a shard)
+  void add(const memory_usage& other);
+
+  std::size_t total_bytes() const {
+    return user_table_bytes + friend_set_bytes + purchase_history_bytes + cache_bytes;
+  }
+
+  // function to write the estimate with per-user averages to a stream
+  // input: out - output stream
+  void print(std::ostream& out) const;
+};
+
+#endif /* MEMORY_USAGE_H_ */
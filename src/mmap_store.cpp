@@ -0,0 +1,329 @@
+/*
+ * mmap_store.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "mmap_store.h"
+
+using namespace std;
+
+// the purchase slots are written and read as raw bytes
+static_assert(sizeof(purchase_info) == 3 * sizeof(uint64_t),
+    "purchase_info must have no padding");
+static_assert(sizeof(user_id_t) == sizeof(uint64_t), "user ids must be 64-bit");
+
+bool mapped_file::open(const string& fname) {
+  close();
+  fd_ = ::open(fname.c_str(), O_RDONLY);
+  if (fd_ < 0)
+    return false;
+
+  struct stat st;
+  if (fstat(fd_, &st) != 0) {
+    close();
+    return false;
+  }
+  size_ = st.st_size;
+  // an empty file cannot be mapped, and nothing is read from it
+  if (size_ == 0)
+    return true;
+
+  data_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (data_ == MAP_FAILED) {
+    data_ = nullptr;
+    close();
+    return false;
+  }
+  // users are looked up in no particular order, so read-ahead mostly wastes memory
+  madvise(data_, size_, MADV_RANDOM);
+  return true;
+}
+
+void mapped_file::close() {
+  if (data_ != nullptr)
+    munmap(data_, size_);
+  if (fd_ >= 0)
+    ::close(fd_);
+  fd_ = -1;
+  data_ = nullptr;
+  size_ = 0;
+}
+
+mmap_store::mmap_store(const string& path, const size_t purchase_capacity,
+    const size_t merge_interval)
+    : path_(path), purchase_capacity_(purchase_capacity),
+      merge_interval_(merge_interval) {}
+
+bool mmap_store::build(const user_map& users) {
+  vector<user_id_t> ids;
+  ids.reserve(users.size());
+  for (const auto& user : users)
+    ids.push_back(user.first);
+  sort(ids.begin(), ids.end());
+
+  return build(ids, [&users](const user_id_t user_id, vector<uint64_t>& friends,
+      vector<purchase_info>& purchases) {
+    const user_info& user = users.find(user_id)->second;
+    friends.assign(user.get_friend_list().begin(), user.get_friend_list().end());
+    sort(friends.begin(), friends.end());
+    purchases.assign(user.get_purchase_record().begin(),
+        user.get_purchase_record().end());
+  });
+}
+
+bool mmap_store::map_files() {
+  if (!ids_.open(path_ + ".ids") || !offsets_.open(path_ + ".offsets")
+      || !adjacency_.open(path_ + ".adjacency") || !purchases_.open(path_ + ".purchases"))
+    return false;
+
+  n_users_ = ids_.size() / sizeof(uint64_t);
+  return offsets_.size() == (n_users_ + 1) * sizeof(uint64_t)
+      && purchases_.size() == n_users_ * purchase_record_bytes();
+}
+
+size_t mmap_store::find_index(const user_id_t user_id) const {
+  const uint64_t* ids = reinterpret_cast<const uint64_t*>(ids_.data());
+  const uint64_t* iter_id = lower_bound(ids, ids + n_users_, user_id);
+  if (iter_id == ids + n_users_ || *iter_id != user_id)
+    return n_users_;
+  return iter_id - ids;
+}
+
+const uint64_t* mmap_store::base_friends(const size_t index, size_t& n_friends) const {
+  const uint64_t* offsets = reinterpret_cast<const uint64_t*>(offsets_.data());
+  n_friends = offsets[index + 1] - offsets[index];
+  return reinterpret_cast<const uint64_t*>(adjacency_.data()) + offsets[index];
+}
+
+const purchase_info* mmap_store::base_purchases(const size_t index,
+    size_t& n_purchases) const {
+  const char* record = purchases_.data() + index * purchase_record_bytes();
+  uint64_t count;
+  memcpy(&count, record, sizeof(count));
+  n_purchases = count;
+  return reinterpret_cast<const purchase_info*>(record + sizeof(count));
+}
+
+bool mmap_store::base_has_friend(const size_t index, const user_id_t friend_id) const {
+  if (index >= n_users_)
+    return false;
+  size_t n_friends = 0;
+  const uint64_t* friends = base_friends(index, n_friends);
+  return binary_search(friends, friends + n_friends, friend_id);
+}
+
+void mmap_store::collect_user(const user_id_t user_id, vector<uint64_t>& friends,
+    vector<purchase_info>& purchases) const {
+  for_each_friend(user_id, [&friends](const user_id_t friend_id) {
+    friends.push_back(friend_id);
+  });
+  sort(friends.begin(), friends.end());
+
+  // the purchases in the delta are more recent than those in the files
+  const auto iter_delta = delta_.find(user_id);
+  if (iter_delta != delta_.end())
+    purchases.assign(iter_delta->second.purchases.begin(),
+        iter_delta->second.purchases.end());
+  const size_t index = find_index(user_id);
+  if (index < n_users_ && purchases.size() < purchase_capacity_) {
+    size_t n_purchases = 0;
+    const purchase_info* base = base_purchases(index, n_purchases);
+    purchases.insert(purchases.end(), base,
+        base + min(n_purchases, purchase_capacity_ - purchases.size()));
+  }
+}
+
+void mmap_store::merge() {
+  const auto start = chrono::steady_clock::now();
+
+  // the users of the new files: those in the files and the new ones in the delta
+  vector<user_id_t> ids(reinterpret_cast<const uint64_t*>(ids_.data()),
+      reinterpret_cast<const uint64_t*>(ids_.data()) + n_users_);
+  for (const auto& delta : delta_) {
+    if (find_index(delta.first) == n_users_)
+      ids.push_back(delta.first);
+  }
+  sort(ids.begin(), ids.end());
+
+  // the new files are written next to the mapped ones, then renamed over them;
+  // the old mappings stay valid until they are closed
+  const string tmp_path = path_ + ".tmp";
+  if (!write_files(tmp_path, ids, [this](const user_id_t user_id,
+      vector<uint64_t>& friends, vector<purchase_info>& purchases) {
+        collect_user(user_id, friends, purchases);
+      })) {
+    // keep the delta and try again after another merge interval
+    delta_updates_ = 0;
+    return;
+  }
+  for (const char* suffix : {".ids", ".offsets", ".adjacency", ".purchases"}) {
+    if (rename((tmp_path + suffix).c_str(), (path_ + suffix).c_str()) != 0) {
+      // the mapped files stay valid even if some were replaced; the delta is
+      // kept and the next merge writes all the files again
+      cerr << "Error: renaming " << tmp_path << suffix << " failed" << endl;
+      for (const char* tmp_suffix : {".ids", ".offsets", ".adjacency", ".purchases"})
+        remove((tmp_path + tmp_suffix).c_str());
+      delta_updates_ = 0;
+      return;
+    }
+  }
+
+  ids_.close();
+  offsets_.close();
+  adjacency_.close();
+  purchases_.close();
+  if (!map_files()) {
+    cerr << "Error: mapping " << path_ << " failed" << endl;
+    exit(EXIT_FAILURE);
+  }
+
+  delta_.clear();
+  delta_updates_ = 0;
+  ++merges_;
+  merge_seconds_ += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+void mmap_store::count_update() {
+  if (++delta_updates_ >= merge_interval_)
+    merge();
+}
+
+void mmap_store::add_purchase(const user_id_t user_id, const purchase_info& purchase,
+    const size_t limit, const uint64_t) {
+  // purchases older than the cutoff time are skipped when they are read,
+  // so they are not removed here
+  deque<purchase_info>& purchases = delta_[user_id].purchases;
+  purchases.push_front(purchase);
+  if (purchases.size() > limit)
+    purchases.pop_back();
+  count_update();
+}
+
+void mmap_store::change_friendship(const user_id_t id1, const user_id_t id2,
+    const bool befriend) {
+  const user_id_t ids[2][2] = {{id1, id2}, {id2, id1}};
+  for (const auto& pair : ids) {
+    user_delta& delta = delta_[pair[0]];
+    const bool in_files = base_has_friend(find_index(pair[0]), pair[1]);
+    if (befriend) {
+      delta.removed_friends.erase(pair[1]);
+      if (!in_files)
+        delta.added_friends.insert(pair[1]);
+    } else {
+      delta.added_friends.erase(pair[1]);
+      if (in_files)
+        delta.removed_friends.insert(pair[1]);
+    }
+  }
+  count_update();
+}
+
+unordered_set<user_id_t> mmap_store::get_friends_network(const user_id_t user_id,
+    const size_t D) {
+
+  // visited contains the user and the friends found so far
+  unordered_set<user_id_t> visited {user_id};
+  vector<user_id_t> frontier {user_id};
+  vector<user_id_t> next_frontier;
+
+  // expand the network one degree of separation at a time
+  for (size_t degree = 1; degree <= D && !frontier.empty(); ++degree) {
+    next_frontier.clear();
+    for (const user_id_t friend_id : frontier) {
+      for_each_friend(friend_id, [&](const user_id_t id) {
+        if (visited.insert(id).second)
+          next_frontier.push_back(id);
+      });
+    }
+    frontier.swap(next_frontier);
+  }
+
+  // remove user from the friend list
+  visited.erase(user_id);
+  return visited;
+}
+
+vector<purchase_info> mmap_store::friend_purchases(
+    const unordered_set<user_id_t>& friends_in_network,
+    const uint64_t cutoff_time, const size_t limit) {
+
+  // a run of purchases (most recent first) ends at the first one before cutoff_time
+  auto count_since = [cutoff_time](const purchase_info* first, const purchase_info* last) {
+    if (cutoff_time == 0)
+      return static_cast<size_t>(last - first);
+    return static_cast<size_t>(find_if(first, last, [cutoff_time](const purchase_info& p) {
+      return p.tm_info.purchase_time < cutoff_time;
+    }) - first);
+  };
+
+  vector<purchase_info> purchases;
+  purchases.reserve(limit * 2);
+  for (const user_id_t friend_id : friends_in_network) {
+    // the purchases of the delta and of the files are merged separately;
+    // the most recent `limit` of both runs are the user's recent purchases
+    size_t n_delta = 0;
+    const auto iter_delta = delta_.find(friend_id);
+    if (iter_delta != delta_.end()) {
+      const deque<purchase_info>& recent = iter_delta->second.purchases;
+      n_delta = recent.size();
+      auto last = recent.begin();
+      while (last != recent.end()
+          && (cutoff_time == 0 || last->tm_info.purchase_time >= cutoff_time))
+        ++last;
+      merge_recent_purchases(purchases, recent.begin(), last, limit);
+    }
+
+    const size_t index = find_index(friend_id);
+    if (index == n_users_ || n_delta >= limit)
+      continue;
+    size_t n_purchases = 0;
+    const purchase_info* base = base_purchases(index, n_purchases);
+    n_purchases = min(n_purchases, limit - n_delta);
+    merge_recent_purchases(purchases, base,
+        base + count_since(base, base + n_purchases), limit);
+  }
+
+  return purchases;
+}
+
+void mmap_store::add_memory_usage(memory_usage& usage) {
+  // only the delta is held in memory; the mapped files are in the page cache
+  usage.users += delta_.size();
+  usage.user_table_bytes += delta_.bucket_count() * sizeof(void*)
+      + delta_.size() * (sizeof(user_delta) + sizeof(user_id_t) + sizeof(void*));
+  for (const auto& delta : delta_) {
+    usage.friend_set_bytes += (delta.second.added_friends.size()
+        + delta.second.removed_friends.size()) * (sizeof(user_id_t) + sizeof(void*));
+    usage.purchase_history_bytes += delta.second.purchases.size() * sizeof(purchase_info);
+  }
+}
+
+void mmap_store::release_inactive_purchases(const uint64_t, size_t& released_users,
+    size_t& released_purchases) {
+  released_users = released_purchases = 0;
+}
+
+void mmap_store::print_stats(ostream& out) const {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  out << "mmap store users: " << n_users_ << "\n"
+      << "mmap store file bytes: " << ids_.size() + offsets_.size()
+          + adjacency_.size() + purchases_.size() << "\n"
+      << "mmap store delta users: " << delta_.size() << "\n"
+      << "mmap store merges: " << merges_ << "\n"
+      << "mmap store merge seconds: " << merge_seconds_ << "\n"
+      << "page faults: " << usage.ru_majflt << " major, "
+      << usage.ru_minflt << " minor\n";
+}
@@ -0,0 +1,256 @@
+/*
+ * mmap_store.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef MMAP_STORE_H_
+#define MMAP_STORE_H_
+
+#include <cstring>
+#include <string>
+#include <fstream>
+#include <algorithm>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
+#include "user_info.h"
+#include "user_backend.h"
+
+// mapped_file is a read-only memory mapping of a whole file
+class mapped_file {
+  private:
+    int fd_ = -1;
+    void* data_ = nullptr;
+    std::size_t size_ = 0;
+
+  public:
+    mapped_file() = default;
+    ~mapped_file() {close();}
+
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    // function to map a file
+    // input:  fname - name of the file
+    // return: true if the file is mapped
+    bool open(const std::string& fname);
+
+    // function to unmap the file
+    void close();
+
+    const char* data() const {return static_cast<const char*>(data_);}
+    std::size_t size() const {return size_;}
+};
+
+// mmap_store keeps the users in memory-mapped files, so graphs larger than RAM
+// can be scored and the OS page cache decides which parts stay resident:
+//   PATH.ids        sorted user ids
+//   PATH.offsets    start of each user's friends in PATH.adjacency (CSR)
+//   PATH.adjacency  sorted friend ids of all users
+//   PATH.purchases  per user, the number of purchases and a fixed number of
+//                   purchase slots (most recent first)
+// The files are only read while events are processed. Friendship changes and
+// purchases go to an in-memory delta, which is merged into new files after a
+// number of updates.
+class mmap_store : public user_backend {
+  private:
+    // user_delta holds the updates of a user since the files were written
+    struct user_delta {
+      // friends added or removed relative to the files
+      std::unordered_set<user_id_t> added_friends;
+      std::unordered_set<user_id_t> removed_friends;
+      // purchases made since the files were written (most recent first)
+      std::deque<purchase_info> purchases;
+    };
+
+    // prefix of the file names
+    std::string path_;
+    // the number of purchase slots of a user in the files
+    std::size_t purchase_capacity_;
+    // the number of delta updates after which the delta is merged into the files
+    std::size_t merge_interval_;
+
+    mapped_file ids_;
+    mapped_file offsets_;
+    mapped_file adjacency_;
+    mapped_file purchases_;
+    // the number of users in the files
+    std::size_t n_users_ = 0;
+
+    std::unordered_map<user_id_t, user_delta> delta_{};
+    std::size_t delta_updates_ = 0;
+
+    // counters
+    std::size_t merges_ = 0;
+    double merge_seconds_ = 0.0;
+
+    // function to obtain the bytes of a user's record in PATH.purchases
+    std::size_t purchase_record_bytes() const {
+      return sizeof(uint64_t) + purchase_capacity_ * sizeof(purchase_info);
+    }
+
+    // function to find a user in the files
+    // input:  user_id - a user id
+    // return: the index of the user, n_users_ if the user is not in the files
+    std::size_t find_index(const user_id_t user_id) const;
+
+    // function to obtain the friends of a user in the files
+    // inputs:  index - the index of the user
+    // outputs: n_friends - reference to the number of friends
+    // return:  pointer to the sorted friend ids
+    const uint64_t* base_friends(const std::size_t index, std::size_t& n_friends) const;
+
+    // function to obtain the purchases of a user in the files
+    // inputs:  index - the index of the user
+    // outputs: n_purchases - reference to the number of purchases
+    // return:  pointer to the purchases (most recent first)
+    const purchase_info* base_purchases(const std::size_t index,
+        std::size_t& n_purchases) const;
+
+    // function to check if a friendship is in the files
+    bool base_has_friend(const std::size_t index, const user_id_t friend_id) const;
+
+    // function to call f with every friend of a user (files and delta)
+    template <typename F>
+    void for_each_friend(const user_id_t user_id, F f) const;
+
+    // function to collect a user's friends and purchases from the files and delta
+    // inputs:  user_id - a user id
+    // outputs: friends - sorted friend ids
+    //          purchases - the most recent purchases (most recent first)
+    void collect_user(const user_id_t user_id, std::vector<uint64_t>& friends,
+        std::vector<purchase_info>& purchases) const;
+
+    // function to write the files
+    // inputs: prefix - prefix of the file names
+    //         ids - sorted user ids
+    //         fill - function filling the sorted friend ids and the recent
+    //                purchases (most recent first) of a user
+    // return: true if all files are written
+    template <typename Fill>
+    bool write_files(const std::string& prefix, const std::vector<user_id_t>& ids,
+        Fill fill) const;
+
+    // function to map the files
+    // return: true if all files are mapped
+    bool map_files();
+
+    // function to merge the delta into new files and map them
+    void merge();
+
+    // function to count a delta update and merge when there are enough
+    void count_update();
+
+  public:
+    // constructor
+    // inputs: path - prefix of the file names
+    //         purchase_capacity - the number of recent purchases kept per user (T)
+    //         merge_interval - the number of updates between merges
+    mmap_store(const std::string& path, const std::size_t purchase_capacity,
+        const std::size_t merge_interval);
+
+    // function to write users to the files and map them
+    // input:  users - the users
+    // return: true if the files are written and mapped
+    bool build(const user_map& users);
+
+    // function to write users to the files without holding them in memory
+    // inputs: ids - sorted user ids
+    //         fill - function filling the sorted friend ids and the recent
+    //                purchases (most recent first) of a user
+    // return: true if the files are written and mapped
+    template <typename Fill>
+    bool build(const std::vector<user_id_t>& ids, Fill fill) {
+      return write_files(path_, ids, fill) && map_files();
+    }
+
+    void add_purchase(const user_id_t user_id, const purchase_info& purchase,
+        const std::size_t limit, const uint64_t cutoff_time) override;
+
+    void change_friendship(const user_id_t id1, const user_id_t id2,
+        const bool befriend) override;
+
+    std::unordered_set<user_id_t> get_friends_network(const user_id_t user_id,
+        const std::size_t D) override;
+
+    std::vector<purchase_info> friend_purchases(
+        const std::unordered_set<user_id_t>& friends_in_network,
+        const uint64_t cutoff_time, const std::size_t limit) override;
+
+    void add_memory_usage(memory_usage& usage) override;
+
+    // the purchase histories in the files are not held in memory,
+    // so nothing is released
+    void release_inactive_purchases(const uint64_t cutoff_time,
+        std::size_t& released_users, std::size_t& released_purchases) override;
+
+    void print_stats(std::ostream& out) const override;
+};
+
+template <typename F>
+void mmap_store::for_each_friend(const user_id_t user_id, F f) const {
+  const auto iter_delta = delta_.find(user_id);
+  const user_delta* delta = iter_delta != delta_.end() ? &iter_delta->second : nullptr;
+
+  const std::size_t index = find_index(user_id);
+  if (index < n_users_) {
+    std::size_t n_friends = 0;
+    const uint64_t* friends = base_friends(index, n_friends);
+    for (std::size_t i = 0; i < n_friends; ++i) {
+      if (delta == nullptr || delta->removed_friends.count(friends[i]) == 0)
+        f(friends[i]);
+    }
+  }
+  if (delta != nullptr) {
+    for (const user_id_t friend_id : delta->added_friends)
+      f(friend_id);
+  }
+}
+
+template <typename Fill>
+bool mmap_store::write_files(const std::string& prefix,
+    const std::vector<user_id_t>& ids, Fill fill) const {
+
+  std::ofstream out_ids(prefix + ".ids", std::ios::binary | std::ios::trunc);
+  std::ofstream out_offsets(prefix + ".offsets", std::ios::binary | std::ios::trunc);
+  std::ofstream out_adjacency(prefix + ".adjacency", std::ios::binary | std::ios::trunc);
+  std::ofstream out_purchases(prefix + ".purchases", std::ios::binary | std::ios::trunc);
+
+  std::vector<uint64_t> friends;
+  std::vector<purchase_info> purchases;
+  std::vector<char> record(purchase_record_bytes());
+  uint64_t offset = 0;
+  out_offsets.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+
+  for (const user_id_t user_id : ids) {
+    friends.clear();
+    purchases.clear();
+    fill(user_id, friends, purchases);
+
+    const uint64_t id = user_id;
+    out_ids.write(reinterpret_cast<const char*>(&id), sizeof(id));
+    out_adjacency.write(reinterpret_cast<const char*>(friends.data()),
+        friends.size() * sizeof(uint64_t));
+    offset += friends.size();
+    out_offsets.write(reinterpret_cast<const char*>(&offset), sizeof(offset));
+
+    // unused slots are written as zeros, so every record has the same size
+    const uint64_t n_purchases = std::min(purchases.size(), purchase_capacity_);
+    std::fill(record.begin(), record.end(), 0);
+    std::memcpy(record.data(), &n_purchases, sizeof(n_purchases));
+    std::memcpy(record.data() + sizeof(n_purchases), purchases.data(),
+        n_purchases * sizeof(purchase_info));
+    out_purchases.write(record.data(), record.size());
+  }
+
+  out_ids.close();
+  out_offsets.close();
+  out_adjacency.close();
+  out_purchases.close();
+  return out_ids && out_offsets && out_adjacency && out_purchases;
+}
+
+#endif /* MMAP_STORE_H_ */
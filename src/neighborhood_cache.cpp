@@ -0,0 +1,169 @@
+/*
+ * neighborhood_cache.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <initializer_list>
+#include "neighborhood_cache.h"
+#include "stats_kernel.h"
+
+using namespace std;
+
+bool neighborhood_cache::is_live(const watcher& w) const {
+  const auto iter_entry = entries_.find(w.owner);
+  return iter_entry != entries_.end()
+      && iter_entry->second.generation == w.generation;
+}
+
+void neighborhood_cache::add_watcher(const user_id_t user_id, const watcher& w) {
+  vector<watcher>& user_watchers = watchers_[user_id];
+
+  // before the vector grows, drop watchers of entries that no longer exist,
+  // so the lists stay proportional to the live entries
+  if (user_watchers.size() == user_watchers.capacity()) {
+    auto end = user_watchers.begin();
+    for (const auto& curr_watcher : user_watchers) {
+      if (is_live(curr_watcher))
+        *end++ = curr_watcher;
+    }
+    user_watchers.erase(end, user_watchers.end());
+  }
+
+  user_watchers.push_back(w);
+}
+
+void neighborhood_cache::invalidate(const user_id_t owner) {
+  if (entries_.erase(owner))
+    ++invalidations_;
+}
+
+void neighborhood_cache::rebuild(cache_entry& entry) {
+  entry.stats = compute_stats(entry.window.begin(), entry.window.end(), amounts_);
+  entry.slides = 0;
+}
+
+const cache_entry* neighborhood_cache::find(const user_id_t owner,
+    const uint64_t cutoff_time) {
+  const auto iter_entry = entries_.find(owner);
+  if (iter_entry == entries_.end())
+    return nullptr;
+
+  cache_entry& entry = iter_entry->second;
+
+  // the oldest purchases are at the back of the window
+  while (!entry.window.empty()
+      && entry.window.back().tm_info.purchase_time < cutoff_time) {
+    entry.stats.pop(entry.window.back().amount);
+    entry.window.pop_back();
+    entry.updated = true;
+  }
+
+  // an entry that has not been slid since it was last read is an exact hit
+  if (!entry.updated)
+    ++exact_hits_;
+  entry.updated = false;
+
+  return &entry;
+}
+
+void neighborhood_cache::store(const user_id_t owner,
+    const unordered_set<user_id_t>& friends_in_network,
+    const vector<purchase_info>& purchases,
+    const running_stats& stats) {
+
+  ++full_recomputes_;
+
+  cache_entry& entry = entries_[owner];
+  entry.window.assign(purchases.begin(), purchases.end());
+  entry.stats = stats;
+  entry.slides = 0;
+  entry.generation = next_generation_++;
+  entry.updated = false;
+
+  // register the entry with every user in the network
+  const watcher w {owner, entry.generation};
+  for (const auto& friend_id : friends_in_network)
+    add_watcher(friend_id, w);
+}
+
+void neighborhood_cache::add_purchase(const user_id_t buyer_id,
+    const purchase_info& purchase, const size_t T) {
+
+  const auto iter_watchers = watchers_.find(buyer_id);
+  if (iter_watchers == watchers_.end())
+    return;
+
+  vector<watcher>& buyer_watchers = iter_watchers->second;
+  auto end = buyer_watchers.begin();
+  for (const auto& curr_watcher : buyer_watchers) {
+    const auto iter_entry = entries_.find(curr_watcher.owner);
+    if (iter_entry == entries_.end()
+        || iter_entry->second.generation != curr_watcher.generation)
+      continue;
+
+    // the new purchase is the most recent one in the network:
+    // add it to the front of the window and evict the oldest one
+    cache_entry& entry = iter_entry->second;
+    entry.window.push_front(purchase);
+    entry.stats.push(purchase.amount);
+    if (entry.window.size() > T) {
+      entry.stats.pop(entry.window.back().amount);
+      entry.window.pop_back();
+    }
+    entry.updated = true;
+
+    // recompute the statistics once per T slides, which keeps the cost O(1)
+    // per purchase while bounding the drift of the running updates
+    if (++entry.slides >= T)
+      rebuild(entry);
+    ++incremental_updates_;
+
+    *end++ = curr_watcher;
+  }
+  buyer_watchers.erase(end, buyer_watchers.end());
+}
+
+void neighborhood_cache::change_friendship(const user_id_t id1, const user_id_t id2) {
+  // the networks of both users may change
+  invalidate(id1);
+  invalidate(id2);
+
+  // a network that contains either user may gain or lose members
+  for (const user_id_t user_id : {id1, id2}) {
+    const auto iter_watchers = watchers_.find(user_id);
+    if (iter_watchers == watchers_.end())
+      continue;
+
+    for (const auto& curr_watcher : iter_watchers->second) {
+      if (is_live(curr_watcher))
+        invalidate(curr_watcher.owner);
+    }
+    watchers_.erase(iter_watchers);
+  }
+}
+
+void neighborhood_cache::clear() {
+  // swap with empty containers, so the bucket arrays are released as well
+  unordered_map<user_id_t, cache_entry>().swap(entries_);
+  unordered_map<user_id_t, vector<watcher>>().swap(watchers_);
+  vector<double>().swap(amounts_);
+}
+
+size_t neighborhood_cache::memory_bytes() const {
+  // hash-map buckets and nodes (a link and the stored pair per node)
+  size_t bytes = entries_.bucket_count() * sizeof(void*)
+      + entries_.size() * (sizeof(void*) + sizeof(*entries_.begin()))
+      + watchers_.bucket_count() * sizeof(void*)
+      + watchers_.size() * (sizeof(void*) + sizeof(*watchers_.begin()))
+      + amounts_.capacity() * sizeof(double);
+
+  // purchases of the windows, stored in 512-byte deque blocks
+  const size_t per_block = 512 / sizeof(purchase_info);
+  for (const auto& entry : entries_)
+    bytes += (entry.second.window.size() / per_block + 1) * 512;
+  for (const auto& user_watchers : watchers_)
+    bytes += user_watchers.second.capacity() * sizeof(watcher);
+  return bytes;
+}
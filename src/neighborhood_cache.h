@@ -0,0 +1,120 @@
+/*
+ * neighborhood_cache.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef NEIGHBORHOOD_CACHE_H_
+#define NEIGHBORHOOD_CACHE_H_
+
+#include <deque>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "user_info.h"
+#include "running_stats.h"
+
+// cache_entry stores the last T purchases in a user's network
+// together with their running statistics, so the mean and standard deviation
+// can be obtained without traversing the network again
+struct cache_entry {
+  // the last T purchases in the user's network (most recent first)
+  std::deque<purchase_info> window;
+  // mean and variance of the purchase amounts in the window
+  running_stats stats;
+  // the number of purchases added since the statistics were last recomputed
+  std::size_t slides;
+  // generation of the entry, used to recognize stale watchers
+  std::size_t generation;
+  // true if the window has changed since the entry was last read
+  bool updated;
+};
+
+// neighborhood_cache keeps one cache_entry per user whose network statistics
+// have been computed. An entry stays valid until a befriend or unfriend event
+// touches the user or a member of the user's network; a purchase made by a
+// member of the network slides the window instead of invalidating it.
+class neighborhood_cache {
+  private:
+    // watcher records that an entry depends on a user in the entry's network
+    struct watcher {
+      user_id_t owner;
+      std::size_t generation;
+    };
+
+    // cached entries indexed by the id of the user owning the network
+    std::unordered_map<user_id_t, cache_entry> entries_{};
+    // for each user, the entries whose network contains that user
+    std::unordered_map<user_id_t, std::vector<watcher>> watchers_{};
+    // generation assigned to the next stored entry
+    std::size_t next_generation_ = 0;
+
+    // buffer holding the amounts of a long window while its statistics are recomputed
+    std::vector<double> amounts_{};
+
+    // counters
+    std::size_t exact_hits_ = 0;
+    std::size_t incremental_updates_ = 0;
+    std::size_t full_recomputes_ = 0;
+    std::size_t invalidations_ = 0;
+
+    // function to check if a watcher still refers to a live entry
+    bool is_live(const watcher& w) const;
+
+    // function to register an entry as a watcher of a user
+    void add_watcher(const user_id_t user_id, const watcher& w);
+
+    // function to remove the entry of a user
+    void invalidate(const user_id_t owner);
+
+    // function to recompute the statistics of an entry from its window,
+    //          so rounding errors of the sliding updates do not accumulate
+    void rebuild(cache_entry& entry);
+
+  public:
+    neighborhood_cache() = default;
+
+    // function to find the cached entry of a user's network,
+    //          removing purchases that have left the time window
+    // inputs: owner - a user id
+    //         cutoff_time - purchases made before this time are removed (0 keeps all)
+    // return: pointer to the entry, nullptr if no valid entry exists
+    const cache_entry* find(const user_id_t owner, const uint64_t cutoff_time);
+
+    // function to store the result of a full computation
+    // inputs: owner - a user id
+    //         friends_in_network - friend ids of the user within D degree of separation
+    //         purchases - the last T purchases in the network (most recent first)
+    //         stats - statistics of the purchase amounts
+    void store(const user_id_t owner,
+        const std::unordered_set<user_id_t>& friends_in_network,
+        const std::vector<purchase_info>& purchases,
+        const running_stats& stats);
+
+    // function to add a purchase to every entry whose network contains the buyer,
+    //          removing the oldest purchase if a window holds more than T purchases
+    // inputs:  buyer_id - id of the user who made the purchase
+    //          purchase - the purchase information
+    //          T - the maximum number of purchases in a window
+    void add_purchase(const user_id_t buyer_id, const purchase_info& purchase,
+        const std::size_t T);
+
+    // function to invalidate all entries affected by a befriend or unfriend event
+    // inputs: id1, id2 - ids of the two users
+    void change_friendship(const user_id_t id1, const user_id_t id2);
+
+    // function to drop all entries
+    void clear();
+
+    std::size_t exact_hits() const {return exact_hits_;}
+    std::size_t incremental_updates() const {return incremental_updates_;}
+    std::size_t full_recomputes() const {return full_recomputes_;}
+    std::size_t invalidations() const {return invalidations_;}
+    std::size_t size() const {return entries_.size();}
+
+    // function to estimate the bytes held by the entries and watcher lists
+    std::size_t memory_bytes() const;
+};
+
+#endif /* NEIGHBORHOOD_CACHE_H_ */
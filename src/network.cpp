@@ -13,7 +13,21 @@
 #include <vector>
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <thread>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <csignal>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
 #include "network.h"
+#include "stats_kernel.h"
 
 using namespace std;
 using namespace rapidjson;
@@ -26,6 +40,146 @@ struct friend_degree {
   size_t degree;
 };
 
+// batch_line is a line of batch_log.json after it is parsed by a loading thread
+struct batch_line {
+  // true if the line sets D and T
+  bool is_header = false;
+  // true if the line is a valid event
+  bool is_event = false;
+  std::size_t D = 0;
+  std::size_t T = 0;
+  event e;
+  // the position of a purchase among the purchases of its chunk
+  std::size_t chunk_order = 0;
+  // error messages of the line, reported in line order after parsing
+  std::string errors;
+  // the kind of the error
+  input_error error = input_error::not_object;
+};
+
+// batch_chunk is a range of lines parsed by one loading thread
+struct batch_chunk {
+  std::size_t first_line = 0;
+  std::size_t last_line = 0;
+  // the number of purchases in the chunk
+  std::size_t purchases = 0;
+  // the number of purchases in the preceding chunks
+  std::size_t purchases_before = 0;
+  // the latest event time of the chunk
+  uint64_t latest_time = 0;
+  bool has_errors = false;
+  // the first event line and the last header line of the chunk
+  std::size_t first_event = SIZE_MAX;
+  std::size_t last_header = 0;
+  bool has_header = false;
+  // lines of the chunk to be applied by each building thread, in line order
+  std::vector<std::vector<std::size_t>> owned_lines;
+};
+
+// batch_partition holds the users built by one loading thread. They are
+// allocated from an arena of the partition, so the threads never wait for
+// each other's allocations on the lock of a shared arena
+struct batch_partition {
+  pool_arena arena;
+  user_map users;
+
+  // constructor
+  // input: use_arena - false to allocate the users with operator new
+  explicit batch_partition(const bool use_arena)
+      : users(user_map_allocator(use_arena ? &arena : nullptr)) {}
+};
+
+// function to obtain the building thread owning a user
+static inline size_t owner_of(const user_id_t user_id, const size_t n_threads) {
+  return std::hash<user_id_t>()(user_id) % n_threads;
+}
+
+// function to parse a chunk of batch_log.json
+// inputs:  lines - all lines of the log
+//          n_threads - the number of building threads
+//          use_scanner - true to read the lines with the event scanner when they allow
+//          trusted - true to read the lines in the trusted layout first
+// outputs: parsed - the parsed lines (only the chunk is written)
+//          chunk - reference to the chunk, filled with its purchases and owned lines
+static void parse_batch_chunk(const vector<string>& lines, const size_t n_threads,
+    const bool use_scanner, const bool trusted, vector<batch_line>& parsed,
+    batch_chunk& chunk) {
+
+  chunk.owned_lines.assign(n_threads, vector<size_t>());
+  ostringstream err;
+  for (size_t i = chunk.first_line; i < chunk.last_line; ++i) {
+    const string& line = lines[i];
+    batch_line& p = parsed[i];
+    if (line.empty())
+      continue;
+
+    scan_result scanned = use_scanner ?
+        scan_event_line(line, p.e, p.D, p.T, trusted) : scan_result::fallback;
+    if (scanned == scan_result::fallback) {
+      Document doc;
+      doc.Parse(line.c_str());
+      if (!doc.IsObject()) {
+        p.errors = "Error: doc is not object\n";
+        p.error = input_error::not_object;
+        chunk.has_errors = true;
+        continue;
+      }
+
+      if (doc.HasMember("D")) {
+        if (!read_parameters(doc, p.D, p.T, err)) {
+          p.errors = err.str();
+          p.error = input_error::invalid_member;
+          err.str("");
+          chunk.has_errors = true;
+          continue;
+        }
+        scanned = scan_result::parameters;
+      } else if (!doc.HasMember("event_type")) {
+        p.errors = "Error: event_type is present in this line\n";
+        p.error = input_error::missing_event_type;
+        chunk.has_errors = true;
+        continue;
+      } else if (!read_event(doc, p.e, err, p.error)) {
+        p.errors = err.str();
+        err.str("");
+        chunk.has_errors = true;
+        continue;
+      }
+    }
+
+    if (scanned == scan_result::parameters) {
+      p.is_header = true;
+      chunk.last_header = i;
+      chunk.has_header = true;
+      continue;
+    }
+    p.is_event = true;
+    if (chunk.first_event == SIZE_MAX)
+      chunk.first_event = i;
+    chunk.latest_time = max(chunk.latest_time, p.e.time);
+
+    const event& e = p.e;
+    if (e.kind == event_kind::purchase) {
+      p.chunk_order = chunk.purchases++;
+      chunk.owned_lines[owner_of(e.id1, n_threads)].push_back(i);
+      continue;
+    }
+
+    // a friendship is applied by the owners of both users
+    const size_t owner1 = owner_of(e.id1, n_threads);
+    const size_t owner2 = owner_of(e.id2, n_threads);
+    chunk.owned_lines[owner1].push_back(i);
+    if (owner2 != owner1)
+      chunk.owned_lines[owner2].push_back(i);
+    if (e.id1 == e.id2) {
+      p.errors = "Error: befriend or unfriend event for same user "
+          + to_string(e.id1) + "\n";
+      p.error = input_error::same_user;
+      chunk.has_errors = true;
+    }
+  }
+}
+
 // function to convert a double to a string
 // and only keep two digits after decimal
 string double_to_string(const double value)
@@ -35,114 +189,487 @@ string double_to_string(const double value)
   return os.str();
 }
 
-// function to compare the time of two purchases
-// inputs: purchase_1 - purchase information of the first purchase
-//         purchase_2 - purchase information of the second purchase
-// return: true if the first purchase is made earlier than the second purchase
-//         false otherwise
-bool comp_purchase_time(const purchase_info& purchase_1,
-    const purchase_info& purchase_2) {
-
-//  // If purchases do not come in time order,
-//  // unblock the following commented codes
-//  // get the purchase times
-//  uint64_t purchase1_time = purchase_1.tm_info.purchase_time;
-//  uint64_t purchase2_time = purchase_2.tm_info.purchase_time;
-//
-//  if(purchase1_time < purchase2_time)
-//    return true;
-//  if(purchase1_time > purchase2_time)
-//    return false;
-
-  // check purchase order
-  size_t purchase1_order = purchase_1.tm_info.purchase_order;
-  size_t purchase2_order = purchase_2.tm_info.purchase_order;
-  return purchase1_order < purchase2_order;
-}
-
-const std::unordered_map<user_id_t, user_info>& network::get_network() {
+const user_map& network::get_network() {
   return map_users_;
 }
 
-void network::process_batch_entries(const Document& entry) {
+void network::process_batch_event(const event& e) {
 
-  string event_type = entry["event_type"].GetString();
-  string timestamp = entry["timestamp"].GetString();
+  check_memory(e.time);
 
-  if (!event_type.compare("purchase")) {
+  if (e.kind == event_kind::purchase) {
     // this is a purchase event
     // increase purchase order by one
     const size_t purchase_order = ++purchase_order_;
 
-    user_id_t id = stoi(entry["id"].GetString());
-    user_info& curr_user = map_users_[id];
-
-    double amount = stod(entry["amount"].GetString());
+    user_info& curr_user = get_user(e.id1);
+    mark_dirty(e.id1);
 
     // update purchases
-    curr_user.update_purchases(timestamp, purchase_order, amount, T_);
-  }
-  else if (!event_type.compare("befriend")
-      || !event_type.compare("unfriend")) {
+    curr_user.update_purchases(e.time, purchase_order, e.amount, purchase_limit());
+
+    // drop the purchases that have left the time window
+    if (time_window_ > 0)
+      curr_user.remove_purchases_before(window_cutoff(e.time));
+  } else {
     // this is a befriend or unfriend event
+    user_info& curr_user1 = get_user(e.id1);
+    user_info& curr_user2 = get_user(e.id2);
+    mark_dirty(e.id1);
+    mark_dirty(e.id2);
+
+    if (e.id1 != e.id2) {
+      if (e.kind == event_kind::befriend) {
+        curr_user1.add_friend(e.id2);
+        curr_user2.add_friend(e.id1);
+      } else {
+        curr_user1.remove_friend(e.id2);
+        curr_user2.remove_friend(e.id1);
+      }
+    } else if (errors_.count(input_error::same_user)) {
+        cerr << "Error: befriend or unfriend event for same user "
+            << e.id1 << endl;
+    }
+  }
+}
 
-    user_id_t id1 = stoi(entry["id1"].GetString());
-    user_id_t id2 = stoi(entry["id2"].GetString());
+// the number of events between two checks of the memory budget
+static const size_t memory_check_interval = 4096;
 
-    user_info& curr_user1 = map_users_[id1];
-    user_info& curr_user2 = map_users_[id2];
+void network::check_memory(const uint64_t event_time) {
+  latest_time_ = max(latest_time_, event_time);
 
-    if (id1 != id2) {
-      if (!event_type.compare("befriend")) {
-        curr_user1.add_friend(id2);
-        curr_user2.add_friend(id1);
-      } else {
-        curr_user1.remove_friend(id2);
-        curr_user2.remove_friend(id1);
-      }
+  // the sweep walks all users, so it runs at most once per user or event
+  if (spill_ != nullptr && !backend_) {
+    if (events_until_spill_ > 0) {
+      --events_until_spill_;
     } else {
-        cerr << "Error: befriend or unfriend event for same user "
-            << id1 << endl;
+      events_until_spill_ = max(memory_check_interval, map_users_.size());
+      spill_inactive_users();
     }
-  } else {
-      cerr << "Error: can not recognize this event type: "
-          << event_type << endl;
   }
+
+  if (memory_budget_ == 0)
+    return;
+  if (events_until_memory_check_ > 0) {
+    --events_until_memory_check_;
+    return;
+  }
+
+  // without the arena the estimate walks all users, so it is made at most
+  // once per user added or event processed
+  events_until_memory_check_ = memory_check_interval;
+  if (map_users_.get_allocator().arena() == nullptr)
+    events_until_memory_check_ = max(memory_check_interval, map_users_.size());
+  enforce_memory_budget();
 }
 
-void network::read_batch_log(ifstream& in_batch_log) {
+size_t network::current_memory_bytes() const {
+  if (map_users_.get_allocator().arena() == nullptr)
+    return get_memory_usage().total_bytes();
+  return arena_.used_bytes() + (backend_ ? backend_->arena_bytes() : 0)
+      + (use_cache_ ? cache_.memory_bytes() : 0);
+}
+
+void network::enforce_memory_budget() {
+  size_t bytes = current_memory_bytes();
+  if (bytes <= memory_budget_) {
+    over_budget_reported_ = false;
+    return;
+  }
+
+  // first, drop the cached statistics; they are recomputed on demand
+  if (use_cache_ && cache_.size() > 0) {
+    const size_t n_entries = cache_.size();
+    cache_.clear();
+    use_cache_ = false;
+    const size_t new_bytes = current_memory_bytes();
+    cerr << "Memory budget: dropped " << n_entries << " cached networks ("
+        << (bytes > new_bytes ? bytes - new_bytes : 0)
+        << " bytes) and disabled caching" << endl;
+    bytes = new_bytes;
+    if (bytes <= memory_budget_)
+      return;
+  }
+
+  // then release the purchase histories of users inactive beyond the horizon
+  if (latest_time_ > inactive_horizon_) {
+    size_t released_users = 0, released_purchases = 0;
+    release_inactive_purchases(latest_time_ - inactive_horizon_,
+        released_users, released_purchases);
+    if (released_users > 0) {
+      const size_t new_bytes = current_memory_bytes();
+      cerr << "Memory budget: released " << released_purchases << " purchases of "
+          << released_users << " users inactive for more than " << inactive_horizon_
+          << " seconds (" << (bytes > new_bytes ? bytes - new_bytes : 0) << " bytes)"
+          << endl;
+      bytes = new_bytes;
+    }
+  }
+
+  if (bytes <= memory_budget_) {
+    over_budget_reported_ = false;
+    return;
+  }
+  if (!over_budget_reported_) {
+    cerr << "Memory budget: " << bytes << " bytes in use after shedding, over the budget of "
+        << memory_budget_ << " bytes" << endl;
+    over_budget_reported_ = true;
+  }
+
+  // nothing more can be shed until users become inactive,
+  // so wait before walking the users again
+  events_until_memory_check_ = max(memory_check_interval, map_users_.size());
+}
+
+void network::spill_inactive_users() {
+  if (latest_time_ <= spill_after_)
+    return;
+  const uint64_t cutoff_time = latest_time_ - spill_after_;
+
+  for (auto iter_user = map_users_.begin(); iter_user != map_users_.end(); ) {
+    // the most recent purchase is at the front of the record; a user without
+    // purchases (only friendships) has no activity time, and spilling it
+    // would only have the next traversal read it back
+    const purchase_record& purchases = iter_user->second.get_purchase_record();
+    if (purchases.empty() || purchases.front().tm_info.purchase_time >= cutoff_time
+        || !spill_->spill(iter_user->first, iter_user->second)) {
+      ++iter_user;
+      continue;
+    }
+    iter_user = map_users_.erase(iter_user);
+  }
+
+  // rewrite the file once the records read back outweigh the live ones
+  if (spill_->dead_bytes() > spill_->file_bytes() - spill_->dead_bytes())
+    spill_->compact();
+}
+
+const user_info* network::find_user(const user_id_t user_id) {
+  const auto iter_user = map_users_.find(user_id);
+  if (iter_user != map_users_.end())
+    return &iter_user->second;
+  if (spill_ == nullptr || !spill_->contains(user_id))
+    return nullptr;
+
+  // read the evicted user back
+  user_info& user = map_users_[user_id];
+  spill_->fault_in(user_id, user);
+  return &user;
+}
+
+user_info& network::get_user(const user_id_t user_id) {
+  const auto iter_user = map_users_.find(user_id);
+  if (iter_user != map_users_.end())
+    return iter_user->second;
+
+  // create the user, or read it back if it was evicted
+  user_info& user = map_users_[user_id];
+  if (spill_ != nullptr)
+    spill_->fault_in(user_id, user);
+  return user;
+}
+
+bool network::set_spill_file(const char* fname, const uint64_t inactive_seconds) {
+  spill_.reset(new spill_store());
+  spill_after_ = inactive_seconds;
+  if (!spill_->open(fname)) {
+    spill_.reset();
+    return false;
+  }
+  return true;
+}
+
+void network::release_inactive_purchases(const uint64_t cutoff_time,
+    size_t& released_users, size_t& released_purchases) {
+  if (backend_) {
+    backend_->release_inactive_purchases(cutoff_time, released_users, released_purchases);
+    return;
+  }
+
+  released_users = released_purchases = 0;
+  for (auto& user : map_users_) {
+    const purchase_record& purchases = user.second.get_purchase_record();
+    if (purchases.empty() || purchases.front().tm_info.purchase_time >= cutoff_time)
+      continue;
+    ++released_users;
+    released_purchases += user.second.release_purchases();
+    mark_dirty(user.first);
+  }
+}
+
+memory_usage network::get_memory_usage() const {
+  memory_usage usage;
+  if (backend_)
+    backend_->add_memory_usage(usage);
+  else
+    usage.add_users(map_users_);
+  if (use_cache_)
+    usage.cache_bytes = cache_.memory_bytes();
+  return usage;
+}
+
+void network::report_late_event(const event& e) {
+  if (late_event_log_ != nullptr)
+    *late_event_log_ << e.line << "\n";
+}
+
+void network::read_batch_log(istream& in_batch_log) {
+
+  const auto start_time = chrono::steady_clock::now();
+
+  // the reorder buffer needs the events in input order, and the threads
+  // build the users from scratch
+  if (batch_threads_ > 1 && reorder_ == nullptr && map_users_.empty()) {
+    read_batch_log_parallel(in_batch_log);
+    batch_load_seconds_ = chrono::duration<double>(
+        chrono::steady_clock::now() - start_time).count();
+    return;
+  }
 
   string line;
+  event e;
   while (getline(in_batch_log, line)) {
     // skip empty lines
     if (line.empty())
       continue;
 
-    Document doc;
-    doc.Parse(line.c_str());
-    if(!doc.IsObject()) {
-      cerr << "Error: doc is not object" << endl;
+    // the scanner reads the usual lines; the others are parsed with rapidjson
+    scan_result scanned = use_scanner_ ?
+        scan_event_line(line, e, D_, T_, trusted_input_) : scan_result::fallback;
+    if (scanned == scan_result::parameters)
       continue;
+    if (scanned == scan_result::fallback) {
+      Document doc;
+      doc.Parse(line.c_str());
+      if(!doc.IsObject()) {
+        errors_.reject(input_error::not_object, "Error: doc is not object\n", line);
+        continue;
+      }
+
+      ostringstream err;
+      if (doc.HasMember("D")) {
+        // read and D & T
+        if (!read_parameters(doc, D_, T_, err))
+          errors_.reject(input_error::invalid_member, err.str(), line);
+        continue;
+      }
+      if (!doc.HasMember("event_type")) {
+        errors_.reject(input_error::missing_event_type,
+            "Error: event_type is present in this line\n", line);
+        continue;
+      }
+      // process different events
+      input_error error;
+      if (!read_event(doc, e, err, error)) {
+        errors_.reject(error, err.str(), line);
+        continue;
+      }
     }
 
-    if (doc.HasMember("D")) {
-      // read and D & T
-      D_ = stoi(doc["D"].GetString());
-      T_ = stoi(doc["T"].GetString());
+    if (reorder_ == nullptr) {
+      process_batch_event(e);
+      continue;
+    }
 
-    } else if(doc.HasMember("event_type")) {
-      // process different events
-      process_batch_entries(doc);
-    } else {
-      cerr << "Error: event_type is present in this line" << endl;
+    // hold the event until it can be released in time order
+    e.line = std::move(line);
+    if (!reorder_->push(e))
+      report_late_event(e);
+    while (reorder_->pop_ready(e))
+      process_batch_event(e);
+  }
+
+  // release the events still held in the buffer
+  if (reorder_ != nullptr) {
+    while (reorder_->pop_any(e))
+      process_batch_event(e);
+  }
+  batch_load_seconds_ = chrono::duration<double>(
+      chrono::steady_clock::now() - start_time).count();
+}
+
+void network::read_binary_batch_log(binary_event_log& in_batch_log) {
+
+  const auto start_time = chrono::steady_clock::now();
+
+  binary_record r;
+  event e;
+  while (in_batch_log.read(r)) {
+    if (r.type == binary_record_type::parameters) {
+      D_ = r.D;
+      T_ = r.T;
+      continue;
     }
+    binary_record_to_event(r, e);
+
+    if (reorder_ == nullptr) {
+      process_batch_event(e);
+      continue;
+    }
+
+    // hold the event until it can be released in time order
+    e.line = format_event_line(r);
+    if (!reorder_->push(e))
+      report_late_event(e);
+    while (reorder_->pop_ready(e))
+      process_batch_event(e);
   }
+
+  // release the events still held in the buffer
+  if (reorder_ != nullptr) {
+    while (reorder_->pop_any(e))
+      process_batch_event(e);
+  }
+  batch_load_seconds_ = chrono::duration<double>(
+      chrono::steady_clock::now() - start_time).count();
 }
 
-unordered_set<user_id_t> network::get_friends_network(const user_id_t user_id) {
-  // obtain user map
-  const unordered_map<size_t, user_info>& map_users = get_network();
+void network::read_batch_log_parallel(istream& in_batch_log) {
+
+  vector<string> lines;
+  string line;
+  while (getline(in_batch_log, line))
+    lines.push_back(std::move(line));
+
+  // parse the lines in one chunk per thread
+  const size_t n_threads = batch_threads_;
+  vector<batch_line> parsed(lines.size());
+  vector<batch_chunk> chunks(n_threads);
+  vector<thread> threads;
+  for (size_t k = 0; k < n_threads; ++k) {
+    chunks[k].first_line = lines.size() * k / n_threads;
+    chunks[k].last_line = lines.size() * (k + 1) / n_threads;
+    threads.emplace_back(parse_batch_chunk, std::cref(lines), n_threads, use_scanner_,
+        trusted_input_, std::ref(parsed), std::ref(chunks[k]));
+  }
+  for (auto& t : threads)
+    t.join();
+  threads.clear();
+
+  // a purchase's order is its position among all purchases of the log
+  size_t purchases = 0;
+  size_t first_event = SIZE_MAX, last_header = 0;
+  bool has_header = false;
+  for (auto& chunk : chunks) {
+    chunk.purchases_before = purchases;
+    purchases += chunk.purchases;
+    first_event = min(first_event, chunk.first_event);
+    latest_time_ = max(latest_time_, chunk.latest_time);
+    if (chunk.has_header) {
+      last_header = chunk.last_header;
+      has_header = true;
+    }
+  }
+
+  // D and T changed between events: replay the parsed lines in one thread,
+  // so every purchase is kept with the T in effect when it was read
+  if (has_header && first_event != SIZE_MAX && last_header > first_event) {
+    for (size_t i = 0; i < parsed.size(); ++i) {
+      const batch_line& p = parsed[i];
+      if (p.is_event) {
+        // the event reports its own errors when it is processed
+        process_batch_event(p.e);
+        continue;
+      }
+      if (!p.errors.empty())
+        errors_.reject(p.error, p.errors, lines[i]);
+      if (p.is_header) {
+        D_ = p.D;
+        T_ = p.T;
+      }
+    }
+    return;
+  }
+
+  // report errors in line order, as reading in one thread does
+  for (const auto& chunk : chunks) {
+    if (!chunk.has_errors && !chunk.has_header)
+      continue;
+    for (size_t i = chunk.first_line; i < chunk.last_line; ++i) {
+      const batch_line& p = parsed[i];
+      if (p.is_event && !p.errors.empty())
+        errors_.report(p.error, p.errors);
+      else if (!p.errors.empty())
+        errors_.reject(p.error, p.errors, lines[i]);
+      if (p.is_header) {
+        D_ = p.D;
+        T_ = p.T;
+      }
+    }
+  }
+  lines.clear();
+  lines.shrink_to_fit();
+
+  // every thread replays the events of the users it owns in line order,
+  // so friendships changed several times end as in the serial replay
+  const size_t limit = purchase_limit();
+  const size_t order_base = purchase_order_;
+  const bool use_arena = map_users_.get_allocator().arena() != nullptr;
+  vector<unique_ptr<batch_partition>> partitions;
+  for (size_t k = 0; k < n_threads; ++k)
+    partitions.emplace_back(new batch_partition(use_arena));
+  for (size_t k = 0; k < n_threads; ++k) {
+    threads.emplace_back([this, k, n_threads, limit, order_base,
+                          &chunks, &parsed, &partitions] () {
+      user_map& owned_users = partitions[k]->users;
+      for (const auto& chunk : chunks) {
+        for (const size_t i : chunk.owned_lines[k]) {
+          const event& e = parsed[i].e;
+          if (e.kind == event_kind::purchase) {
+            const size_t purchase_order = order_base + chunk.purchases_before
+                + parsed[i].chunk_order + 1;
+            user_info& curr_user = owned_users[e.id1];
+            curr_user.update_purchases(e.time, purchase_order, e.amount, limit);
+            if (time_window_ > 0)
+              curr_user.remove_purchases_before(window_cutoff(e.time));
+            continue;
+          }
+
+          // apply the side of the friendship stored by this thread's users
+          const bool befriend = e.kind == event_kind::befriend;
+          if (owner_of(e.id1, n_threads) == k) {
+            user_info& curr_user1 = owned_users[e.id1];
+            if (e.id1 != e.id2 && befriend)
+              curr_user1.add_friend(e.id2);
+            else if (e.id1 != e.id2)
+              curr_user1.remove_friend(e.id2);
+          }
+          if (owner_of(e.id2, n_threads) == k && e.id1 != e.id2) {
+            user_info& curr_user2 = owned_users[e.id2];
+            if (befriend)
+              curr_user2.add_friend(e.id1);
+            else
+              curr_user2.remove_friend(e.id1);
+          }
+        }
+      }
+    });
+  }
+  for (auto& t : threads)
+    t.join();
+  purchase_order_ = order_base + purchases;
+
+  // merge the users of all threads; every user is owned by exactly one thread.
+  // The friends and purchases are copied into the network's arena, and each
+  // partition is released as soon as its users are merged
+  size_t n_users = 0;
+  for (const auto& partition : partitions)
+    n_users += partition->users.size();
+  map_users_.reserve(n_users);
+  for (auto& partition : partitions) {
+    for (auto& user : partition->users)
+      map_users_.emplace(user.first, std::move(user.second));
+    partition.reset();
+  }
 
+  if (spill_ != nullptr)
+    spill_inactive_users();
+  if (memory_budget_ > 0)
+    enforce_memory_budget();
+}
+
+unordered_set<user_id_t> network::get_friends_network(const user_id_t user_id) {
   // firends_in_network contains id's of all friends in the network
   unordered_set<user_id_t> friends_in_network;
   // create a queue to store the friend ids visited so far
@@ -156,11 +683,12 @@ unordered_set<user_id_t> network::get_friends_network(const user_id_t user_id) {
     user_id_t curr_friend_id = curr_friend_degree.friend_id;
     size_t curr_degree = curr_friend_degree.degree + 1;
 
-    const auto iter_curr_friend = map_users.find(curr_friend_id);
+    // find the friend (reading it back if it was evicted)
+    const user_info* ptr_curr_friend = find_user(curr_friend_id);
     // if this friend exist, continue with the following process
-    if (iter_curr_friend != map_users.end()) {
-      const user_info& curr_friend = iter_curr_friend->second;
-      const unordered_set<user_id_t>& curr_user_friends = curr_friend.get_friend_list();
+    if (ptr_curr_friend != nullptr) {
+      const user_info& curr_friend = *ptr_curr_friend;
+      const friend_set& curr_user_friends = curr_friend.get_friend_list();
 
       // at the highest separation level, skip those friends's friends
       if (curr_degree == D_ + 1) {
@@ -178,7 +706,7 @@ unordered_set<user_id_t> network::get_friends_network(const user_id_t user_id) {
 
         friends_in_network.insert(friend_id);
       }
-    } else
+    } else if (errors_.count(input_error::missing_user))
       cerr << "Error: can not find friend with id " << curr_friend_id << endl;
   }
 
@@ -188,126 +716,139 @@ unordered_set<user_id_t> network::get_friends_network(const user_id_t user_id) {
   return friends_in_network;
 }
 
+size_t network::purchase_limit() const {
+  // the cap applies only to the time-window baseline
+  return time_window_ > 0 && window_max_purchases_ ? window_max_purchases_ : T_;
+}
+
+uint64_t network::window_cutoff(const uint64_t purchase_time) const {
+  if (time_window_ == 0)
+    return 0;
+  // purchases within the window (inclusive) are kept, cutoff_time 0 keeps all
+  return purchase_time > time_window_ ? purchase_time - time_window_ : 0;
+}
+
 vector<purchase_info> network::friend_purchases(
-    const unordered_set<user_id_t>& firends_in_network) {
+    const unordered_set<user_id_t>& firends_in_network, const uint64_t cutoff_time) {
 
   // create a vector for storing all the most recent T purchase
+  const size_t limit = purchase_limit();
   vector<purchase_info> purchases;
-  purchases.reserve(T_*2);
+  purchases.reserve(limit*2);
 
-  // obtain user map
-  const unordered_map<size_t, user_info>& map_users = get_network();
-  
   // obtain the first friend in the network
   const user_id_t first_friend_id = *firends_in_network.begin();
-  const auto iter_first_friend = map_users.find(first_friend_id);
+  const user_info* ptr_first_friend = find_user(first_friend_id);
 
   // check if this friend exist
-  if (iter_first_friend != map_users.end()) {
-    const user_info& first_friend = iter_first_friend->second;
-    const deque<purchase_info>& first_friend_purchases = first_friend.get_purchase_record();
-
-    // copy the first friend's purchase to purchases
-    if (!first_friend_purchases.empty())
-      purchases.insert(purchases.end(),
-          first_friend_purchases.begin(), first_friend_purchases.end());
-  } else
+  if (ptr_first_friend != nullptr) {
+    const user_info& first_friend = *ptr_first_friend;
+    const purchase_record& first_friend_purchases = first_friend.get_purchase_record();
+
+    // copy the first friend's purchase (within the time window) to purchases
+    const size_t size_first_purchases = first_friend.count_purchases_since(cutoff_time);
+    if (size_first_purchases > 0)
+      purchases.insert(purchases.end(), first_friend_purchases.begin(),
+          first_friend_purchases.begin() + size_first_purchases);
+  } else if (errors_.count(input_error::missing_user))
     cerr << "Error: can not find the first friend with id " << first_friend_id << endl;
 
   for (auto iter_friend = ++firends_in_network.begin();
       iter_friend != firends_in_network.end(); ++iter_friend) {
 
     const user_id_t friend_id = *iter_friend;
-    const auto iter_this_friend = map_users.find(friend_id);
+    const user_info* ptr_this_friend = find_user(friend_id);
 
     // if this friend exist, continue with the following process
-    if (iter_this_friend != map_users.end()) {
-
-      const user_info& curr_friend = iter_this_friend->second;
-      const deque<purchase_info>& friend_purchases = curr_friend.get_purchase_record();
+    if (ptr_this_friend != nullptr) {
 
-      // copy current friend's purchases into the second half of T_purchases container
-      if (!friend_purchases.empty()) {
+      const user_info& curr_friend = *ptr_this_friend;
+      const purchase_record& friend_purchases = curr_friend.get_purchase_record();
 
-        // resize purchases to be able to hold purchases of previous and current friends
-        const size_t size_friend_purchases = friend_purchases.size();
-        const size_t size_purchase_merge = purchases.size() + size_friend_purchases;
-        purchases.resize(size_purchase_merge);
+      // only the purchases within the time window take part in the merge
+      const size_t size_friend_purchases = curr_friend.count_purchases_since(cutoff_time);
 
-        // merge and sort purchases of previous and current friends
-        // using reverse iterators
-        merge(purchases.rbegin() + size_friend_purchases, purchases.rend() ,
-            friend_purchases.rbegin(), friend_purchases.rend(),
-            purchases.rbegin(), comp_purchase_time);
-
-        // resize purchases
-        purchases.resize(std::min(T_, purchases.size()));
-      }
-    } else
+      // merge and sort purchases of previous and current friends
+      merge_recent_purchases(purchases, friend_purchases.begin(),
+          friend_purchases.begin() + size_friend_purchases, limit);
+    } else if (errors_.count(input_error::missing_user))
       cerr << "Error: can not find friend with id " << friend_id << endl;
   }
 
   return purchases;
 }
 
-bool network::compute_mean_sd(const user_id_t user_id,
+bool network::compute_mean_sd(const user_id_t user_id, const uint64_t cutoff_time,
     double& mean, double& standard_deviation) {
 
-  // obtain the user's friends in the D-degree social network
-  const unordered_set<user_id_t> friends_in_network = get_friends_network(user_id);
+  running_stats stats;
 
-  // obtain the last T purchases in the social network
-  const vector<purchase_info> friends_purchases = friend_purchases(friends_in_network);
+  // reuse the statistics of the user's network if they are still valid
+  const cache_entry* entry = use_cache_ ? cache_.find(user_id, cutoff_time) : nullptr;
+  if (entry != nullptr) {
+    stats = entry->stats;
+  } else {
+    // obtain the user's friends in the D-degree social network
+    const unordered_set<user_id_t> friends_in_network = backend_ ?
+        backend_->get_friends_network(user_id, D_) : get_friends_network(user_id);
+    if (friends_in_network.empty())
+      return false;
+
+    // obtain the last T purchases in the social network
+    const vector<purchase_info> friends_purchases = backend_ ?
+        backend_->friend_purchases(friends_in_network, cutoff_time, purchase_limit()) :
+        friend_purchases(friends_in_network, cutoff_time);
+
+    // compute the statistics of the purchase amounts
+    // (a long list is copied into amounts_ for the vector kernel)
+    stats = compute_stats(friends_purchases.begin(), friends_purchases.end(), amounts_);
+
+    // store the statistics for the next purchase of the user
+    if (use_cache_)
+      cache_.store(user_id, friends_in_network, friends_purchases, stats);
+  }
 
-  size_t n_purchases = friends_purchases.size();
   // if the number of purchases is larger than 1,
-  // compute the standard deviation and mean of the last T purchases
-  if (n_purchases > 1) {
-
-    double sum_purchases = 0.0;
-    double sum2_purchases = 0.0;
-    for (const auto& purchase_info: friends_purchases) {
-      const double purchase_amount = purchase_info.amount;
-      sum_purchases += purchase_amount;
-      sum2_purchases += purchase_amount * purchase_amount;
-    }
-
-    // compute the mean and standard deviation of T purchases
-    const double mean_purchases = sum_purchases / n_purchases;
-    mean = mean_purchases;
-
-    const double variance_purchases = sum2_purchases/n_purchases
-        - mean_purchases * mean_purchases;
-    const double sd_purchases = sqrt(variance_purchases);
-    standard_deviation = sd_purchases;
-
+  // obtain the standard deviation and mean of the last T purchases
+  if (stats.count() > 1) {
+    mean = stats.mean();
+    standard_deviation = stats.standard_deviation();
     return true;
   }
 
   return false;
 }
 
-bool network::process_stream_entries(const Document& entry,
+bool network::process_stream_event(const event& e,
     double& mean, double& standard_deviation) {
 
-  string event_type = entry["event_type"].GetString();
-  string timestamp = entry["timestamp"].GetString();
+  if (backend_)
+    return process_backend_event(e, mean, standard_deviation);
 
-  if (!event_type.compare("purchase")) {
+  if (e.kind == event_kind::purchase) {
     // this is a purchase event
 
     // create or find the user
-    user_id_t id = stoi(entry["id"].GetString());
-    user_info& curr_user = map_users_[id];
-
-    // obtain purchase amount
-    double amount = stod(entry["amount"].GetString());
+    const user_id_t id = e.id1;
+    user_info& curr_user = get_user(id);
+    mark_dirty(id);
 
     // update purchase order
     const size_t purchase_order = ++purchase_order_;
 
     // update the user's purchases
-    curr_user.update_purchases(timestamp, purchase_order, amount, T_);
+    const size_t limit = purchase_limit();
+    curr_user.update_purchases(e.time, purchase_order, e.amount, limit);
+    const purchase_info& purchase = curr_user.get_purchase_record().front();
+
+    // drop the purchases that have left the time window
+    const uint64_t cutoff_time = window_cutoff(e.time);
+    if (time_window_ > 0)
+      curr_user.remove_purchases_before(cutoff_time);
+
+    // slide the cached statistics of every network containing the user
+    if (use_cache_)
+      cache_.add_purchase(id, purchase, limit);
 
     // if the user has friends,
     // proceed to check if this purchase is anomalous
@@ -315,77 +856,767 @@ bool network::process_stream_entries(const Document& entry,
 
       // check if there is enough purchase history (>= 2 purchases) in a user's network
       // if true, calculate the mean and standard deviation of recent T purchases in the network
-      const bool enough_purchase_history = compute_mean_sd(id, mean, standard_deviation);
+      const bool enough_purchase_history = compute_mean_sd(id, cutoff_time,
+          mean, standard_deviation);
 
       // with enough purchase history, check if the purchase is anomalous
       // that is the amount of this purchase is larger than 3 standard deviations plus the mean
       if (enough_purchase_history) {
-        if (amount > (mean + standard_deviation * 3))
+        if (e.amount > (mean + standard_deviation * 3))
           return true;
       }
     }
-  } else if (!event_type.compare("befriend")
-      || !event_type.compare("unfriend")) {
+  } else {
     // this is a befriend or unfriend event
 
     // create or find users
-    user_id_t id1 = stoi(entry["id1"].GetString());
-    user_id_t id2 = stoi(entry["id2"].GetString());
-    user_info& curr_user1 = map_users_[id1];
-    user_info& curr_user2 = map_users_[id2];
-
-    if (id1 != id2) {
-      if (!event_type.compare("befriend")) {
-        curr_user1.add_friend(id2);
-        curr_user2.add_friend(id1);
+    user_info& curr_user1 = get_user(e.id1);
+    user_info& curr_user2 = get_user(e.id2);
+    mark_dirty(e.id1);
+    mark_dirty(e.id2);
+
+    if (e.id1 != e.id2) {
+      if (e.kind == event_kind::befriend) {
+        curr_user1.add_friend(e.id2);
+        curr_user2.add_friend(e.id1);
       } else {
-        curr_user1.remove_friend(id2);
-        curr_user2.remove_friend(id1);
+        curr_user1.remove_friend(e.id2);
+        curr_user2.remove_friend(e.id1);
       }
-    } else
+
+      // drop cached statistics of the networks affected by this event
+      if (use_cache_)
+        cache_.change_friendship(e.id1, e.id2);
+    } else if (errors_.count(input_error::same_user))
       cerr << "Error: befriend or unfriend event for same user "
-          << id1 << endl;
-  } else {
-      cerr << "Error: can not recognize this event type: "
-          << event_type << endl;
+          << e.id1 << endl;
   }
 
   return false;
 }
 
-void network::process_stream_log(ifstream& in_stream_log, ofstream& out_flagged_log) {
+bool network::process_backend_event(const event& e,
+    double& mean, double& standard_deviation) {
 
-  string line;
-  while (getline(in_stream_log, line)) {
-    // skip empty lines
-    if (line.empty())
-      continue;
+  if (e.kind == event_kind::purchase) {
+    // send the purchase to the backend holding the user
+    const size_t limit = purchase_limit();
+    const uint64_t cutoff_time = window_cutoff(e.time);
+    const purchase_info purchase {{e.time, ++purchase_order_}, e.amount};
+    backend_->add_purchase(e.id1, purchase, limit, cutoff_time);
+
+    // slide the cached statistics of every network containing the user
+    if (use_cache_)
+      cache_.add_purchase(e.id1, purchase, limit);
+
+    // a user without friends has an empty network, so no statistics are computed
+    return compute_mean_sd(e.id1, cutoff_time, mean, standard_deviation)
+        && e.amount > (mean + standard_deviation * 3);
+  }
+
+  if (e.id1 != e.id2) {
+    backend_->change_friendship(e.id1, e.id2, e.kind == event_kind::befriend);
+
+    // drop cached statistics of the networks affected by this event
+    if (use_cache_)
+      cache_.change_friendship(e.id1, e.id2);
+  } else if (errors_.count(input_error::same_user))
+    cerr << "Error: befriend or unfriend event for same user "
+        << e.id1 << endl;
+
+  return false;
+}
+
+void network::fault_in_spilled_users() {
+  if (spill_ != nullptr) {
+    for (const user_id_t user_id : spill_->spilled_ids())
+      get_user(user_id);
+  }
+}
+
+void network::start_shards(const size_t n_shards) {
+  // the shards keep all users in memory
+  fault_in_spilled_users();
+  backend_.reset(new sharded_network(n_shards, std::move(map_users_)));
+
+  // the users are now in the shards' arenas
+  user_map(map_users_.get_allocator()).swap(map_users_);
+  arena_.release_unused();
+}
+
+bool network::start_mmap_store(const string& path, const size_t merge_interval) {
+  fault_in_spilled_users();
+  mmap_store* store = new mmap_store(path, purchase_limit(), merge_interval);
+  backend_.reset(store);
+  if (!store->build(map_users_))
+    return false;
+
+  // release the memory of the users, which are now read from the files
+  user_map(map_users_.get_allocator()).swap(map_users_);
+  arena_.release_unused();
+  return true;
+}
+
+bool network::apply_stream_event(const event& e, double& mean, double& standard_deviation) {
+  // log the event before it is applied; an event for the same user changes nothing
+  if (wal_ && (e.kind == event_kind::purchase || e.id1 != e.id2))
+    wal_->append(e, stream_offset_);
+
+  check_memory(e.time);
+
+  // process different events and flag any anomalous purchase,
+  // if true, compute the mean and standard deviation
+  bool flagged_purchase;
+  if (spill_ == nullptr) {
+    flagged_purchase = process_stream_event(e, mean, standard_deviation);
+  } else {
+    // measure the latency added by reading evicted users back
+    const size_t faulted_users = spill_->faulted_users();
+    const auto start_time = chrono::steady_clock::now();
+    flagged_purchase = process_stream_event(e, mean, standard_deviation);
+    const double seconds = chrono::duration<double>(
+        chrono::steady_clock::now() - start_time).count();
+    if (spill_->faulted_users() != faulted_users) {
+      ++faulting_events_;
+      faulting_event_seconds_ += seconds;
+    } else {
+      ++resident_events_;
+      resident_event_seconds_ += seconds;
+    }
+  }
+  return flagged_purchase;
+}
+
+void network::checkpoint_stream_event(ostream& out_flagged_log) {
+  // collect a finished snapshot child, so the log does not grow until the next snapshot
+  if (snapshot_child_ != 0)
+    reap_snapshot_child(false);
+
+  // the snapshot is a checkpoint of the stream up to this event, and records
+  // the length of the output written so far
+  if (snapshot_interval_ > 0 && --events_until_snapshot_ == 0) {
+    out_flagged_log.flush();
+    save_snapshot();
+    events_until_snapshot_ = snapshot_interval_;
+  }
+}
+
+void network::flag_stream_event(const event& e, ostream& out_flagged_log) {
+  double mean, standard_deviation;
+  const bool flagged_purchase = apply_stream_event(e, mean, standard_deviation);
 
+  // write anomalous purchases to a output file
+  if (flagged_purchase)
+    write_flagged_purchase(e.line, mean, standard_deviation, out_flagged_log);
+  checkpoint_stream_event(out_flagged_log);
+}
+
+void network::write_flagged_purchase(const string& line, const double mean,
+    const double standard_deviation, ostream& out_flagged_log) {
+  const string str_mean = double_to_string(mean);
+  const string str_sd = double_to_string(standard_deviation);
+  const string new_line = line.substr(0, line.size() - 1)
+      + ", \"mean\": \"" + str_mean + "\", \"sd\": \"" + str_sd + "\"}";
+  out_flagged_log << new_line << endl;
+  output_bytes_ += new_line.size() + 1;
+}
+
+void network::process_stream_line(string& line, ostream& out_flagged_log) {
+  // skip empty lines
+  if (line.empty())
+    return;
+
+  // the scanner reads the usual lines; the others are parsed with rapidjson
+  // (D and T are not read in the stream, where a line with both is an event)
+  size_t D, T;
+  const scan_result scanned = use_scanner_ ?
+      scan_event_line(line, stream_event_, D, T, trusted_input_) : scan_result::fallback;
+  if (scanned != scan_result::event) {
     Document doc;
     doc.Parse(line.c_str());
     if(!doc.IsObject()) {
-      cerr << "Error: doc is not object" << endl;
+      errors_.reject(input_error::not_object, "Error: doc is not object\n", line);
+      return;
+    }
+
+    if(!doc.HasMember("event_type")) {
+      errors_.reject(input_error::missing_event_type,
+          "Error: event_type is present in this line\n", line);
+      return;
+    }
+    ostringstream err;
+    input_error error;
+    if (!read_event(doc, stream_event_, err, error)) {
+      errors_.reject(error, err.str(), line);
+      return;
+    }
+  }
+  stream_event_.line = std::move(line);
+  process_stream_event(out_flagged_log);
+}
+
+void network::process_stream_event(ostream& out_flagged_log) {
+  if (reorder_ == nullptr) {
+    flag_stream_event(stream_event_, out_flagged_log);
+    return;
+  }
+
+  // hold the event until it can be released in time order
+  if (!reorder_->push(stream_event_))
+    report_late_event(stream_event_);
+  while (reorder_->pop_ready(stream_event_))
+    flag_stream_event(stream_event_, out_flagged_log);
+}
+
+void network::finish_stream(ostream& out_flagged_log) {
+  // release the events still held in the buffer
+  if (reorder_ != nullptr) {
+    while (reorder_->pop_any(stream_event_))
+      flag_stream_event(stream_event_, out_flagged_log);
+  }
+
+  if (wal_)
+    wal_->commit();
+  if (compactor_.joinable())
+    compactor_.join();
+  reap_snapshot_child(true);
+}
+
+void network::process_stream_log(istream& in_stream_log, ostream& out_flagged_log) {
+
+  string line;
+  while (getline(in_stream_log, line)) {
+    // the byte offset of the next line (the last line may lack its newline)
+    stream_offset_ += line.size() + (in_stream_log.eof() ? 0 : 1);
+    process_stream_line(line, out_flagged_log);
+  }
+  finish_stream(out_flagged_log);
+}
+
+void network::process_merged_stream_logs(stream_merger& merger, ostream& out_flagged_log) {
+
+  merger.set_error_reporter(&errors_);
+  while (merger.next(stream_event_))
+    process_stream_event(out_flagged_log);
+  finish_stream(out_flagged_log);
+}
+
+void network::process_binary_stream_log(binary_event_log& in_stream_log,
+    ostream& out_flagged_log) {
+
+  binary_record r;
+  while (in_stream_log.read(r)) {
+    // the byte offset of the next record
+    stream_offset_ = in_stream_log.offset();
+    if (r.type == binary_record_type::parameters) {
+      if (errors_.count(input_error::missing_event_type))
+        cerr << "Error: event_type is present in this line" << endl;
       continue;
     }
+    binary_record_to_event(r, stream_event_);
 
-    if(doc.HasMember("event_type")) {
-      // process different events and flag any anomalous purchase,
-      // if true, compute the mean and standard deviation
+    // the line is written only for a flagged purchase
+    if (reorder_ == nullptr) {
       double mean, standard_deviation;
-      const bool flagged_purchase = process_stream_entries(doc, mean, standard_deviation);
-
-      // write anomalous purchases to a output file
-      if (flagged_purchase) {
-        const string str_mean = double_to_string(mean);
-        const string str_sd = double_to_string(standard_deviation);
-        line.erase(line.end()-1);
-        const string new_line = line + ", \"mean\": \"" + str_mean
-            + "\", \"sd\": \"" + str_sd + "\"}";
-        out_flagged_log << new_line << endl;
+      if (apply_stream_event(stream_event_, mean, standard_deviation))
+        write_flagged_purchase(format_event_line(r), mean, standard_deviation, out_flagged_log);
+      checkpoint_stream_event(out_flagged_log);
+      continue;
+    }
+
+    // hold the event until it can be released in time order
+    stream_event_.line = format_event_line(r);
+    if (!reorder_->push(stream_event_))
+      report_late_event(stream_event_);
+    while (reorder_->pop_ready(stream_event_))
+      flag_stream_event(stream_event_, out_flagged_log);
+  }
+  finish_stream(out_flagged_log);
+}
+
+void network::follow_stream_log(stream_follower& follower, ostream& out_flagged_log) {
+  string line;
+  do {
+    while (follower.read_line(line)) {
+      stream_offset_ = follower.offset();
+      const uint64_t output_bytes = output_bytes_;
+      process_stream_line(line, out_flagged_log);
+
+      // a flagged purchase is flushed at once; its latency runs from the
+      // read() that returned its line
+      if (output_bytes_ != output_bytes) {
+        out_flagged_log.flush();
+        flag_latencies_.push_back(chrono::duration<double>(
+            chrono::steady_clock::now() - follower.read_time()).count());
       }
+    }
+  } while (follower.wait());
+
+  finish_stream(out_flagged_log);
+  out_flagged_log.flush();
+}
+
+void network::serve_stream(ingest_server& server, ostream& out_flagged_log,
+    const bool reply_flagged) {
+  ingest_batch batch;
+  ostringstream flagged;
+  while (server.pop_batch(batch)) {
+    // the flagged purchases go back to the client or to the output
+    ostream& out = reply_flagged ? static_cast<ostream&>(flagged) : out_flagged_log;
+    for (string& line : batch.lines)
+      process_stream_line(line, out);
+
+    // the batch is acknowledged after its flagged purchases
+    string bytes;
+    if (reply_flagged) {
+      bytes = flagged.str();
+      flagged.str(string());
     } else {
-      cerr << "Error: event_type is present in this line" << endl;
+      out_flagged_log.flush();
     }
+    bytes += "{\"ack\": " + to_string(batch.lines.size()) + "}\n";
+    server.reply(batch.connection, std::move(bytes));
+  }
+
+  finish_stream(out_flagged_log);
+  out_flagged_log.flush();
+}
+
+void network::serve_shm_ring(shm_ingest& ingest, ostream& out_flagged_log) {
+  event e;
+  uint64_t tag;
+  while (ingest.pop_event(e, tag)) {
+    double mean, standard_deviation;
+    if (apply_stream_event(e, mean, standard_deviation))
+      ingest.push_result(e, tag, mean, standard_deviation);
+    ingest.mark_processed();
+    checkpoint_stream_event(out_flagged_log);
+  }
+  finish_stream(out_flagged_log);
+}
+
+network::~network() {
+  if (compactor_.joinable())
+    compactor_.join();
+  reap_snapshot_child(true);
+  if (output_fd_ >= 0)
+    close(output_fd_);
+}
+
+bool network::set_output_file(const char* fname) {
+  output_fd_ = open(fname, O_RDONLY | O_CLOEXEC);
+  return output_fd_ >= 0;
+}
+
+bool network::set_write_ahead_log(const string& fname, const bool keep_records,
+    const size_t group_size, const wal_sync sync, const uint64_t sync_interval_ms) {
+  wal_.reset(new write_ahead_log());
+  fname_wal_ = fname;
+  if (!wal_->open(fname, keep_records, group_size, sync, sync_interval_ms)) {
+    wal_.reset();
+    return false;
+  }
+  return true;
+}
+
+bool network::write_checkpoint(const checkpoint_header& header, const bool delta) {
+  const string fname = delta ?
+      delta_checkpoint_name(fname_snapshot_, header.delta_sequence) : fname_snapshot_;
+  const string fname_tmp = fname + ".tmp";
+  ofstream out(fname_tmp, ios::binary | ios::trunc);
+  if (delta) {
+    write_checkpoint_header(out, delta_checkpoint_magic, header, dirty_users_.size());
+    for (const user_id_t user_id : dirty_users_)
+      write_user_record(out, user_id, get_user(user_id));
+  } else {
+    write_checkpoint_header(out, base_snapshot_magic, header, map_users_.size());
+    for (const auto& user : map_users_)
+      write_user_record(out, user.first, user.second);
   }
+  out.close();
 
+  // the previous checkpoint stays valid until this one is complete on disk
+  if (!out || !commit_checkpoint_file(fname_tmp, fname)) {
+    cerr << "Error: checkpoint " << fname << " could not be written" << endl;
+    return false;
+  }
+  return true;
+}
+
+bool network::fork_snapshot(const checkpoint_header& header) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+
+  // the pending output is flushed, so the child's copy of the buffer is empty
+  cout.flush();
+  cerr.flush();
+  const pid_t parent = getpid();
+  const pid_t pid = fork();
+  if (pid < 0) {
+    cerr << "Error: fork failed: " << strerror(errno) << endl;
+    return false;
+  }
+  if (pid == 0) {
+    // a child outliving a killed parent could replace the snapshot of a restarted run
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != parent)
+      _exit(EXIT_FAILURE);
+    // the child sees the users as they were at the fork; it leaves without
+    // running destructors, which would flush the parent's streams and logs
+    _exit(write_checkpoint(header, false) ? EXIT_SUCCESS : EXIT_FAILURE);
+  }
+
+  snapshot_child_ = pid;
+  child_header_ = header;
+  child_start_time_ = chrono::steady_clock::now();
+  child_start_minor_faults_ = usage.ru_minflt;
+  return true;
+}
+
+void network::reap_snapshot_child(const bool wait) {
+  if (snapshot_child_ == 0)
+    return;
+
+  int status = 0;
+  struct rusage child_usage;
+  pid_t pid;
+  do {
+    pid = wait4(snapshot_child_, &status, wait ? 0 : WNOHANG, &child_usage);
+  } while (pid < 0 && errno == EINTR);
+  if (pid == 0)
+    return;
+  snapshot_child_ = 0;
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  cow_faults_ += usage.ru_minflt - child_start_minor_faults_;
+  forked_snapshot_seconds_ += chrono::duration<double>(
+      chrono::steady_clock::now() - child_start_time_).count();
+  if (pid > 0 && child_usage.ru_maxrss > child_max_rss_kb_)
+    child_max_rss_kb_ = child_usage.ru_maxrss;
+
+  if (pid < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS) {
+    // the next checkpoint must be a full snapshot again
+    cerr << "Error: snapshot " << child_header_.snapshot_id << " was not written"
+        << endl;
+    ++failed_forked_snapshots_;
+    need_base_ = true;
+    return;
+  }
+  ++snapshots_;
+  ++forked_snapshots_;
+
+  // the events logged after the fork are still needed
+  if (wal_)
+    wal_->truncate_through(child_header_.wal_sequence);
+}
+
+bool network::save_snapshot() {
+  // the shards and the mapped files are not snapshotted
+  if (backend_ || fname_snapshot_.empty())
+    return false;
+
+  const auto start_time = chrono::steady_clock::now();
+
+  // a delta must follow a base on disk, and a new child must not overwrite
+  // the snapshot of a running one
+  if (snapshot_child_ != 0) {
+    reap_snapshot_child(true);
+    child_wait_seconds_ += chrono::duration<double>(
+        chrono::steady_clock::now() - start_time).count();
+  }
+
+  // the checkpoint includes every logged event
+  checkpoint_header header;
+  header.D = D_;
+  header.T = T_;
+  header.purchase_order = purchase_order_;
+  header.wal_sequence = 0;
+  if (wal_) {
+    wal_->commit();
+    header.wal_sequence = wal_->last_sequence();
+  }
+  // the output up to the recorded length must be on disk before the checkpoint,
+  // or a resumed run could find the file shorter than recorded
+  if (output_fd_ >= 0 && fsync(output_fd_) != 0) {
+    cerr << "Error: the output could not be synced before checkpoint "
+        << snapshot_id_ + 1 << ": " << strerror(errno) << endl;
+    return false;
+  }
+  header.latest_time = latest_time_;
+  header.snapshot_id = snapshot_id_ + 1;
+  header.stream_offset = stream_offset_;
+  header.output_bytes = output_bytes_;
+
+  // a delta holds only the users changed since the previous checkpoint
+  const bool delta = deltas_per_base_ > 0 && !need_base_;
+  header.delta_sequence = delta ? delta_sequence_ + 1 : delta_sequence_;
+
+  if (!delta && fork_snapshots_) {
+    // a compaction would replace the base written by the child
+    if (compactor_.joinable())
+      compactor_.join();
+    // deltas left by an earlier run do not follow this base
+    for (uint64_t sequence = delta_sequence_ + 1;
+        remove(delta_checkpoint_name(fname_snapshot_, sequence).c_str()) == 0; ++sequence) {}
+
+    const auto fork_time = chrono::steady_clock::now();
+    if (fork_snapshot(header)) {
+      compacted_sequence_ = delta_sequence_;
+      need_base_ = false;
+      dirty_users_.clear();
+      snapshot_id_ = header.snapshot_id;
+      const double seconds = chrono::duration<double>(
+          chrono::steady_clock::now() - fork_time).count();
+      fork_pause_seconds_ += seconds;
+      max_fork_pause_seconds_ = max(max_fork_pause_seconds_, seconds);
+      return true;
+    }
+    // without a child, the snapshot is written here
+  }
+
+  if (!write_checkpoint(header, delta))
+    return false;
+
+  if (delta) {
+    delta_sequence_ = header.delta_sequence;
+    ++delta_checkpoints_;
+    delta_checkpoint_users_ += dirty_users_.size();
+  } else {
+    // deltas left by an earlier run do not follow this base
+    for (uint64_t sequence = delta_sequence_ + 1;
+        remove(delta_checkpoint_name(fname_snapshot_, sequence).c_str()) == 0; ++sequence) {}
+    compacted_sequence_ = delta_sequence_;
+    need_base_ = false;
+  }
+  dirty_users_.clear();
+
+  // the logged events are in the checkpoint now
+  if (wal_)
+    wal_->truncate();
+
+  snapshot_id_ = header.snapshot_id;
+  ++snapshots_;
+  snapshot_seconds_ += chrono::duration<double>(
+      chrono::steady_clock::now() - start_time).count();
+
+  // every few deltas, merge them into a new base in the background
+  if (delta && delta_sequence_ - compacted_sequence_ >= deltas_per_base_
+      && !compacting_.load(memory_order_acquire)) {
+    if (compactor_.joinable())
+      compactor_.join();
+    compacted_sequence_ = delta_sequence_;
+    compacting_.store(true, memory_order_release);
+    compactor_ = thread(&network::compact_checkpoints_in_background, this, delta_sequence_);
+  }
+  return true;
+}
+
+void network::compact_checkpoints_in_background(const uint64_t last_delta) {
+  const auto start_time = chrono::steady_clock::now();
+  if (compact_checkpoints(fname_snapshot_, last_delta))
+    ++compactions_;
+  else
+    cerr << "Error: compacting the checkpoints of " << fname_snapshot_ << " failed" << endl;
+  compaction_seconds_ += chrono::duration<double>(
+      chrono::steady_clock::now() - start_time).count();
+  compacting_.store(false, memory_order_release);
+}
+
+bool network::load_checkpoint(istream& in, const char* magic, uint64_t& wal_sequence) {
+  checkpoint_header header;
+  uint64_t n_users = 0;
+  if (!read_checkpoint_header(in, magic, header, n_users))
+    return false;
+
+  D_ = header.D;
+  T_ = header.T;
+  purchase_order_ = header.purchase_order;
+  wal_sequence = header.wal_sequence;
+  latest_time_ = header.latest_time;
+  snapshot_id_ = header.snapshot_id;
+  stream_offset_ = header.stream_offset;
+  output_bytes_ = header.output_bytes;
+  delta_sequence_ = header.delta_sequence;
+
+  // a record replaces the user of an earlier checkpoint
+  user_id_t user_id;
+  string record;
+  for (uint64_t i = 0; i < n_users; ++i) {
+    if (!read_user_record(in, user_id, record))
+      return false;
+    map_users_.erase(user_id);
+    restore_user(record, get_user(user_id));
+  }
+  return true;
+}
+
+bool network::restore_snapshot(istream& in_batch_log, uint64_t& wal_sequence) {
+  // the snapshot replaces the batch log, which it includes
+  wal_sequence = 0;
+  ifstream in_snapshot;
+  if (!fname_snapshot_.empty())
+    in_snapshot.open(fname_snapshot_, ios::binary);
+  if (!in_snapshot.is_open()) {
+    read_batch_log(in_batch_log);
+    return true;
+  }
+  if (!load_checkpoint(in_snapshot, base_snapshot_magic, wal_sequence)) {
+    cerr << "Error: snapshot " << fname_snapshot_ << " is corrupted" << endl;
+    return false;
+  }
+  compacted_sequence_ = delta_sequence_;
+
+  // apply the deltas written after the base, in order
+  for (;;) {
+    const string fname_delta = delta_checkpoint_name(fname_snapshot_, delta_sequence_ + 1);
+    ifstream in_delta(fname_delta, ios::binary);
+    if (!in_delta.is_open())
+      break;
+    if (!load_checkpoint(in_delta, delta_checkpoint_magic, wal_sequence)) {
+      cerr << "Error: checkpoint " << fname_delta << " is corrupted" << endl;
+      return false;
+    }
+  }
+  need_base_ = false;
+  return true;
+}
+
+bool network::recover(istream& in_batch_log, uint64_t& stream_offset,
+    const uint64_t output_bytes) {
+  const auto start_time = chrono::steady_clock::now();
+
+  uint64_t wal_sequence = 0;
+  if (!restore_snapshot(in_batch_log, wal_sequence))
+    return false;
+
+  // the events after the snapshot are read from the log, and the stream
+  // continues after the last of them, so no event is applied twice
+  if (wal_) {
+    replayed_events_ = write_ahead_log::replay(fname_wal_, wal_sequence,
+        [this](const event& e, const uint64_t event_stream_offset) {
+      process_batch_event(e);
+      stream_offset_ = event_stream_offset;
+    });
+    wal_->skip_to(wal_sequence);
+  }
+  stream_offset = stream_offset_;
+  // the output of the previous run is kept
+  output_bytes_ = output_bytes;
+
+  recovery_seconds_ = chrono::duration<double>(
+      chrono::steady_clock::now() - start_time).count();
+  return true;
+}
+
+bool network::resume(istream& in_batch_log, uint64_t& stream_offset,
+    uint64_t& output_bytes) {
+  const auto start_time = chrono::steady_clock::now();
+
+  uint64_t wal_sequence = 0;
+  if (!restore_snapshot(in_batch_log, wal_sequence))
+    return false;
+
+  // the events after the checkpoint are read from the stream again,
+  // so the logged ones are not applied
+  if (wal_)
+    wal_->skip_to(wal_sequence);
+  stream_offset = stream_offset_;
+  output_bytes = output_bytes_;
+
+  recovery_seconds_ = chrono::duration<double>(
+      chrono::steady_clock::now() - start_time).count();
+  return true;
+}
+
+void network::print_stats(ostream& out) const {
+  if (backend_)
+    backend_->print_stats(out);
+  else
+    out << "users: " << map_users_.size() << "\n";
+  out << "purchases: " << purchase_order_ << "\n";
+  if (use_cache_) {
+    out << "cache entries: " << cache_.size() << "\n"
+        << "cache exact hits: " << cache_.exact_hits() << "\n"
+        << "cache incremental updates: " << cache_.incremental_updates() << "\n"
+        << "cache full recomputes: " << cache_.full_recomputes() << "\n"
+        << "cache invalidations: " << cache_.invalidations() << "\n";
+  }
+  if (reorder_ != nullptr) {
+    out << "reordered events: " << reorder_->reordered_events() << "\n"
+        << "late events: " << reorder_->late_events() << "\n"
+        << "forced releases: " << reorder_->forced_releases() << "\n";
+  }
+  out << "sum kernel: " << sum_kernel_name() << "\n";
+
+  // memory of the users and the time to build them from the batch log
+  out << "batch load seconds: " << batch_load_seconds_ << "\n";
+  if (map_users_.get_allocator().arena() != nullptr) {
+    out << "arena allocated bytes: " << arena_.allocated_bytes() << "\n"
+        << "arena used bytes: " << arena_.used_bytes() << "\n";
+  }
+  if (spill_ != nullptr) {
+    out << "spilled users: " << spill_->spilled_users() << "\n"
+        << "faulted users: " << spill_->faulted_users() << "\n"
+        << "users in spill file: " << spill_->size() << "\n"
+        << "spill file bytes: " << spill_->file_bytes()
+        << " (dead " << spill_->dead_bytes() << ", compactions "
+        << spill_->compactions() << ")\n";
+    if (spill_->faulted_users() > 0) {
+      out << "fault mean us: " << spill_->fault_seconds() / spill_->faulted_users() * 1e6
+          << " (max " << spill_->max_fault_seconds() * 1e6 << ")\n";
+    }
+    if (faulting_events_ > 0) {
+      out << "faulting stream events: " << faulting_events_ << ", mean us: "
+          << faulting_event_seconds_ / faulting_events_ * 1e6 << "\n";
+    }
+    if (resident_events_ > 0) {
+      out << "resident stream events: " << resident_events_ << ", mean us: "
+          << resident_event_seconds_ / resident_events_ * 1e6 << "\n";
+    }
+  }
+  if (wal_)
+    wal_->print_stats(out);
+  if (!fname_snapshot_.empty()) {
+    out << "snapshots: " << snapshots_ << "\n"
+        << "snapshot seconds: " << snapshot_seconds_ << "\n";
+    if (fork_snapshots_) {
+      out << "forked snapshots: " << forked_snapshots_ << " (failed "
+          << failed_forked_snapshots_ << ")\n"
+          << "forked snapshot wall seconds: " << forked_snapshot_seconds_ << "\n"
+          << "fork pause seconds: " << fork_pause_seconds_ << " (max "
+          << max_fork_pause_seconds_ << ")\n"
+          << "seconds waiting for the previous snapshot child: " << child_wait_seconds_ << "\n"
+          << "copy-on-write faults: " << cow_faults_ << " (about "
+          << cow_faults_ * sysconf(_SC_PAGESIZE) / 1024 << " KB)\n"
+          << "snapshot child max resident set KB: " << child_max_rss_kb_ << "\n";
+    }
+    if (deltas_per_base_ > 0) {
+      out << "delta checkpoints: " << delta_checkpoints_ << ", users written: "
+          << delta_checkpoint_users_ << "\n"
+          << "compactions: " << compactions_ << "\n"
+          << "compaction seconds: " << compaction_seconds_ << "\n";
+    }
+  }
+  if (recovery_seconds_ > 0) {
+    out << "recovered events from wal: " << replayed_events_ << "\n"
+        << "recovery seconds: " << recovery_seconds_ << "\n";
+  }
+  if (snapshot_id_ > 0)
+    out << "last snapshot id: " << snapshot_id_ << "\n";
+  if (!flag_latencies_.empty()) {
+    vector<double> latencies(flag_latencies_);
+    sort(latencies.begin(), latencies.end());
+    double sum = 0.0;
+    for (const double latency : latencies)
+      sum += latency;
+    out << "read-to-flag latency us: mean " << sum / latencies.size() * 1e6
+        << ", p50 " << latencies[latencies.size() / 2] * 1e6
+        << ", p99 " << latencies[latencies.size() * 99 / 100] * 1e6
+        << ", max " << latencies.back() * 1e6 << "\n";
+  }
+  get_memory_usage().print(out);
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0)
+    out << "max resident set KB: " << usage.ru_maxrss << "\n";
 }
@@ -8,8 +8,31 @@
 #ifndef NETWORK_H_
 #define NETWORK_H_
 
+#include <iosfwd>
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
 #include <unordered_map>
+#include <sys/types.h>
 #include "user_info.h"
+#include "event.h"
+#include "reorder_buffer.h"
+#include "neighborhood_cache.h"
+#include "sharded_network.h"
+#include "memory_usage.h"
+#include "spill_store.h"
+#include "mmap_store.h"
+#include "write_ahead_log.h"
+#include "checkpoint.h"
+#include "stream_follower.h"
+#include "ingest_server.h"
+#include "shm_ingest.h"
+#include "binary_event_log.h"
+#include "event_scanner.h"
+#include "stream_merger.h"
+#include "error_reporter.h"
 #include "include/rapidjson/document.h"
 
 // network class maintains the user network and purchase history
@@ -19,19 +42,182 @@ class network {
     std::size_t D_{};
     // number of recent purchases in a user's network
     std::size_t T_{};
+    // arena holding the users and their friend sets and purchases
+    pool_arena arena_{};
     // unordered map containing all user information
-    std::unordered_map<user_id_t, user_info> map_users_{};
+    user_map map_users_{user_map_allocator(&arena_)};
     // the order of a purchase when it is read
     std::size_t purchase_order_ = 0;
+    // length of the time window of the baseline in seconds,
+    // 0 if the baseline is the last T purchases regardless of their time
+    uint64_t time_window_ = 0;
+    // maximum number of purchases in the time-window baseline (0 means T)
+    std::size_t window_max_purchases_ = 0;
+    // true if the statistics of users' networks are cached between purchases
+    bool use_cache_ = true;
+    // cached statistics of users' networks
+    neighborhood_cache cache_{};
+    // true if the lines of the logs are read with the event scanner when they allow it
+    bool use_scanner_ = true;
+    // true if the lines are first read in the fixed layout of trusted input
+    bool trusted_input_ = false;
+    // buffer holding the purchase amounts of a large network while they are summed
+    std::vector<double> amounts_{};
+    // buffer sorting out-of-order events by timestamp (nullptr if input is in order)
+    std::unique_ptr<reorder_buffer> reorder_{};
+    // stream receiving the lines of late events (nullptr to only count them)
+    std::ostream* late_event_log_ = nullptr;
+    // counters and sampled messages of the errors in the input logs
+    error_reporter errors_{};
+    // shards or memory-mapped files holding the users once they are handed over
+    // after the batch log (nullptr while the users are in map_users_)
+    std::unique_ptr<user_backend> backend_{};
+    // number of threads building the users of the batch log (0 or 1: one thread)
+    std::size_t batch_threads_ = 0;
+    // seconds spent reading the batch log
+    double batch_load_seconds_ = 0.0;
+    // memory budget of the network in bytes (0: no budget)
+    std::size_t memory_budget_ = 0;
+    // users without a purchase in this many seconds before the latest event are inactive
+    uint64_t inactive_horizon_ = 0;
+    // the latest event time read so far
+    uint64_t latest_time_ = 0;
+    // the number of events until the memory is checked against the budget
+    std::size_t events_until_memory_check_ = 0;
+    // true if exceeding the budget after shedding has been reported
+    bool over_budget_reported_ = false;
+    // store of users evicted from memory (nullptr if users are never evicted)
+    std::unique_ptr<spill_store> spill_{};
+    // users without a purchase in this many seconds before the latest event are evicted
+    uint64_t spill_after_ = 0;
+    // the number of events until inactive users are evicted again
+    std::size_t events_until_spill_ = 0;
+    // processing time of stream events that read evicted users back, and of the others
+    std::size_t faulting_events_ = 0;
+    double faulting_event_seconds_ = 0.0;
+    std::size_t resident_events_ = 0;
+    double resident_event_seconds_ = 0.0;
+    // log of the applied stream events (nullptr if the events are not logged)
+    std::unique_ptr<write_ahead_log> wal_{};
+    std::string fname_wal_{};
+    // file of the latest snapshot of the users (empty if no snapshots are taken)
+    std::string fname_snapshot_{};
+    // descriptor of the output file, synced before every checkpoint (-1: none)
+    int output_fd_ = -1;
+    // the number of stream events between two snapshots
+    std::size_t snapshot_interval_ = 0;
+    std::size_t events_until_snapshot_ = 0;
+    std::size_t snapshots_ = 0;
+    double snapshot_seconds_ = 0.0;
+    // id of the latest snapshot written or loaded (0: none)
+    uint64_t snapshot_id_ = 0;
+    // byte offset of the next line of the stream log, and bytes written to the
+    // output, recorded in every snapshot as the checkpoint of the stream
+    uint64_t stream_offset_ = 0;
+    uint64_t output_bytes_ = 0;
+    // the number of deltas merged into a new base by a background compaction
+    // (0: every checkpoint is a full snapshot)
+    std::size_t deltas_per_base_ = 0;
+    // true until a base snapshot of this run is written or loaded
+    bool need_base_ = true;
+    // the last delta written or loaded, and the last one merged into the base
+    uint64_t delta_sequence_ = 0;
+    uint64_t compacted_sequence_ = 0;
+    // users changed since the last checkpoint (tracked only once there is a base)
+    std::unordered_set<user_id_t> dirty_users_{};
+    // thread merging deltas into a new base, and true while it runs
+    std::thread compactor_{};
+    std::atomic<bool> compacting_{false};
+    std::size_t delta_checkpoints_ = 0;
+    std::size_t delta_checkpoint_users_ = 0;
+    // updated by the compacting thread; read once it is joined
+    std::size_t compactions_ = 0;
+    double compaction_seconds_ = 0.0;
+    // true to write the full snapshots in a forked child process
+    bool fork_snapshots_ = false;
+    // the child writing a snapshot (0: none), the header of its snapshot,
+    // and the time and the parent's minor page faults when it was forked
+    pid_t snapshot_child_ = 0;
+    checkpoint_header child_header_{};
+    std::chrono::steady_clock::time_point child_start_time_{};
+    long child_start_minor_faults_ = 0;
+    std::size_t forked_snapshots_ = 0;
+    std::size_t failed_forked_snapshots_ = 0;
+    // seconds the parent stopped the stream to fork
+    double fork_pause_seconds_ = 0.0;
+    double max_fork_pause_seconds_ = 0.0;
+    // seconds the parent waited for a child still writing the previous snapshot
+    double child_wait_seconds_ = 0.0;
+    // seconds from the fork until the child's snapshot was collected
+    double forked_snapshot_seconds_ = 0.0;
+    // minor page faults of the parent while a child ran, mostly copies of
+    // pages shared with the child (copy-on-write)
+    std::size_t cow_faults_ = 0;
+    long child_max_rss_kb_ = 0;
+    // the stream event being parsed
+    event stream_event_{};
+    // in follow mode, the seconds from reading each flagged line to flushing its output
+    std::vector<double> flag_latencies_{};
+    // events applied from the log and seconds spent restoring the state at startup
+    std::size_t replayed_events_ = 0;
+    double recovery_seconds_ = 0.0;
 
     // function to obtain the user network
     // return: an unordered_map containing all users' ids and information
-    const std::unordered_map<user_id_t, user_info>& get_network();
+    const user_map& get_network();
 
-    // function to process a line in the file stream for batch_log.json:
+    // function to process an event in batch_log.json:
     //        add a purchase, add a friend, or delete a friend for a user
-    // input: entry - rapidjson object containing an event and its information
-    void process_batch_entries(const rapidjson::Document& entry);
+    // input: e - the event
+    void process_batch_event(const event& e);
+
+    // function to count an event, evicting inactive users and checking
+    //        the memory against the budget every few thousand events
+    // input: event_time - time of the event
+    void check_memory(const uint64_t event_time);
+
+    // function to move the users without a recent purchase to the spill store
+    void spill_inactive_users();
+
+    // function to read all users evicted to the spill store back into map_users_
+    void fault_in_spilled_users();
+
+    // function to find a user, reading it back from the spill store if it was evicted
+    // input:  user_id - a user id
+    // return: pointer to the user, nullptr if the user does not exist
+    const user_info* find_user(const user_id_t user_id);
+
+    // function to obtain a user, creating it or reading it back from the spill store
+    // input:  user_id - a user id
+    // return: reference to the user
+    user_info& get_user(const user_id_t user_id);
+
+    // function to estimate the current memory of the network cheaply:
+    //          the bytes used in the arena and by the cache,
+    //          or the full estimate if the users are not in the arena
+    // return:  the number of bytes
+    std::size_t current_memory_bytes() const;
+
+    // function to shed memory while the network is over the budget:
+    //          drop the cache first, then release the purchases of inactive users
+    void enforce_memory_budget();
+
+    // function to release the purchases of users without a purchase since a time
+    // inputs:  cutoff_time - users whose last purchase is older are inactive
+    // outputs: released_users, released_purchases - references to the numbers of
+    //          users and purchases released
+    void release_inactive_purchases(const uint64_t cutoff_time,
+        std::size_t& released_users, std::size_t& released_purchases);
+
+    // function to report an event rejected by the reorder buffer
+    // input: e - the late event
+    void report_late_event(const event& e);
+
+    // function to read batch_log.json with several threads:
+    //        lines are parsed in chunks, every purchase takes its order from its
+    //        line position, and each thread builds the users it owns
+    // input: in_batch_log - input stream for batch_log.json
+    void read_batch_log_parallel(std::istream& in_batch_log);
 
     // function to obtain ids of all friends in a user's social network
     //         (D degree of separation)
@@ -39,47 +225,357 @@ class network {
     // return: an unordered set containing the friend ids of a user within D degree of separation
     std::unordered_set<user_id_t> get_friends_network(const user_id_t user_id);
 
+    // function to obtain the maximum number of purchases kept per user and in a baseline
+    // return: the cap of the time-window baseline if it is in use, otherwise T
+    std::size_t purchase_limit() const;
+
+    // function to obtain the earliest purchase time inside the time window
+    // input:  purchase_time - time of the purchase being checked
+    // return: the cutoff time, 0 if the time window is disabled
+    uint64_t window_cutoff(const uint64_t purchase_time) const;
+
     // function to obtain the recent T purchases in a user's network
-    // input:  firends_in_network - friend ids of a user within D degree of separation
+    // inputs: firends_in_network - friend ids of a user within D degree of separation
+    //         cutoff_time - purchases made before this time are skipped (0 keeps all)
     // return: a vector of purchases
     std::vector<purchase_info> friend_purchases(const std::unordered_set<user_id_t>&
-        firends_in_network) ;
+        firends_in_network, const uint64_t cutoff_time) ;
 
     // function to compute mean and standard deviations of the last T purchases
     //          within the user's D degree social network
-    // input:   user_id - a user id
+    // inputs:  user_id - a user id
+    //          cutoff_time - purchases made before this time are skipped (0 keeps all)
     // outputs: mean - reference to mean of recent T purchases in the user's network
     //          standard_deviation - reference to standard deviation of T recent purchases
     // return: true if mean and standard deviation are calculated
     //         false if there are less than 2 purchases in the network
-    bool compute_mean_sd(const user_id_t user_id, double& mean, double& standard_deviation);
+    bool compute_mean_sd(const user_id_t user_id, const uint64_t cutoff_time,
+        double& mean, double& standard_deviation);
 
-    // function to process a line in the file stream for stream_log.json:
+    // function to process an event in stream_log.json:
     //          process a purchase, add a friend, or remove a friend
-    // inputs:  entry - rapidjson object containing an event and its information
+    // inputs:  e - the event
     // outputs: mean - reference to mean of recent T purchases in the user's network
     //          standard_deviation - reference to standard deviation of T recent purchases
     // return:  true if a purchase is anomalous (it is larger than mean+3*standard_deviation)
     //          false otherwise
-    bool process_stream_entries(const rapidjson::Document& entry,
-        double& mean, double& standard_deviation);
+    bool process_stream_event(const event& e, double& mean, double& standard_deviation);
+
+    // function to process an event in stream_log.json with the users held by a backend
+    // inputs:  e - the event
+    // outputs: mean, standard_deviation - as in process_stream_event
+    // return:  true if a purchase is anomalous
+    bool process_backend_event(const event& e, double& mean, double& standard_deviation);
+
+    // function to log and apply a stream event, and score it if it is a purchase
+    // inputs:  e - the event
+    // outputs: mean, standard_deviation - references to the statistics of the
+    //          network, if the purchase is anomalous
+    // return:  true if the event is an anomalous purchase
+    bool apply_stream_event(const event& e, double& mean, double& standard_deviation);
+
+    // function to count a stream event toward the next snapshot, and take it if due
+    // input: out_flagged_log - output stream, flushed before a snapshot
+    void checkpoint_stream_event(std::ostream& out_flagged_log);
+
+    // function to process an event in stream_log.json and
+    //          write it to the output if it is an anomalous purchase
+    // inputs:  e - the event (its line is written with the mean and standard deviation)
+    // output:  out_flagged_log - output stream for flagged_purchases.json
+    void flag_stream_event(const event& e, std::ostream& out_flagged_log);
+
+    // function to write a flagged purchase to the output
+    // inputs:  line - the line of the purchase
+    //          mean, standard_deviation - the statistics of the purchase's network
+    // output:  out_flagged_log - output stream for flagged_purchases.json
+    void write_flagged_purchase(const std::string& line, const double mean,
+        const double standard_deviation, std::ostream& out_flagged_log);
+
+    // function to process a line of the stream log
+    // inputs:  line - the line (its contents are moved into the event)
+    // output:  out_flagged_log - output stream for flagged_purchases.json
+    void process_stream_line(std::string& line, std::ostream& out_flagged_log);
+
+    // function to process the parsed event of the stream (stream_event_, with
+    //          its line), holding it in the reorder buffer if there is one
+    // output:  out_flagged_log - output stream for flagged_purchases.json
+    void process_stream_event(std::ostream& out_flagged_log);
+
+    // function to apply the events still held at the end of the stream and
+    //          wait for the log, the compaction and a snapshot child
+    // output:  out_flagged_log - output stream for flagged_purchases.json
+    void finish_stream(std::ostream& out_flagged_log);
+
+    // function to record that a user changed since the last checkpoint
+    // input: user_id - a user id
+    void mark_dirty(const user_id_t user_id) {
+      if (deltas_per_base_ > 0 && !need_base_)
+        dirty_users_.insert(user_id);
+    }
+
+    // function to restore the users, the parameters and the position of the
+    //          stream from a base snapshot or a delta
+    // inputs:  in - input stream of the checkpoint
+    //          magic - base_snapshot_magic or delta_checkpoint_magic
+    // outputs: wal_sequence - reference to the sequence number of the last
+    //          logged event the checkpoint includes
+    // return:  true if the checkpoint is read completely
+    bool load_checkpoint(std::istream& in, const char* magic, uint64_t& wal_sequence);
+
+    // function to write a base snapshot or a delta under a temporary name,
+    //          sync it and rename it into place
+    // inputs:  header - the checkpoint header
+    //          delta - true to write the dirty users as a delta
+    // return:  true if the checkpoint is written
+    bool write_checkpoint(const checkpoint_header& header, const bool delta);
+
+    // function to fork a child writing a base snapshot of the frozen users
+    //          while the parent continues the stream
+    // input:   header - the checkpoint header
+    // return:  true if the child is started
+    bool fork_snapshot(const checkpoint_header& header);
+
+    // function to collect the child writing a snapshot; once its snapshot is
+    //          in place, the logged events it includes are removed
+    // input:   wait - true to wait for the child, false to return if it still runs
+    void reap_snapshot_child(const bool wait);
+
+    // function run by the compacting thread: merge deltas into a new base
+    // input: last_delta - number of the last delta to merge
+    void compact_checkpoints_in_background(const uint64_t last_delta);
+
+    // function to load the snapshot and its deltas if there is one,
+    //          otherwise read the batch log
+    // inputs:  in_batch_log - input stream for batch_log.json
+    // outputs: wal_sequence - reference to the sequence number of the last
+    //          logged event in the snapshot (0 without a snapshot)
+    // return:  false if the snapshot is corrupted
+    bool restore_snapshot(std::istream& in_batch_log, uint64_t& wal_sequence);
 
   public:
     network() = default;
+    // destructor: waits for a running compaction and a snapshot child
+    ~network();
+
+    network(const network&) = delete;
+    network& operator=(const network&) = delete;
+
+    // function to enable or disable caching the statistics of users' networks
+    // input: use_cache - true to reuse statistics between purchases
+    void set_cache_enabled(const bool use_cache) {use_cache_ = use_cache;}
+
+    // function to enable or disable the event scanner
+    // input: use_scanner - false to parse every line of the logs with rapidjson
+    void set_scanner_enabled(const bool use_scanner) {use_scanner_ = use_scanner;}
+
+    // function to read the lines in the fixed layout of already validated
+    //          input without the scanner's checks, when they have it
+    // input: trusted_input - true to try the fixed layout first
+    void set_trusted_input(const bool trusted_input) {trusted_input_ = trusted_input;}
+
+    // function to use every purchase in a user's network within a time window
+    //          as the baseline, instead of the last T purchases
+    // inputs:  window_seconds - length of the window (0 disables the time window)
+    //          max_purchases - maximum number of purchases in the baseline
+    //                          and in a user's history (0 means T)
+    void set_time_window(const uint64_t window_seconds, const std::size_t max_purchases) {
+      time_window_ = window_seconds;
+      window_max_purchases_ = max_purchases;
+    }
+
+    // function to sort input events by timestamp before they are processed
+    // inputs:  allowed_lateness - seconds an event may arrive behind the latest timestamp;
+    //                             older events are counted as late and skipped
+    //          capacity - maximum number of events held while waiting
+    void set_reorder_buffer(const uint64_t allowed_lateness, const std::size_t capacity) {
+      reorder_.reset(new reorder_buffer(allowed_lateness, capacity));
+    }
+
+    // function to set a stream receiving the lines of late events
+    // input: late_event_log - output stream, nullptr to only count late events
+    void set_late_event_log(std::ostream* late_event_log) {late_event_log_ = late_event_log;}
+
+    // function to set how the errors of the input logs are reported
+    // inputs: first_messages - the messages of every kind of error written in full
+    //         message_interval - after them, write one message of every this many
+    //                            (0: no more, 1: every message)
+    //         rejected_log - stream receiving the rejected lines, nullptr to
+    //                        only count them
+    void set_error_reporting(const std::size_t first_messages,
+        const std::size_t message_interval, std::ostream* rejected_log) {
+      errors_.set_sampling(first_messages, message_interval);
+      errors_.set_rejected_log(rejected_log);
+    }
+
+    // function to write the counts of the errors in the input logs, if any
+    // input: out - output stream
+    void print_error_summary(std::ostream& out) const {errors_.print_summary(out);}
+
+    // function to move all users into shards served by worker threads;
+    //          the following stream events are processed with the shards
+    // input:   n_shards - the number of shards (worker threads)
+    void start_shards(const std::size_t n_shards);
+
+    // function to move all users into memory-mapped files;
+    //          the following stream events are processed with the files
+    // inputs:  path - prefix of the file names
+    //          merge_interval - the number of updates kept in memory before
+    //                           they are merged into the files
+    // return:  true if the files are written and mapped
+    bool start_mmap_store(const std::string& path, const std::size_t merge_interval);
+
+    // function to log every applied stream event to a write-ahead log
+    // inputs: fname - name of the log file
+    //         keep_records - true to keep the events of an existing log for recovery
+    //         group_size - the number of events written together
+    //         sync - when the log is forced to disk
+    //         sync_interval_ms - minimum milliseconds between two periodic syncs
+    // return: true if the log is opened
+    bool set_write_ahead_log(const std::string& fname, const bool keep_records,
+        const std::size_t group_size, const wal_sync sync, const uint64_t sync_interval_ms);
+
+    // function to take a checkpoint of the users every few stream events
+    // inputs: fname - name of the base snapshot file
+    //         interval - the number of stream events between two checkpoints
+    //         deltas_per_base - 0 to write a full snapshot every time; otherwise
+    //                           the checkpoints after the first are deltas, and
+    //                           this many deltas are merged into a new base
+    //                           in the background
+    //         fork - true to write the full snapshots in a forked child
+    void set_snapshots(const std::string& fname, const std::size_t interval,
+        const std::size_t deltas_per_base, const bool fork) {
+      fname_snapshot_ = fname;
+      snapshot_interval_ = events_until_snapshot_ = interval;
+      deltas_per_base_ = deltas_per_base;
+      fork_snapshots_ = fork;
+    }
+
+    // function to set the file receiving the flagged purchases; it is synced
+    //          before every checkpoint, which records its length
+    // input:   fname - name of flagged_purchases.json
+    // return:  true if the file is opened
+    bool set_output_file(const char* fname);
+
+    // function to write a checkpoint (a full snapshot, or a delta of the users
+    //          changed since the last one) and empty the write-ahead log;
+    //          the file is written under a temporary name, synced and renamed
+    // return:  true if the checkpoint is written
+    bool save_snapshot();
+
+    // function to restore the state after a restart: load the snapshot, or read
+    //          the batch log if there is none, then apply the events logged after it
+    // inputs:  in_batch_log - input stream for batch_log.json
+    //          output_bytes - length of the output kept from the previous run
+    // output:  stream_offset - byte offset of the stream log after the last
+    //                          restored event, where the stream continues
+    // return:  true if the state is restored
+    bool recover(std::istream& in_batch_log, uint64_t& stream_offset,
+        const uint64_t output_bytes);
+
+    // function to restore the state of the last checkpoint: load the snapshot,
+    //          or read the batch log if there is none; the stream is read again
+    //          from the checkpoint, so the logged events are not applied
+    // inputs:  in_batch_log - input stream for batch_log.json
+    // outputs: stream_offset - reference to the byte offset of the next stream line
+    //          output_bytes - reference to the length of the output at the checkpoint
+    // return:  true if the state is restored
+    bool resume(std::istream& in_batch_log, uint64_t& stream_offset,
+        uint64_t& output_bytes);
+
+    // function to choose between the arena and operator new for the users;
+    //          must be called before any user is added
+    // input: use_arena - true to allocate the users from the network's arena
+    void set_arena_enabled(const bool use_arena) {
+      map_users_ = user_map(user_map_allocator(use_arena ? &arena_ : nullptr));
+    }
+
+    // function to set a memory budget: when the network grows beyond it,
+    //          the cache is dropped first, then the purchase histories of
+    //          inactive users are released, and what was shed is logged to stderr
+    // inputs:  budget_bytes - the budget (0 disables it)
+    //          inactive_horizon - users without a purchase in this many seconds
+    //                             before the latest event are inactive
+    void set_memory_budget(const std::size_t budget_bytes, const uint64_t inactive_horizon) {
+      memory_budget_ = budget_bytes;
+      inactive_horizon_ = inactive_horizon;
+    }
+
+    // function to evict users without a purchase in a while to a spill file;
+    //          they are read back when an event or a network traversal needs them
+    // inputs:  fname - name of the spill file
+    //          inactive_seconds - users without a purchase in this many seconds
+    //                             before the latest event are evicted
+    // return:  true if the spill file is created
+    bool set_spill_file(const char* fname, const uint64_t inactive_seconds);
+
+    // function to estimate the bytes held by the user table, friend sets,
+    //          purchase histories and cache
+    // return:  the estimate
+    memory_usage get_memory_usage() const;
+
+    // function to set the number of threads reading the batch log
+    // input: n_threads - the number of threads (0 or 1 reads the log in one thread)
+    void set_batch_threads(const std::size_t n_threads) {batch_threads_ = n_threads;}
+
+    // function to write counters of the network (e.g. cache hits) to a stream
+    // input: out - output stream
+    void print_stats(std::ostream& out) const;
 
     // function to read batch_log.json file to
     //        obtain degree of separation and maximum purchase history
     //        and set the initial state for user network and purchase history
-    // input: in_batch_log - input file stream for batch_log.json
-    void read_batch_log(std::ifstream& in_batch_log);
+    // input: in_batch_log - input stream for batch_log.json
+    void read_batch_log(std::istream& in_batch_log);
+
+    // function to read a batch log in the binary event format, as read_batch_log
+    // input: in_batch_log - the mapped log
+    void read_binary_batch_log(binary_event_log& in_batch_log);
 
     // function to read stream_log.json file for
     //         updating user network and purchase history,
     //         detecting anomalous purchases, and
     //         writing those purchases along with associated means and standard deviations to a file
-    // input:  in_stream_log - input file stream for stream_log.json
-    // output: out_flagged_log - output file stream for flagged_purchases.json
-    void process_stream_log(std::ifstream& in_stream_log, std::ofstream& out_flagged_log);
+    // input:  in_stream_log - input stream for stream_log.json
+    // output: out_flagged_log - output stream for flagged_purchases.json
+    void process_stream_log(std::istream& in_stream_log, std::ostream& out_flagged_log);
+
+    // function to read a stream log in the binary event format, as
+    //         process_stream_log; the lines of flagged purchases are written
+    //         in the layout of the json logs
+    // input:  in_stream_log - the mapped log
+    // output: out_flagged_log - output stream for flagged_purchases.json
+    void process_binary_stream_log(binary_event_log& in_stream_log,
+        std::ostream& out_flagged_log);
+
+    // function to process several stream logs merged by time, as
+    //         process_stream_log; the byte offset of the stream is not kept,
+    //         so a checkpoint cannot be resumed from
+    // input:  merger - the merger opened on the stream logs
+    // output: out_flagged_log - output stream for flagged_purchases.json
+    void process_merged_stream_logs(stream_merger& merger, std::ostream& out_flagged_log);
+
+    // function to process stream_log.json as it grows: the lines available
+    //         are processed, the output is flushed, and the follower waits for
+    //         more, until it is stopped
+    // input:  follower - the follower opened on stream_log.json
+    // output: out_flagged_log - output stream for flagged_purchases.json
+    void follow_stream_log(stream_follower& follower, std::ostream& out_flagged_log);
+
+    // function to process the events received by the ingest server until it
+    //         is stopped; every batch is answered with its flagged purchases
+    //         (if they are replied) and a line {"ack": N} with its number of lines
+    // inputs: server - the ingest server, started
+    //         reply_flagged - true to write the flagged purchases back on the
+    //                         connection instead of the output
+    // output: out_flagged_log - output stream for flagged_purchases.json
+    void serve_stream(ingest_server& server, std::ostream& out_flagged_log,
+        const bool reply_flagged);
+
+    // function to process the events written to the shared-memory ring until
+    //         the ingest ends; the flagged purchases go to the results ring
+    // input:  ingest - the rings, created
+    // output: out_flagged_log - output stream for flagged_purchases.json
+    void serve_shm_ring(shm_ingest& ingest, std::ostream& out_flagged_log);
 };
 
 
@@ -0,0 +1,343 @@
+/*
+ * options.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <string>
+#include <stdexcept>
+#include <cstdint>
+#include "options.h"
+
+using namespace std;
+
+// function to parse the value of an option "--name=value" as an unsigned number
+// inputs:  arg - the argument
+//          name - the option name including "--" and "="
+//          max_value - the largest value accepted
+// outputs: value - reference to the parsed number
+// return:  true if arg is this option with a valid number
+//          false otherwise
+static bool parse_number_option(const string& arg, const string& name, uint64_t& value,
+    const uint64_t max_value = UINT64_MAX) {
+  if (arg.compare(0, name.size(), name))
+    return false;
+
+  const string str_value = arg.substr(name.size());
+  if (str_value.empty()
+      || str_value.find_first_not_of("0123456789") != string::npos) {
+    cerr << "Error: " << name << " requires a number" << endl;
+    return false;
+  }
+  uint64_t number = 0;
+  bool in_range = true;
+  try {
+    number = stoull(str_value);
+  } catch (const out_of_range&) {
+    in_range = false;
+  }
+  if (!in_range || number > max_value) {
+    cerr << "Error: " << name << " must be at most " << max_value << endl;
+    return false;
+  }
+  value = number;
+  return true;
+}
+
+bool parse_options(const int argc, char** argv, options& opts) {
+
+  // positional arguments: batch_log.json, stream_log.json (one or more),
+  // flagged_purchases.json
+  vector<const char*> positional;
+
+  for (int i = 1; i < argc; ++i) {
+    const string arg = argv[i];
+
+    if (arg.compare(0, 2, "--")) {
+      positional.push_back(argv[i]);
+    } else if (!arg.compare("--stats")) {
+      opts.print_stats = true;
+    } else if (!arg.compare("--no-cache")) {
+      opts.use_cache = false;
+    } else if (!arg.compare("--no-scanner")) {
+      opts.use_scanner = false;
+    } else if (!arg.compare("--trusted-input")) {
+      opts.trusted_input = true;
+    } else if (!arg.compare("--io-uring")) {
+      opts.use_io_uring = true;
+    } else if (!arg.compare(0, 9, "--window=")) {
+      if (!parse_number_option(arg, "--window=", opts.window_seconds))
+        return false;
+    } else if (!arg.compare(0, 13, "--window-max=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--window-max=", value))
+        return false;
+      opts.window_max_purchases = value;
+    } else if (!arg.compare(0, 19, "--allowed-lateness=")) {
+      if (!parse_number_option(arg, "--allowed-lateness=", opts.allowed_lateness))
+        return false;
+      opts.use_reorder_buffer = true;
+    } else if (!arg.compare(0, 19, "--reorder-capacity=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--reorder-capacity=", value) || value == 0)
+        return false;
+      opts.reorder_capacity = value;
+    } else if (!arg.compare(0, 9, "--shards=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--shards=", value))
+        return false;
+      opts.shards = value;
+    } else if (!arg.compare(0, 16, "--memory-budget=")) {
+      uint64_t value = 0;
+      // the budget is kept in bytes
+      if (!parse_number_option(arg, "--memory-budget=", value, SIZE_MAX >> 20))
+        return false;
+      opts.memory_budget_mb = value;
+    } else if (!arg.compare(0, 19, "--inactive-horizon=")) {
+      if (!parse_number_option(arg, "--inactive-horizon=", opts.inactive_horizon))
+        return false;
+    } else if (!arg.compare(0, 13, "--spill-file=")) {
+      opts.fname_spill = argv[i] + 13;
+    } else if (!arg.compare(0, 14, "--spill-after=")) {
+      if (!parse_number_option(arg, "--spill-after=", opts.spill_after))
+        return false;
+    } else if (!arg.compare(0, 13, "--mmap-store=")) {
+      opts.path_mmap_store = argv[i] + 13;
+    } else if (!arg.compare(0, 13, "--mmap-merge=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--mmap-merge=", value) || value == 0)
+        return false;
+      opts.mmap_merge_interval = value;
+    } else if (!arg.compare(0, 6, "--wal=")) {
+      opts.fname_wal = argv[i] + 6;
+    } else if (!arg.compare(0, 12, "--wal-group=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--wal-group=", value) || value == 0)
+        return false;
+      opts.wal_group_size = value;
+    } else if (!arg.compare("--wal-fsync=never")) {
+      opts.wal_sync_policy = wal_sync::never;
+    } else if (!arg.compare("--wal-fsync=commit")) {
+      opts.wal_sync_policy = wal_sync::commit;
+    } else if (!arg.compare(0, 12, "--wal-fsync=")) {
+      if (!parse_number_option(arg, "--wal-fsync=", opts.wal_sync_interval_ms))
+        return false;
+      opts.wal_sync_policy = wal_sync::periodic;
+    } else if (!arg.compare(0, 11, "--snapshot=")) {
+      opts.fname_snapshot = argv[i] + 11;
+    } else if (!arg.compare(0, 17, "--snapshot-every=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--snapshot-every=", value) || value == 0)
+        return false;
+      opts.snapshot_interval = value;
+    } else if (!arg.compare(0, 18, "--snapshot-deltas=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--snapshot-deltas=", value))
+        return false;
+      opts.snapshot_deltas = value;
+    } else if (!arg.compare("--snapshot-fork")) {
+      opts.snapshot_fork = true;
+    } else if (!arg.compare("--follow")) {
+      opts.follow = true;
+    } else if (!arg.compare(0, 14, "--follow-idle=")) {
+      if (!parse_number_option(arg, "--follow-idle=", opts.follow_idle_seconds))
+        return false;
+      opts.follow = true;
+    } else if (!arg.compare(0, 9, "--listen=")) {
+      opts.listen_address = argv[i] + 9;
+    } else if (!arg.compare(0, 15, "--listen-queue=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--listen-queue=", value) || value == 0)
+        return false;
+      opts.listen_queue_lines = value;
+    } else if (!arg.compare("--reply-flagged")) {
+      opts.reply_flagged = true;
+    } else if (!arg.compare(0, 11, "--shm-ring=")) {
+      opts.path_shm_ring = argv[i] + 11;
+    } else if (!arg.compare(0, 15, "--shm-capacity=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--shm-capacity=", value) || value == 0)
+        return false;
+      opts.shm_capacity = value;
+    } else if (!arg.compare(0, 11, "--shm-spin=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--shm-spin=", value))
+        return false;
+      opts.shm_spin = value;
+    } else if (!arg.compare("--recover")) {
+      opts.recover = true;
+    } else if (!arg.compare("--resume")) {
+      opts.resume = true;
+    } else if (!arg.compare("--no-arena")) {
+      opts.use_arena = false;
+    } else if (!arg.compare(0, 16, "--batch-threads=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--batch-threads=", value))
+        return false;
+      opts.batch_threads = value;
+    } else if (!arg.compare(0, 11, "--late-log=")) {
+      opts.fname_late_log = argv[i] + 11;
+    } else if (!arg.compare(0, 17, "--error-messages=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--error-messages=", value))
+        return false;
+      opts.error_messages = value;
+    } else if (!arg.compare(0, 17, "--error-interval=")) {
+      uint64_t value = 0;
+      if (!parse_number_option(arg, "--error-interval=", value))
+        return false;
+      opts.error_interval = value;
+    } else if (!arg.compare(0, 15, "--rejected-log=")) {
+      opts.fname_rejected_log = argv[i] + 15;
+    } else {
+      cerr << "Error: unknown option " << arg << endl;
+      return false;
+    }
+  }
+
+  if (positional.size() < 3)
+    return false;
+  opts.fname_batch_log = positional.front();
+  opts.fname_stream_logs.assign(positional.begin() + 1, positional.end() - 1);
+  opts.fname_stream_log = opts.fname_stream_logs.front();
+  opts.fname_flagged_log = positional.back();
+
+  // the users are held either by the shards or by the mapped files
+  if (opts.shards > 0 && opts.path_mmap_store != nullptr) {
+    cerr << "Error: --shards and --mmap-store cannot be combined" << endl;
+    return false;
+  }
+  // a snapshot is taken of the users in memory
+  if (opts.fname_snapshot != nullptr && (opts.shards > 0
+      || opts.path_mmap_store != nullptr || opts.fname_spill != nullptr)) {
+    cerr << "Error: --snapshot cannot be combined with --shards, --mmap-store"
+        " or --spill-file" << endl;
+    return false;
+  }
+  // the last T purchases are the baseline without a time window
+  if (opts.window_max_purchases > 0 && opts.window_seconds == 0) {
+    cerr << "Error: --window-max requires --window" << endl;
+    return false;
+  }
+  // the window is found in each history by binary search on the purchase
+  // times, which are in order only when the events are sorted first
+  if (opts.window_seconds > 0 && !opts.use_reorder_buffer) {
+    cerr << "Error: --window requires --allowed-lateness" << endl;
+    return false;
+  }
+  if (opts.snapshot_fork && opts.fname_snapshot == nullptr) {
+    cerr << "Error: --snapshot-fork requires --snapshot" << endl;
+    return false;
+  }
+  // the events of a socket have no offset to checkpoint
+  if (opts.listen_address != nullptr && (opts.follow || opts.resume)) {
+    cerr << "Error: --listen cannot be combined with --follow or --resume" << endl;
+    return false;
+  }
+  // the records of the ring have no line to hold in the reorder buffer
+  if (opts.path_shm_ring != nullptr && (opts.listen_address != nullptr || opts.follow
+      || opts.resume || opts.use_reorder_buffer)) {
+    cerr << "Error: --shm-ring cannot be combined with --listen, --follow, --resume"
+        " or --allowed-lateness" << endl;
+    return false;
+  }
+  if (opts.recover && opts.fname_wal == nullptr && opts.fname_snapshot == nullptr) {
+    cerr << "Error: --recover requires --wal or --snapshot" << endl;
+    return false;
+  }
+  // the trusted layout is read in place of the scanner
+  if (opts.trusted_input && !opts.use_scanner) {
+    cerr << "Error: --trusted-input cannot be combined with --no-scanner" << endl;
+    return false;
+  }
+  // merged stream logs have no single offset to follow, resume or recover from
+  if (opts.fname_stream_logs.size() > 1 && (opts.follow || opts.resume || opts.recover)) {
+    cerr << "Error: several stream logs cannot be combined with --follow, --resume"
+        " or --recover" << endl;
+    return false;
+  }
+  // events held by the reorder buffer are read but not logged, so the stream
+  // cannot continue after the last logged event
+  if (opts.recover && opts.use_reorder_buffer) {
+    cerr << "Error: --recover cannot be combined with --allowed-lateness" << endl;
+    return false;
+  }
+  // the checkpoint is exact only when every event read has been applied
+  if (opts.resume && (opts.fname_snapshot == nullptr || opts.recover
+      || opts.use_reorder_buffer)) {
+    cerr << "Error: --resume requires --snapshot, and cannot be combined with"
+        " --recover or --allowed-lateness" << endl;
+    return false;
+  }
+
+  return true;
+}
+
+void print_usage(const char* program) {
+  cout << "usage: " << program
+      << " [options] batch_log.json stream_log.json... flagged_purchases.json\n"
+      << "several stream logs are merged into one stream by time\n"
+      << "options:\n"
+      << "  --stats     print counters of the network when finished\n"
+      << "  --no-cache  recompute the statistics of a user's network for every purchase\n"
+      << "  --no-scanner  parse every line of the logs with rapidjson\n"
+      << "  --trusted-input  read the lines in the fixed layout of validated logs at\n"
+      << "                   fixed offsets, others with the scanner\n"
+      << "  --io-uring  read the logs and write the output with io_uring when the\n"
+      << "              kernel allows it\n"
+      << "  --window=SECONDS  use every purchase in a user's network made within\n"
+      << "                    SECONDS of the checked purchase as the baseline\n"
+      << "                    (requires --allowed-lateness)\n"
+      << "  --window-max=N    at most N purchases in a time-window baseline\n"
+      << "                    (requires --window; default T)\n"
+      << "  --allowed-lateness=SECONDS  sort events arriving up to SECONDS out of order\n"
+      << "  --reorder-capacity=N        hold at most N events while sorting\n"
+      << "  --late-log=FILE             write events later than the allowed lateness to FILE\n"
+      << "  --error-messages=N  write the first N messages of every kind of input error\n"
+      << "                      (default 10)\n"
+      << "  --error-interval=K  then write one message of every K (default 1000, 0: none)\n"
+      << "  --rejected-log=FILE  copy the input lines rejected as errors to FILE\n"
+      << "  --shards=N  process the stream with N worker threads owning the users\n"
+      << "  --batch-threads=N  build the users of the batch log with N threads\n"
+      << "  --no-arena  allocate the users with operator new instead of the pool arena\n"
+      << "  --memory-budget=MB  beyond MB megabytes, drop the cache, then the purchases\n"
+      << "                      of inactive users\n"
+      << "  --inactive-horizon=SECONDS  users without a purchase in SECONDS are inactive\n"
+      << "                              (default 30 days)\n"
+      << "  --spill-file=FILE  evict users without a recent purchase to FILE\n"
+      << "  --spill-after=SECONDS  evict users without a purchase in SECONDS (default 7 days)\n"
+      << "  --mmap-store=PATH  keep the users in memory-mapped files PATH.* for the stream\n"
+      << "  --mmap-merge=N     merge every N stream updates into the files (default 1000000)\n"
+      << "  --wal=FILE  log the applied stream events to FILE\n"
+      << "  --wal-group=N  write N logged events at a time (default 64)\n"
+      << "  --wal-fsync=never|commit|MS  sync the log never, after every group (default),\n"
+      << "                               or at most every MS milliseconds\n"
+      << "  --snapshot=FILE  write a snapshot of the users to FILE during the stream\n"
+      << "  --snapshot-every=N  take a snapshot every N stream events (default 100000)\n"
+      << "  --snapshot-deltas=K  after the first snapshot, write only the changed users,\n"
+      << "                       merging every K deltas into the snapshot in the background\n"
+      << "  --snapshot-fork  write the full snapshots in a forked child process while\n"
+      << "                   the stream continues (copy-on-write)\n"
+      << "  --follow   keep reading the stream input as it grows (also after rotation),\n"
+      << "             until SIGINT or SIGTERM\n"
+      << "  --follow-idle=SECONDS  follow, stopping once the stream input has not grown\n"
+      << "                         for SECONDS\n"
+      << "  --listen=unix:PATH|tcp:PORT  after the stream input, score the events\n"
+      << "             received on a Unix socket or a TCP port of 127.0.0.1 until SIGINT or SIGTERM\n"
+      << "  --listen-queue=N  stop reading the clients while N received lines wait\n"
+      << "                    (default 65536)\n"
+      << "  --reply-flagged  write the flagged purchases back to the client instead\n"
+      << "                   of the output file\n"
+      << "  --shm-ring=PATH  after the stream input, score the events producers write\n"
+      << "                   to the shared-memory ring PATH.events; the flagged purchases\n"
+      << "                   go to PATH.results\n"
+      << "  --shm-capacity=N  records in each ring (default 65536)\n"
+      << "  --shm-spin=N  attempts before sleeping on a ring (default 1000)\n"
+      << "  --recover  restore the users from the snapshot (or the batch log) and the\n"
+      << "             logged events, then continue the stream after the last logged\n"
+      << "             event (or the snapshot), appending to the output\n"
+      << "  --resume   restore the users from the last snapshot and continue the stream\n"
+      << "             and the output from the checkpoint in it\n";
+}
@@ -0,0 +1,127 @@
+/*
+ * options.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef OPTIONS_H_
+#define OPTIONS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "write_ahead_log.h"
+
+// options stores the command line settings of anomaly_detection:
+//   anomaly_detection [options] [batch input file] [stream input file]... [output file]
+struct options {
+  // input and output file names
+  const char* fname_batch_log = nullptr;
+  const char* fname_stream_log = nullptr;
+  const char* fname_flagged_log = nullptr;
+  // every stream input, in the order of the command line (the first is
+  // fname_stream_log); more than one are merged by time
+  std::vector<const char*> fname_stream_logs;
+
+  // --stats: print counters of the network when the program finishes
+  bool print_stats = false;
+  // --no-cache: compute the statistics of a user's network for every purchase
+  bool use_cache = true;
+  // --no-scanner: parse every line of the logs with rapidjson
+  bool use_scanner = true;
+  // --trusted-input: read the lines in the fixed layout of validated input first
+  bool trusted_input = false;
+  // --io-uring: read the logs and write the output with io_uring (Linux),
+  //             falling back to the streams where it is not available
+  bool use_io_uring = false;
+  // --window=SECONDS: use the purchases of the last SECONDS as the baseline
+  uint64_t window_seconds = 0;
+  // --window-max=N: maximum number of purchases in a time-window baseline (default T)
+  std::size_t window_max_purchases = 0;
+  // --allowed-lateness=SECONDS: sort events that arrive up to SECONDS out of order
+  uint64_t allowed_lateness = 0;
+  bool use_reorder_buffer = false;
+  // --reorder-capacity=N: maximum number of events held for sorting
+  std::size_t reorder_capacity = 1 << 20;
+  // --late-log=FILE: write events arriving later than the allowed lateness to FILE
+  const char* fname_late_log = nullptr;
+  // --error-messages=N: write the first N messages of every kind of input error
+  std::size_t error_messages = 10;
+  // --error-interval=K: then write one message of every K (0: none)
+  std::size_t error_interval = 1000;
+  // --rejected-log=FILE: copy the input lines rejected as errors to FILE
+  const char* fname_rejected_log = nullptr;
+  // --shards=N: process the stream with N worker threads owning the users (0: off)
+  std::size_t shards = 0;
+  // --batch-threads=N: read the batch log with N threads (0 or 1: one thread)
+  std::size_t batch_threads = 0;
+  // --no-arena: allocate the users with operator new instead of the pool arena
+  bool use_arena = true;
+  // --memory-budget=MB: shed caches and inactive users' purchases beyond MB megabytes
+  std::size_t memory_budget_mb = 0;
+  // --inactive-horizon=SECONDS: users without a purchase in SECONDS are inactive
+  uint64_t inactive_horizon = 30 * 24 * 3600;
+  // --spill-file=FILE: evict users without a recent purchase to FILE
+  const char* fname_spill = nullptr;
+  // --spill-after=SECONDS: users without a purchase in SECONDS are evicted
+  uint64_t spill_after = 7 * 24 * 3600;
+  // --mmap-store=PATH: process the stream with the users in memory-mapped files PATH.*
+  const char* path_mmap_store = nullptr;
+  // --mmap-merge=N: merge N updates of the stream into the mapped files at a time
+  std::size_t mmap_merge_interval = 1000000;
+  // --wal=FILE: log the applied stream events to FILE
+  const char* fname_wal = nullptr;
+  // --wal-group=N: write N logged events at a time
+  std::size_t wal_group_size = 64;
+  // --wal-fsync=never|commit|MS: sync the log never, after every group,
+  //                              or at most every MS milliseconds
+  wal_sync wal_sync_policy = wal_sync::commit;
+  uint64_t wal_sync_interval_ms = 0;
+  // --snapshot=FILE: write a snapshot of the users to FILE during the stream
+  const char* fname_snapshot = nullptr;
+  // --snapshot-every=N: take a snapshot every N stream events
+  std::size_t snapshot_interval = 100000;
+  // --snapshot-deltas=K: write only the changed users after the first snapshot,
+  //                      merging K deltas into a new snapshot in the background
+  std::size_t snapshot_deltas = 0;
+  // --snapshot-fork: write the full snapshots in a forked child process
+  bool snapshot_fork = false;
+  // --follow: keep reading the stream log as it grows
+  bool follow = false;
+  // --follow-idle=SECONDS: stop following once the stream log has not grown
+  //                        for SECONDS (0: until SIGINT or SIGTERM)
+  uint64_t follow_idle_seconds = 0;
+  // --listen=unix:PATH|tcp:PORT: after the stream log, score the events
+  //                             received on a socket
+  const char* listen_address = nullptr;
+  // --listen-queue=N: the number of received lines queued before reading stops
+  std::size_t listen_queue_lines = 65536;
+  // --reply-flagged: write the flagged purchases back to the client
+  bool reply_flagged = false;
+  // --shm-ring=PATH: after the stream log, score the events written to the
+  //                  shared-memory ring PATH.events by producers
+  const char* path_shm_ring = nullptr;
+  // --shm-capacity=N: the number of records in each ring
+  std::size_t shm_capacity = 65536;
+  // --shm-spin=N: attempts before sleeping on a ring (busy polling)
+  std::size_t shm_spin = 1000;
+  // --recover: restore the state from the snapshot and the log before the stream
+  bool recover = false;
+  // --resume: restore the state of the last snapshot and continue the stream
+  //           and the output from its checkpoint
+  bool resume = false;
+};
+
+// function to parse the command line arguments
+// inputs:  argc, argv - arguments passed to main
+// outputs: opts - reference to the parsed options
+// return:  true if the arguments are valid
+//          false otherwise
+bool parse_options(const int argc, char** argv, options& opts);
+
+// function to print the usage of anomaly_detection
+// input: program - name of the program
+void print_usage(const char* program);
+
+#endif /* OPTIONS_H_ */
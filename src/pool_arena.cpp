@@ -0,0 +1,98 @@
+/*
+ * pool_arena.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <new>
+#include "pool_arena.h"
+
+using namespace std;
+
+pool_arena::~pool_arena() {
+  for (void* chunk : chunks_)
+    ::operator delete(chunk);
+}
+
+void* pool_arena::allocate(const size_t size) {
+  // a zero-byte request still needs a unique address
+  const size_t rounded = size == 0 ? granularity
+      : (size + granularity - 1) / granularity * granularity;
+
+  lock();
+  add_bytes(used_bytes_, rounded);
+  if (rounded > max_pooled_size) {
+    add_bytes(allocated_bytes_, rounded);
+    unlock();
+    return ::operator new(rounded);
+  }
+
+  // reuse a released block of the same size class
+  free_block*& free_list = free_lists_[rounded / granularity - 1];
+  if (free_list != nullptr) {
+    free_block* block = free_list;
+    free_list = block->next;
+    unlock();
+    return block;
+  }
+
+  // carve the block from the current chunk; the rest of a full chunk is
+  // left unused, since it is smaller than the largest size class
+  if (static_cast<size_t>(chunk_end_ - chunk_next_) < rounded) {
+    try {
+      if (chunks_.size() == chunks_.capacity())
+        chunks_.reserve(chunks_.size() * 2 + 16);
+      chunk_next_ = static_cast<char*>(::operator new(chunk_size));
+    } catch (...) {
+      subtract_bytes(used_bytes_, rounded);
+      unlock();
+      throw;
+    }
+    chunk_end_ = chunk_next_ + chunk_size;
+    chunks_.push_back(chunk_next_);
+    add_bytes(allocated_bytes_, chunk_size);
+  }
+  void* block = chunk_next_;
+  chunk_next_ += rounded;
+  unlock();
+  return block;
+}
+
+void pool_arena::deallocate(void* p, const size_t size) {
+  const size_t rounded = size == 0 ? granularity
+      : (size + granularity - 1) / granularity * granularity;
+
+  lock();
+  subtract_bytes(used_bytes_, rounded);
+  if (rounded > max_pooled_size) {
+    subtract_bytes(allocated_bytes_, rounded);
+    unlock();
+    ::operator delete(p);
+    return;
+  }
+
+  free_block* block = static_cast<free_block*>(p);
+  free_block*& free_list = free_lists_[rounded / granularity - 1];
+  block->next = free_list;
+  free_list = block;
+  unlock();
+}
+
+bool pool_arena::release_unused() {
+  lock();
+  if (used_bytes_.load(std::memory_order_relaxed) != 0) {
+    unlock();
+    return false;
+  }
+  for (void* chunk : chunks_)
+    ::operator delete(chunk);
+  chunks_.clear();
+  chunks_.shrink_to_fit();
+  chunk_next_ = chunk_end_ = nullptr;
+  for (free_block*& free_list : free_lists_)
+    free_list = nullptr;
+  allocated_bytes_.store(0, std::memory_order_relaxed);
+  unlock();
+  return true;
+}
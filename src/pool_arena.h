@@ -0,0 +1,136 @@
+/*
+ * pool_arena.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef POOL_ARENA_H_
+#define POOL_ARENA_H_
+
+#include <cstddef>
+#include <atomic>
+#include <vector>
+#include <type_traits>
+
+// pool_arena hands out the memory of per-user containers (hash-map nodes,
+// friend sets and purchase deques). Small blocks are carved from large chunks
+// and recycled through one free list per size class, so millions of small
+// containers do not pay the general-purpose allocator's headers and
+// fragmentation. Blocks larger than the biggest size class (e.g. bucket
+// arrays) come from operator new. All chunks are released together when the
+// arena is destroyed. The arena may be shared by several threads.
+class pool_arena {
+  private:
+    // sizes of blocks are rounded up to a multiple of granularity
+    static const std::size_t granularity = 16;
+    // the largest block served from the chunks
+    static const std::size_t max_pooled_size = 1024;
+    static const std::size_t n_size_classes = max_pooled_size / granularity;
+    // the size of a chunk requested from operator new
+    static const std::size_t chunk_size = 1 << 20;
+
+    // free_block links the recycled blocks of a size class
+    struct free_block {
+      free_block* next;
+    };
+
+    std::vector<void*> chunks_{};
+    // unused part of the current chunk
+    char* chunk_next_ = nullptr;
+    char* chunk_end_ = nullptr;
+    free_block* free_lists_[n_size_classes] = {};
+
+    // bytes obtained from operator new, and bytes handed out and not yet released;
+    // they are changed under the lock and may be read by other threads without it
+    std::atomic<std::size_t> allocated_bytes_{0};
+    std::atomic<std::size_t> used_bytes_{0};
+
+    // function to add to a counter while the lock is held
+    static void add_bytes(std::atomic<std::size_t>& counter, const std::size_t bytes) {
+      counter.store(counter.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    }
+    static void subtract_bytes(std::atomic<std::size_t>& counter, const std::size_t bytes) {
+      counter.store(counter.load(std::memory_order_relaxed) - bytes, std::memory_order_relaxed);
+    }
+
+    // lock taken by allocate and deallocate (held only for a few instructions)
+    std::atomic_flag lock_ = ATOMIC_FLAG_INIT;
+
+    void lock() {
+      while (lock_.test_and_set(std::memory_order_acquire)) {}
+    }
+    void unlock() {lock_.clear(std::memory_order_release);}
+
+  public:
+    pool_arena() = default;
+    ~pool_arena();
+
+    pool_arena(const pool_arena&) = delete;
+    pool_arena& operator=(const pool_arena&) = delete;
+
+    // function to allocate a block
+    // input:  size - the number of bytes
+    // return: pointer to the block, aligned for any fundamental type
+    void* allocate(const std::size_t size);
+
+    // function to release a block obtained from allocate
+    // inputs: p - pointer to the block
+    //         size - the number of bytes passed to allocate
+    void deallocate(void* p, const std::size_t size);
+
+    // function to return all chunks to the system when no block is handed out
+    // return: true if the chunks were released
+    bool release_unused();
+
+    // function to obtain the number of bytes reserved from the system
+    std::size_t allocated_bytes() const {
+      return allocated_bytes_.load(std::memory_order_relaxed);
+    }
+
+    // function to obtain the number of bytes in blocks currently handed out
+    std::size_t used_bytes() const {return used_bytes_.load(std::memory_order_relaxed);}
+};
+
+// arena_allocator is a standard allocator drawing from a pool_arena.
+// A null arena falls back to operator new, which is how the default
+// allocator is compared against the arena.
+template <typename T>
+class arena_allocator {
+  private:
+    template <typename U> friend class arena_allocator;
+    pool_arena* arena_;
+
+  public:
+    typedef T value_type;
+    // containers keep the arena of the container they are moved from
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    arena_allocator() : arena_(nullptr) {}
+    explicit arena_allocator(pool_arena* arena) : arena_(arena) {}
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) : arena_(other.arena_) {}
+
+    pool_arena* arena() const {return arena_;}
+
+    T* allocate(const std::size_t n) {
+      if (arena_ == nullptr)
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+      return static_cast<T*>(arena_->allocate(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, const std::size_t n) {
+      if (arena_ == nullptr)
+        ::operator delete(p);
+      else
+        arena_->deallocate(p, n * sizeof(T));
+    }
+
+    template <typename U>
+    bool operator==(const arena_allocator<U>& other) const {return arena_ == other.arena_;}
+    template <typename U>
+    bool operator!=(const arena_allocator<U>& other) const {return arena_ != other.arena_;}
+};
+
+#endif /* POOL_ARENA_H_ */
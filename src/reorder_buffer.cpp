@@ -0,0 +1,63 @@
+/*
+ * reorder_buffer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <utility>
+#include "reorder_buffer.h"
+
+using namespace std;
+
+void reorder_buffer::pop_top(event& e) {
+  // priority_queue::top is const, but the element is discarded right away
+  e = std::move(const_cast<pending_event&>(heap_.top()).e);
+  released_time_ = heap_.top().time;
+  released_any_ = true;
+  heap_.pop();
+}
+
+bool reorder_buffer::push(event& e) {
+  // an event older than a released one can not be placed in order any more
+  if (released_any_ && e.time < released_time_) {
+    ++late_events_;
+    return false;
+  }
+
+  if (e.time < max_seen_time_)
+    ++reordered_events_;
+  else
+    max_seen_time_ = e.time;
+
+  const uint64_t time = e.time;
+  heap_.push(pending_event {time, seq_++, std::move(e)});
+  return true;
+}
+
+bool reorder_buffer::pop_ready(event& e) {
+  if (heap_.empty())
+    return false;
+
+  // release the earliest event once no accepted event can be earlier,
+  // or early when the buffer is full
+  const uint64_t watermark = max_seen_time_ > allowed_lateness_ ?
+      max_seen_time_ - allowed_lateness_ : 0;
+  if (heap_.top().time <= watermark) {
+    pop_top(e);
+    return true;
+  }
+  if (heap_.size() > capacity_) {
+    ++forced_releases_;
+    pop_top(e);
+    return true;
+  }
+  return false;
+}
+
+bool reorder_buffer::pop_any(event& e) {
+  if (heap_.empty())
+    return false;
+  pop_top(e);
+  return true;
+}
@@ -0,0 +1,88 @@
+/*
+ * reorder_buffer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef REORDER_BUFFER_H_
+#define REORDER_BUFFER_H_
+
+#include <queue>
+#include <vector>
+#include "event.h"
+
+// reorder_buffer holds events that may arrive a few seconds out of order
+// and releases them in timestamp order once the watermark
+// (the largest timestamp seen minus the allowed lateness) has passed them.
+// Events older than the last released event are late: they are rejected,
+// so the network only ever appends purchases in time order.
+class reorder_buffer {
+  private:
+    // pending_event is an event waiting in the buffer;
+    // seq keeps the arrival order of events with the same timestamp
+    struct pending_event {
+      uint64_t time;
+      std::size_t seq;
+      event e;
+    };
+
+    // comparison that puts the earliest event at the top of the heap
+    struct later_event {
+      bool operator()(const pending_event& a, const pending_event& b) const {
+        return a.time != b.time ? a.time > b.time : a.seq > b.seq;
+      }
+    };
+
+    // how far behind the largest timestamp an event may arrive (seconds)
+    uint64_t allowed_lateness_;
+    // maximum number of events held; beyond it the earliest event is released early
+    std::size_t capacity_;
+    std::priority_queue<pending_event, std::vector<pending_event>, later_event> heap_{};
+    // the largest timestamp seen so far
+    uint64_t max_seen_time_ = 0;
+    // the timestamp of the last released event
+    uint64_t released_time_ = 0;
+    // true once an event has been released
+    bool released_any_ = false;
+    // arrival counter
+    std::size_t seq_ = 0;
+
+    // counters
+    std::size_t late_events_ = 0;
+    std::size_t forced_releases_ = 0;
+    std::size_t reordered_events_ = 0;
+
+    // function to move the earliest event out of the heap
+    void pop_top(event& e);
+
+  public:
+    // constructor
+    // inputs: allowed_lateness - seconds an event may arrive behind the largest timestamp
+    //         capacity - maximum number of events held in the buffer
+    reorder_buffer(const uint64_t allowed_lateness, const std::size_t capacity)
+        : allowed_lateness_(allowed_lateness), capacity_(capacity) {}
+
+    // function to add an event to the buffer
+    // input:  e - the event (moved into the buffer when accepted)
+    // return: true if the event is accepted
+    //         false if it is late, i.e. older than events already released
+    bool push(event& e);
+
+    // function to release the next event that the watermark has passed
+    // output: e - reference to the released event
+    // return: true if an event is released
+    bool pop_ready(event& e);
+
+    // function to release the next event regardless of the watermark (end of input)
+    // output: e - reference to the released event
+    // return: true if an event is released
+    bool pop_any(event& e);
+
+    std::size_t size() const {return heap_.size();}
+    std::size_t late_events() const {return late_events_;}
+    std::size_t forced_releases() const {return forced_releases_;}
+    std::size_t reordered_events() const {return reordered_events_;}
+};
+
+#endif /* REORDER_BUFFER_H_ */
@@ -0,0 +1,85 @@
+/*
+ * running_stats.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef RUNNING_STATS_H_
+#define RUNNING_STATS_H_
+
+#include <cstddef>
+#include <cmath>
+
+// running_stats keeps the mean and the sum of squared deviations (M2)
+// of a multiset of purchase amounts. Amounts can be added and removed in O(1)
+// with Welford's updates, which stay accurate for large amounts where
+// sum2/n - mean*mean loses all significant digits or becomes negative.
+class running_stats {
+  private:
+    // the number of amounts
+    std::size_t count_ = 0;
+    // mean of the amounts
+    double mean_ = 0.0;
+    // sum of squared deviations from the mean
+    double m2_ = 0.0;
+
+  public:
+    running_stats() = default;
+
+    // function to set the statistics from sums of shifted amounts
+    // inputs: n - the number of amounts
+    //         shift - value subtracted from every amount
+    //         sum - sum of (amount - shift)
+    //         sum2 - sum of (amount - shift)^2
+    void assign(const std::size_t n, const double shift,
+        const double sum, const double sum2) {
+      count_ = n;
+      if (n == 0) {
+        mean_ = m2_ = 0.0;
+        return;
+      }
+      mean_ = shift + sum / n;
+      m2_ = sum2 - sum * (sum / n);
+      if (m2_ < 0.0)
+        m2_ = 0.0;
+    }
+
+    // function to add an amount
+    // input: amount - a purchase amount
+    void push(const double amount) {
+      ++count_;
+      const double delta = amount - mean_;
+      mean_ += delta / count_;
+      m2_ += delta * (amount - mean_);
+    }
+
+    // function to remove an amount that was added before
+    // input: amount - a purchase amount
+    void pop(const double amount) {
+      if (count_ <= 1) {
+        count_ = 0;
+        mean_ = m2_ = 0.0;
+        return;
+      }
+      --count_;
+      const double delta = amount - mean_;
+      mean_ -= delta / count_;
+      m2_ -= delta * (amount - mean_);
+      // rounding can leave a tiny negative value when all amounts are equal
+      if (m2_ < 0.0)
+        m2_ = 0.0;
+    }
+
+    std::size_t count() const {return count_;}
+    double mean() const {return mean_;}
+
+    // function to obtain the population variance of the amounts
+    // return: M2 / n, 0 if there are no amounts
+    double variance() const {return count_ > 0 ? m2_ / count_ : 0.0;}
+
+    // function to obtain the population standard deviation of the amounts
+    double standard_deviation() const {return std::sqrt(variance());}
+};
+
+#endif /* RUNNING_STATS_H_ */
@@ -0,0 +1,332 @@
+/*
+ * sharded_network.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <ostream>
+#include "sharded_network.h"
+
+using namespace std;
+
+// function to wait a little while a queue is full or empty:
+// spin first, then give the core to other threads
+static inline void backoff(unsigned& spins) {
+  if (++spins < 64)
+    return;
+  this_thread::yield();
+}
+
+// an idle worker spins and yields this many times before it sleeps; events
+// arriving in bursts find it awake, and an idle process does not keep a core busy
+static const unsigned idle_spins = 4096;
+
+sharded_network::sharded_network(const size_t n_shards, user_map&& users) {
+
+  shards_.reserve(n_shards);
+  const bool use_arena = users.get_allocator().arena() != nullptr;
+  for (size_t i = 0; i < n_shards; ++i)
+    shards_.emplace_back(new shard(use_arena));
+
+  for (auto& user : users)
+    shards_[shard_of(user.first)]->users.emplace(user.first, std::move(user.second));
+  users.clear();
+
+  for (auto& s : shards_)
+    s->worker = thread(run_shard, s.get());
+}
+
+sharded_network::~sharded_network() {
+  shard_message message;
+  message.type = shard_request::kind::stop;
+  for (size_t i = 0; i < shards_.size(); ++i)
+    send(i, message);
+  for (auto& s : shards_)
+    s->worker.join();
+}
+
+void sharded_network::send(const size_t shard_index, const shard_message& message) const {
+  shard* s = shards_[shard_index].get();
+  unsigned spins = 0;
+  while (!s->requests.try_push(message))
+    backoff(spins);
+
+  // pairs with the fence in next_message: either the worker sees the message
+  // before it sleeps, or this thread sees that it sleeps and wakes it
+  atomic_thread_fence(memory_order_seq_cst);
+  if (s->sleeping.load(memory_order_relaxed)) {
+    lock_guard<mutex> lock(s->wake_mutex);
+    s->wake.notify_one();
+  }
+}
+
+void sharded_network::send_query(const size_t shard_index, shard_request* request) const {
+  shard_message message;
+  message.type = request->type;
+  message.request = request;
+  send(shard_index, message);
+}
+
+shard_request* sharded_network::receive(const size_t shard_index) const {
+  shard_request* reply = nullptr;
+  unsigned spins = 0;
+  while (!shards_[shard_index]->replies.try_pop(reply))
+    backoff(spins);
+  return reply;
+}
+
+void sharded_network::send_reply(shard* s, shard_request* request) {
+  unsigned spins = 0;
+  while (!s->replies.try_push(request))
+    backoff(spins);
+}
+
+shard_message sharded_network::next_message(shard* s) {
+  shard_message message;
+  for (unsigned spins = 0; spins < idle_spins; ) {
+    if (s->requests.try_pop(message))
+      return message;
+    backoff(spins);
+  }
+
+  unique_lock<mutex> lock(s->wake_mutex);
+  s->sleeping.store(true, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  while (!s->requests.try_pop(message))
+    s->wake.wait(lock);
+  s->sleeping.store(false, memory_order_relaxed);
+  return message;
+}
+
+void sharded_network::run_shard(shard* s) {
+  for (;;) {
+    const shard_message message = next_message(s);
+    shard_request* request = message.request;
+
+    switch (message.type) {
+      case shard_request::kind::purchase: {
+        user_info& user = s->users[message.id];
+        user.update_purchases(message.purchase.tm_info.purchase_time,
+            message.purchase.tm_info.purchase_order, message.purchase.amount,
+            message.limit);
+        if (message.cutoff_time > 0)
+          user.remove_purchases_before(message.cutoff_time);
+        break;
+      }
+
+      case shard_request::kind::add_friend:
+        s->users[message.id].add_friend(message.other_id);
+        break;
+
+      case shard_request::kind::remove_friend:
+        s->users[message.id].remove_friend(message.other_id);
+        break;
+
+      case shard_request::kind::expand:
+        for (const user_id_t user_id : request->ids) {
+          const auto iter_user = s->users.find(user_id);
+          if (iter_user == s->users.end())
+            continue;
+          const friend_set& friends = iter_user->second.get_friend_list();
+          request->friend_ids.insert(request->friend_ids.end(),
+              friends.begin(), friends.end());
+        }
+        send_reply(s, request);
+        break;
+
+      case shard_request::kind::top_purchases:
+        request->purchases.reserve(request->limit * 2);
+        for (const user_id_t user_id : request->ids) {
+          const auto iter_user = s->users.find(user_id);
+          if (iter_user == s->users.end())
+            continue;
+          const user_info& user = iter_user->second;
+          const purchase_record& purchases = user.get_purchase_record();
+          merge_recent_purchases(request->purchases, purchases.begin(),
+              purchases.begin() + user.count_purchases_since(request->cutoff_time),
+              request->limit);
+        }
+        send_reply(s, request);
+        break;
+
+      case shard_request::kind::memory:
+        request->usage.add_users(s->users);
+        send_reply(s, request);
+        break;
+
+      case shard_request::kind::release_inactive:
+        request->released_users = request->released_purchases = 0;
+        for (auto& user : s->users) {
+          const purchase_record& purchases = user.second.get_purchase_record();
+          if (purchases.empty()
+              || purchases.front().tm_info.purchase_time >= request->cutoff_time)
+            continue;
+          ++request->released_users;
+          request->released_purchases += user.second.release_purchases();
+        }
+        send_reply(s, request);
+        break;
+
+      case shard_request::kind::arena:
+        request->arena_bytes = s->arena.used_bytes();
+        send_reply(s, request);
+        break;
+
+      case shard_request::kind::stop:
+        return;
+    }
+  }
+}
+
+shard_request* sharded_network::start_query(const size_t shard_index,
+    const shard_request::kind type) const {
+  shard_request* request = &shards_[shard_index]->query;
+  request->type = type;
+  request->ids.clear();
+  request->friend_ids.clear();
+  request->purchases.clear();
+  return request;
+}
+
+void sharded_network::add_purchase(const user_id_t user_id,
+    const purchase_info& purchase, const size_t limit, const uint64_t cutoff_time) {
+  shard_message message;
+  message.type = shard_request::kind::purchase;
+  message.id = user_id;
+  message.purchase = purchase;
+  message.limit = limit;
+  message.cutoff_time = cutoff_time;
+  send(shard_of(user_id), message);
+}
+
+void sharded_network::change_friendship(const user_id_t id1, const user_id_t id2,
+    const bool befriend) {
+  shard_message message;
+  message.type = befriend ?
+      shard_request::kind::add_friend : shard_request::kind::remove_friend;
+
+  // each side of the friendship is stored by the shard owning that user
+  const user_id_t ids[2][2] = {{id1, id2}, {id2, id1}};
+  for (const auto& pair : ids) {
+    message.id = pair[0];
+    message.other_id = pair[1];
+    send(shard_of(pair[0]), message);
+  }
+}
+
+unordered_set<user_id_t> sharded_network::get_friends_network(const user_id_t user_id,
+    const size_t D) {
+
+  // visited contains the user and the friends found so far
+  unordered_set<user_id_t> visited {user_id};
+  vector<user_id_t> frontier {user_id};
+  vector<shard_request*> pending(shards_.size(), nullptr);
+
+  // expand the network one degree of separation at a time
+  for (size_t degree = 1; degree <= D && !frontier.empty(); ++degree) {
+    // send each shard the frontier users it owns
+    for (const user_id_t friend_id : frontier) {
+      const size_t shard_index = shard_of(friend_id);
+      if (pending[shard_index] == nullptr)
+        pending[shard_index] = start_query(shard_index, shard_request::kind::expand);
+      pending[shard_index]->ids.push_back(friend_id);
+    }
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      if (pending[i] != nullptr)
+        send_query(i, pending[i]);
+    }
+
+    // collect the friends of the frontier; the unvisited ones form the next frontier
+    frontier.clear();
+    for (size_t i = 0; i < shards_.size(); ++i) {
+      if (pending[i] == nullptr)
+        continue;
+      const shard_request* reply = receive(i);
+      for (const user_id_t friend_id : reply->friend_ids) {
+        if (visited.insert(friend_id).second)
+          frontier.push_back(friend_id);
+      }
+      pending[i] = nullptr;
+    }
+  }
+
+  // remove user from the friend list
+  visited.erase(user_id);
+  return visited;
+}
+
+vector<purchase_info> sharded_network::friend_purchases(
+    const unordered_set<user_id_t>& friends_in_network,
+    const uint64_t cutoff_time, const size_t limit) {
+
+  // every shard merges the purchases of its users in the network
+  vector<shard_request*> pending(shards_.size(), nullptr);
+  for (const user_id_t friend_id : friends_in_network) {
+    const size_t shard_index = shard_of(friend_id);
+    if (pending[shard_index] == nullptr) {
+      pending[shard_index] = start_query(shard_index, shard_request::kind::top_purchases);
+      pending[shard_index]->limit = limit;
+      pending[shard_index]->cutoff_time = cutoff_time;
+    }
+    pending[shard_index]->ids.push_back(friend_id);
+  }
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    if (pending[i] != nullptr)
+      send_query(i, pending[i]);
+  }
+
+  // merge the replies of the shards
+  vector<purchase_info> purchases;
+  purchases.reserve(limit * 2);
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    if (pending[i] == nullptr)
+      continue;
+    const shard_request* reply = receive(i);
+    merge_recent_purchases(purchases, reply->purchases.begin(), reply->purchases.end(),
+        limit);
+  }
+
+  return purchases;
+}
+
+void sharded_network::add_memory_usage(memory_usage& usage) {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    shard_request* request = start_query(i, shard_request::kind::memory);
+    request->usage = memory_usage();
+    send_query(i, request);
+  }
+  for (size_t i = 0; i < shards_.size(); ++i)
+    usage.add(receive(i)->usage);
+}
+
+size_t sharded_network::arena_bytes() const {
+  // the arenas are read by their workers, so the updates sent before are
+  // counted, and the replies wait for them
+  for (size_t i = 0; i < shards_.size(); ++i)
+    send_query(i, start_query(i, shard_request::kind::arena));
+  size_t bytes = 0;
+  for (size_t i = 0; i < shards_.size(); ++i)
+    bytes += receive(i)->arena_bytes;
+  return bytes;
+}
+
+void sharded_network::release_inactive_purchases(const uint64_t cutoff_time,
+    size_t& released_users, size_t& released_purchases) {
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    shard_request* request = start_query(i, shard_request::kind::release_inactive);
+    request->cutoff_time = cutoff_time;
+    send_query(i, request);
+  }
+  released_users = released_purchases = 0;
+  for (size_t i = 0; i < shards_.size(); ++i) {
+    const shard_request* reply = receive(i);
+    released_users += reply->released_users;
+    released_purchases += reply->released_purchases;
+  }
+}
+
+void sharded_network::print_stats(ostream& out) const {
+  out << "shards: " << shards_.size() << "\n"
+      << "shard arena used bytes: " << arena_bytes() << "\n";
+}
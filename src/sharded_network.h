@@ -0,0 +1,210 @@
+/*
+ * sharded_network.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef SHARDED_NETWORK_H_
+#define SHARDED_NETWORK_H_
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include "user_info.h"
+#include "memory_usage.h"
+#include "user_backend.h"
+#include "spsc_queue.h"
+
+// shard_request is a query from the coordinating thread to a shard. Every
+// shard has one request object, reused for all its queries, so its vectors
+// keep their capacity; the shard answers in the same object and sends it back
+// on the shard's reply queue.
+struct shard_request {
+  enum class kind {
+    purchase,       // add a purchase to user id
+    add_friend,     // add friend other_id to user id
+    remove_friend,  // remove friend other_id from user id
+    expand,         // reply with the friends of users ids
+    top_purchases,  // reply with the most recent purchases of users ids
+    memory,         // reply with the memory used by the shard's users
+    release_inactive,  // release the purchases of users inactive since cutoff_time
+    arena,          // reply with the bytes used by the shard's arena
+    stop            // stop the worker thread
+  };
+
+  kind type;
+  // maximum number of purchases returned by top_purchases
+  std::size_t limit;
+  // purchases made before this time are skipped (0 keeps all)
+  uint64_t cutoff_time;
+  // users of an expand or top_purchases query
+  std::vector<user_id_t> ids;
+  // reply of expand: friend ids of all queried users (may repeat)
+  std::vector<user_id_t> friend_ids;
+  // reply of top_purchases: most recent purchases (most recent first)
+  std::vector<purchase_info> purchases;
+  // reply of memory
+  memory_usage usage;
+  // reply of release_inactive: the users whose purchases were released
+  //                            and the number of purchases released
+  std::size_t released_users;
+  std::size_t released_purchases;
+  // reply of arena
+  std::size_t arena_bytes;
+};
+
+// shard_message is a fixed-size message on a shard's request queue. Updates
+// (purchase, add_friend, remove_friend) and stop are carried in the message
+// itself, so no memory is allocated per event; the other kinds point to the
+// shard's request object. Messages are processed in the order they are sent.
+struct shard_message {
+  shard_request::kind type;
+  user_id_t id;
+  user_id_t other_id;
+  purchase_info purchase;
+  // maximum number of purchases kept per user
+  std::size_t limit;
+  // purchases made before this time are dropped (0 keeps all)
+  uint64_t cutoff_time;
+  // the query of the other kinds
+  shard_request* request;
+};
+
+// sharded_network partitions the users by id hash across worker threads.
+// Each shard owns the friend sets and purchase histories of its users and
+// is reached only through lock-free queues, so the calling thread can keep
+// processing events in order while the shards expand network frontiers and
+// collect recent purchases in parallel.
+class sharded_network : public user_backend {
+  private:
+    // shard is one worker thread with the users it owns; the users of a
+    // shard draw from the shard's own arena, so the workers never contend
+    // for the lock of a shared arena. A worker that finds no message for a
+    // while sleeps on wake until the coordinating thread sends one.
+    struct shard {
+      pool_arena arena;
+      user_map users;
+      spsc_queue<shard_message> requests;
+      spsc_queue<shard_request*> replies;
+      // the request object of the shard's queries
+      shard_request query;
+      std::mutex wake_mutex;
+      std::condition_variable wake;
+      // true while the worker sleeps or is about to
+      std::atomic<bool> sleeping{false};
+      std::thread worker;
+
+      explicit shard(const bool use_arena)
+          : users(user_map_allocator(use_arena ? &arena : nullptr)),
+            requests(4096), replies(64) {}
+    };
+
+    std::vector<std::unique_ptr<shard>> shards_{};
+
+    // function to obtain the shard owning a user
+    std::size_t shard_of(const user_id_t user_id) const {
+      return std::hash<user_id_t>()(user_id) % shards_.size();
+    }
+
+    // function to send a message to a shard, waiting while its queue is full,
+    //          and to wake the worker if it sleeps
+    void send(const std::size_t shard_index, const shard_message& message) const;
+
+    // function to send a query to a shard
+    // inputs: shard_index - the shard
+    //         request - the shard's request object, filled with the query
+    void send_query(const std::size_t shard_index, shard_request* request) const;
+
+    // function to obtain the request object of a shard for a new query
+    // inputs: shard_index - the shard
+    //         type - the kind of the query
+    // return: the request object, with the vectors of the last query cleared
+    shard_request* start_query(const std::size_t shard_index,
+        const shard_request::kind type) const;
+
+    // function to wait for the reply of a shard
+    shard_request* receive(const std::size_t shard_index) const;
+
+    // function to wait for the next message of a shard, sleeping when none
+    //          has come for a while
+    static shard_message next_message(shard* s);
+
+    // function to send the answer of a query back to the coordinating thread
+    static void send_reply(shard* s, shard_request* request);
+
+    // function run by the worker thread of a shard
+    static void run_shard(shard* s);
+
+  public:
+    // constructor: distributes the users over the shards and starts the workers
+    // inputs: n_shards - the number of shards (worker threads)
+    //         users - all users, moved into the shards (each shard has its own
+    //                 arena if the users are in an arena)
+    sharded_network(const std::size_t n_shards, user_map&& users);
+
+    // destructor: stops the workers
+    ~sharded_network() override;
+
+    sharded_network(const sharded_network&) = delete;
+    sharded_network& operator=(const sharded_network&) = delete;
+
+    std::size_t size() const {return shards_.size();}
+
+    // function to add a purchase to a user
+    // inputs: user_id - the buyer
+    //         purchase - the purchase information
+    //         limit - the number of recent purchases kept per user
+    //         cutoff_time - purchases made before this time are removed (0 keeps all)
+    void add_purchase(const user_id_t user_id, const purchase_info& purchase,
+        const std::size_t limit, const uint64_t cutoff_time) override;
+
+    // function to add or remove a friendship between two different users
+    // inputs: id1, id2 - ids of the two users
+    //         befriend - true to add the friendship, false to remove it
+    void change_friendship(const user_id_t id1, const user_id_t id2,
+        const bool befriend) override;
+
+    // function to obtain ids of all friends in a user's social network
+    // inputs: user_id - a user id
+    //         D - degree of separation
+    // return: friend ids of the user within D degree of separation
+    std::unordered_set<user_id_t> get_friends_network(const user_id_t user_id,
+        const std::size_t D) override;
+
+    // function to obtain the recent purchases in a user's network
+    // inputs: friends_in_network - friend ids of a user within D degree of separation
+    //         cutoff_time - purchases made before this time are skipped (0 keeps all)
+    //         limit - the number of recent purchases to return
+    // return: the most recent purchases (most recent first)
+    std::vector<purchase_info> friend_purchases(
+        const std::unordered_set<user_id_t>& friends_in_network,
+        const uint64_t cutoff_time, const std::size_t limit) override;
+
+    // function to estimate the memory used by the users of all shards
+    // output: usage - reference to the estimate the users are added to
+    void add_memory_usage(memory_usage& usage) override;
+
+    // function to release the purchases of users whose last purchase was made
+    //          before a time
+    // inputs:  cutoff_time - users with no purchase at or after this time are inactive
+    // outputs: released_users, released_purchases - references to the numbers of
+    //          users and purchases released
+    void release_inactive_purchases(const uint64_t cutoff_time,
+        std::size_t& released_users, std::size_t& released_purchases) override;
+
+    // function to obtain the bytes in blocks handed out by the shards' arenas,
+    //          after the shards have processed the updates sent before
+    std::size_t arena_bytes() const override;
+
+    // function to write the number of shards to a stream
+    // input: out - output stream
+    void print_stats(std::ostream& out) const override;
+};
+
+#endif /* SHARDED_NETWORK_H_ */
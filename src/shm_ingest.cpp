@@ -0,0 +1,124 @@
+/*
+ * shm_ingest.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <csignal>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include "shm_ingest.h"
+
+using namespace std;
+
+// the longest sleep on a ring before the stop conditions are checked again
+static const uint32_t sleep_ms = 50;
+// the events taken between two checks for a stop signal under load
+static const size_t signal_check_interval = 4096;
+
+shm_ingest::~shm_ingest() {
+  if (signal_fd_ >= 0)
+    close(signal_fd_);
+  if (!fname_events_.empty()) {
+    remove(fname_events_.c_str());
+    remove(fname_results_.c_str());
+  }
+}
+
+bool shm_ingest::open(const string& path, const uint64_t capacity, const size_t spin) {
+  spin_ = spin;
+
+  // the stop signals stay pending until the signalfd is read
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  if (sigprocmask(SIG_BLOCK, &signals, nullptr) != 0)
+    return false;
+  signal_fd_ = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (signal_fd_ < 0)
+    return false;
+
+  // the results ring exists before a producer can attach to the events ring
+  fname_events_ = path + ".events";
+  fname_results_ = path + ".results";
+  return results_.create(fname_results_, capacity) && events_.create(fname_events_, capacity);
+}
+
+bool shm_ingest::stop_requested() {
+  struct signalfd_siginfo info;
+  if (!stopped_ && read(signal_fd_, &info, sizeof(info)) == sizeof(info))
+    stopped_ = true;
+  return stopped_;
+}
+
+bool shm_ingest::pop_event(event& e, uint64_t& tag) {
+  shm_event_record record;
+  for (;;) {
+    if (++unchecked_events_ >= signal_check_interval) {
+      unchecked_events_ = 0;
+      if (stop_requested())
+        return false;
+    }
+    if (events_.pop(record, spin_, sleep_ms))
+      break;
+    if (stop_requested())
+      return false;
+    // the stream ends with the last producer; a record it wrote before
+    // leaving may have been published after the pop above
+    if (events_.producers_gone()) {
+      if (events_.try_pop(record))
+        break;
+      return false;
+    }
+  }
+
+  e.kind = static_cast<event_kind>(record.kind);
+  e.time = record.time;
+  e.id1 = record.id1;
+  e.id2 = record.id2;
+  e.amount = record.amount;
+  e.line.clear();
+  tag = record.tag;
+  ++received_events_;
+  return true;
+}
+
+void shm_ingest::push_result(const event& e, const uint64_t tag, const double mean,
+    const double standard_deviation) {
+  shm_result_record result;
+  result.event.tag = tag;
+  result.event.time = e.time;
+  result.event.id1 = e.id1;
+  result.event.id2 = e.id2;
+  result.event.amount = e.amount;
+  result.event.kind = static_cast<uint32_t>(e.kind);
+  result.event.reserved = 0;
+  result.mean = mean;
+  result.standard_deviation = standard_deviation;
+
+  // a reader that falls behind holds the engine back, until a stop signal
+  if (results_.try_push(result)) {
+    ++pushed_results_;
+    return;
+  }
+  ++result_waits_;
+  while (!results_.push(result, spin_, sleep_ms)) {
+    if (stop_requested()) {
+      ++dropped_results_;
+      return;
+    }
+  }
+  ++pushed_results_;
+}
+
+void shm_ingest::print_stats(ostream& out) const {
+  out << "shm ring capacity: " << events_.capacity() << "\n"
+      << "shm events: " << received_events_ << ", consumer sleeps: "
+      << events_.sleeps() << "\n"
+      << "shm results: " << pushed_results_ << ", waits for the reader: " << result_waits_
+      << ", dropped: " << dropped_results_ << "\n";
+}
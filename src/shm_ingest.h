@@ -0,0 +1,82 @@
+/*
+ * shm_ingest.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef SHM_INGEST_H_
+#define SHM_INGEST_H_
+
+#include <cstdint>
+#include <string>
+#include <iosfwd>
+#include "shm_ring.h"
+#include "event.h"
+
+// shm_ingest is the engine's side of the shared-memory ingest: it creates
+// PATH.events, a ring the producers write stream events to (shm_producer),
+// and PATH.results, a ring receiving the flagged purchases. Following ends on
+// SIGINT or SIGTERM (read from a signalfd), or once every producer that
+// attached has left and the events ring is empty.
+class shm_ingest {
+  private:
+    shm_ring<shm_event_record> events_{};
+    shm_ring<shm_result_record> results_{};
+    std::string fname_events_{};
+    std::string fname_results_{};
+    int signal_fd_ = -1;
+    // attempts before sleeping on an empty events ring or a full results ring
+    std::size_t spin_ = 0;
+    bool stopped_ = false;
+    // events taken since the stop signal was last checked
+    std::size_t unchecked_events_ = 0;
+
+    // counters
+    std::size_t received_events_ = 0;
+    std::size_t pushed_results_ = 0;
+    std::size_t result_waits_ = 0;
+    std::size_t dropped_results_ = 0;
+
+    // function to check for a stop signal without waiting
+    // return: true once a stop signal has been received
+    bool stop_requested();
+
+  public:
+    shm_ingest() = default;
+    // destructor: removes the ring files (mapped rings stay valid)
+    ~shm_ingest();
+
+    shm_ingest(const shm_ingest&) = delete;
+    shm_ingest& operator=(const shm_ingest&) = delete;
+
+    // function to create the rings; SIGINT and SIGTERM are blocked, so call
+    //          it before any thread is started
+    // inputs: path - prefix of the ring files (e.g. /dev/shm/NAME)
+    //         capacity - the number of records in each ring
+    //         spin - attempts before sleeping (busy polling) on a ring
+    // return: true if the rings are created
+    bool open(const std::string& path, const uint64_t capacity, const std::size_t spin);
+
+    // function to take the next event, waiting for one
+    // outputs: e - reference to the event (without a line)
+    //          tag - reference to the producer's tag of the event
+    // return:  false when the ingest ends
+    bool pop_event(event& e, uint64_t& tag);
+
+    // function to write a flagged purchase to the results ring, waiting while
+    //          it is full (it is dropped after a stop signal)
+    // inputs: e, tag - the purchase
+    //         mean, standard_deviation - the statistics of the network
+    void push_result(const event& e, const uint64_t tag, const double mean,
+        const double standard_deviation);
+
+    // function to record that the last event taken was processed
+    void mark_processed() {events_.mark_processed();}
+
+    // function to write the counters of the ingest to a stream
+    // input: out - output stream
+    void print_stats(std::ostream& out) const;
+};
+
+#endif /* SHM_INGEST_H_ */
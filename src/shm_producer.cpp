@@ -0,0 +1,36 @@
+/*
+ * shm_producer.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include "shm_producer.h"
+
+using namespace std;
+
+bool shm_producer::attach(const string& path, const size_t spin) {
+  spin_ = spin;
+  if (!results_.attach(path + ".results") || !events_.attach(path + ".events"))
+    return false;
+  events_.add_producer();
+  attached_ = true;
+  return true;
+}
+
+void shm_producer::detach() {
+  if (attached_) {
+    events_.remove_producer();
+    attached_ = false;
+  }
+}
+
+void shm_producer::send(const shm_event_record& record) {
+  while (!events_.push(record, spin_, 10)) {}
+}
+
+bool shm_producer::read_result(shm_result_record& result, const uint32_t timeout_ms) {
+  if (timeout_ms == 0)
+    return results_.try_pop(result);
+  return results_.pop(result, spin_, timeout_ms);
+}
@@ -0,0 +1,65 @@
+/*
+ * shm_producer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef SHM_PRODUCER_H_
+#define SHM_PRODUCER_H_
+
+#include <cstdint>
+#include <string>
+#include "shm_ring.h"
+
+// shm_producer is the library used by a process on the same host to send
+// stream events to anomaly_detection --shm-ring=PATH without a system call
+// per event: records are written directly into the shared events ring.
+// Several producers may send at once; the flagged purchases come back in the
+// results ring, which only one process should read.
+// Link with libshm_producer.a.
+class shm_producer {
+  private:
+    shm_ring<shm_event_record> events_{};
+    shm_ring<shm_result_record> results_{};
+    bool attached_ = false;
+    // attempts before sleeping on a full events ring or an empty results ring
+    std::size_t spin_ = 0;
+
+  public:
+    shm_producer() = default;
+    // destructor: detaches from the rings
+    ~shm_producer() {detach();}
+
+    shm_producer(const shm_producer&) = delete;
+    shm_producer& operator=(const shm_producer&) = delete;
+
+    // function to attach to the rings of a running engine
+    // inputs: path - the prefix given to --shm-ring
+    //         spin - attempts before sleeping on a ring
+    // return: true if both rings are attached
+    bool attach(const std::string& path, const std::size_t spin);
+
+    // function to leave; the engine stops once every producer has left
+    void detach();
+
+    // function to write an event without waiting
+    // input:  record - the event
+    // return: true if it is written, false if the ring is full
+    bool try_send(const shm_event_record& record) {return events_.try_push(record);}
+
+    // function to write an event, waiting while the ring is full
+    // input:  record - the event
+    void send(const shm_event_record& record);
+
+    // function to read a flagged purchase
+    // inputs:  timeout_ms - the longest wait (0: do not wait)
+    // outputs: result - reference to the flagged purchase
+    // return:  true if one is read
+    bool read_result(shm_result_record& result, const uint32_t timeout_ms);
+
+    // function to obtain the number of events (of all producers) the engine processed
+    uint64_t processed() const {return events_.processed();}
+};
+
+#endif /* SHM_PRODUCER_H_ */
@@ -0,0 +1,63 @@
+/*
+ * shm_ring.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <climits>
+#include <ctime>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "shm_ring.h"
+
+using namespace std;
+
+// the futex words are shared between processes, so the private operations
+// (FUTEX_WAIT_PRIVATE) cannot be used
+void shm_futex_wait(atomic<uint32_t>* word, const uint32_t expected,
+    const uint32_t timeout_ms) {
+  struct timespec timeout;
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_nsec = (timeout_ms % 1000) * 1000000L;
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+      &timeout, nullptr, 0);
+}
+
+void shm_futex_wake(atomic<uint32_t>* word) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT_MAX,
+      nullptr, nullptr, 0);
+}
+
+void* shm_map_file(const string& path, const size_t bytes, const bool create, int& fd) {
+  fd = create ? open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)
+      : open(path.c_str(), O_RDWR | O_CLOEXEC);
+  if (fd < 0)
+    return nullptr;
+  if (create && ftruncate(fd, bytes) != 0) {
+    close(fd);
+    return nullptr;
+  }
+  // touching a mapped page past the end of a shorter file raises SIGBUS
+  struct stat st;
+  if (!create && (fstat(fd, &st) != 0 || static_cast<uint64_t>(st.st_size) < bytes)) {
+    close(fd);
+    return nullptr;
+  }
+  void* base = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (base == MAP_FAILED) {
+    close(fd);
+    return nullptr;
+  }
+  return base;
+}
+
+void shm_unmap_file(void* base, const size_t bytes, const int fd) {
+  munmap(base, bytes);
+  if (fd >= 0)
+    close(fd);
+}
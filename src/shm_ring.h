@@ -0,0 +1,311 @@
+/*
+ * shm_ring.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef SHM_RING_H_
+#define SHM_RING_H_
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <string>
+#include <new>
+
+// shm_event_record is a stream event as written by a producer
+struct shm_event_record {
+  // chosen by the producer and returned in the result of a flagged purchase
+  uint64_t tag;
+  // seconds since the epoch
+  uint64_t time;
+  uint64_t id1;
+  uint64_t id2;
+  double amount;
+  // 0: purchase, 1: befriend, 2: unfriend (the values of event_kind)
+  uint32_t kind;
+  uint32_t reserved;
+};
+
+// shm_result_record is a flagged purchase with the statistics of its network
+struct shm_result_record {
+  shm_event_record event;
+  double mean;
+  double standard_deviation;
+};
+
+// function to sleep until a futex word in shared memory changes
+// inputs: word - the word
+//         expected - the value the word had when the caller decided to sleep
+//         timeout_ms - the longest sleep in milliseconds
+void shm_futex_wait(std::atomic<uint32_t>* word, const uint32_t expected,
+    const uint32_t timeout_ms);
+
+// function to wake every process sleeping on a futex word in shared memory
+// input: word - the word
+void shm_futex_wake(std::atomic<uint32_t>* word);
+
+// function to map a ring file
+// inputs:  path - name of the file
+//          bytes - the size of the file
+//          create - true to create (or empty) the file, false to open an existing one
+// outputs: fd - reference to the descriptor of the file
+// return:  the mapping, or nullptr (also if an existing file is shorter than bytes)
+void* shm_map_file(const std::string& path, const std::size_t bytes, const bool create,
+    int& fd);
+
+// function to unmap a ring file and close it
+// inputs: base, bytes - the mapping
+//         fd - the descriptor
+void shm_unmap_file(void* base, const std::size_t bytes, const int fd);
+
+// shm_ring is a bounded queue of fixed-size records in a file mapped by
+// several processes (e.g. under /dev/shm): any number of producers and one
+// consumer. Every slot carries a sequence number: a producer claims the next
+// position with a compare-and-swap on the tail, writes the record and
+// publishes it by setting the slot's sequence; the consumer takes the slots
+// in order and hands them back for the next lap. A side that finds the ring
+// empty (or full) spins for a while and then sleeps on a futex word in the
+// ring, which the other side wakes only when a sleeper is registered.
+template <typename T>
+class shm_ring {
+  private:
+    struct header {
+      char magic[8];
+      uint64_t capacity;
+      uint64_t record_size;
+      // the next position to claim (producers) and to take (consumer),
+      // on separate cache lines
+      alignas(64) std::atomic<uint64_t> tail;
+      alignas(64) std::atomic<uint64_t> head;
+      // futex words, bumped when a record is published or a slot is freed
+      alignas(64) std::atomic<uint32_t> items_word;
+      std::atomic<uint32_t> consumer_sleeping;
+      std::atomic<uint32_t> space_word;
+      std::atomic<uint32_t> producers_sleeping;
+      // the producers attached now, and true once one has attached
+      std::atomic<uint32_t> producers;
+      std::atomic<uint32_t> had_producers;
+      // records processed by the consumer (not only taken)
+      alignas(64) std::atomic<uint64_t> processed;
+    };
+
+    struct slot {
+      std::atomic<uint64_t> sequence;
+      T record;
+    };
+
+    static constexpr char magic_[8] = {'A', 'D', 'R', 'I', 'N', 'G', '0', '1'};
+
+    header* header_ = nullptr;
+    slot* slots_ = nullptr;
+    uint64_t mask_ = 0;
+    std::size_t bytes_ = 0;
+    int fd_ = -1;
+
+    // counters of this process
+    std::size_t sleeps_ = 0;
+    std::size_t full_waits_ = 0;
+
+    static std::size_t file_bytes(const uint64_t capacity) {
+      return sizeof(header) + capacity * sizeof(slot);
+    }
+
+  public:
+    shm_ring() = default;
+    // destructor: unmaps the ring
+    ~shm_ring() {
+      if (header_ != nullptr)
+        shm_unmap_file(header_, bytes_, fd_);
+    }
+
+    shm_ring(const shm_ring&) = delete;
+    shm_ring& operator=(const shm_ring&) = delete;
+
+    // function to create an empty ring (an existing file is replaced)
+    // inputs: path - name of the file
+    //         capacity - minimum number of records; rounded up to a power of two
+    // return: true if the ring is created
+    bool create(const std::string& path, const uint64_t capacity) {
+      uint64_t size = 2;
+      while (size < capacity)
+        size <<= 1;
+      bytes_ = file_bytes(size);
+      void* base = shm_map_file(path, bytes_, true, fd_);
+      if (base == nullptr)
+        return false;
+      header_ = new (base) header();
+      header_->capacity = size;
+      header_->record_size = sizeof(T);
+      slots_ = reinterpret_cast<slot*>(header_ + 1);
+      for (uint64_t i = 0; i < size; ++i)
+        new (&slots_[i].sequence) std::atomic<uint64_t>(i);
+      mask_ = size - 1;
+      // the magic is written last, so a producer never attaches to a half-made ring
+      std::atomic_thread_fence(std::memory_order_release);
+      memcpy(header_->magic, magic_, sizeof(magic_));
+      return true;
+    }
+
+    // function to attach to a ring created by another process
+    // input:  path - name of the file
+    // return: true if the file is a ring of the same record type
+    bool attach(const std::string& path) {
+      void* base = shm_map_file(path, sizeof(header), false, fd_);
+      if (base == nullptr)
+        return false;
+      header* h = static_cast<header*>(base);
+      const bool valid = !memcmp(h->magic, magic_, sizeof(magic_))
+          && h->record_size == sizeof(T);
+      const uint64_t capacity = h->capacity;
+      shm_unmap_file(base, sizeof(header), fd_);
+      fd_ = -1;
+      // the capacity must be a power of two whose slots fit in the file (checked
+      // by shm_map_file)
+      if (!valid || capacity < 2 || (capacity & (capacity - 1)) != 0
+          || capacity > (SIZE_MAX - sizeof(header)) / sizeof(slot))
+        return false;
+      bytes_ = file_bytes(capacity);
+      base = shm_map_file(path, bytes_, false, fd_);
+      if (base == nullptr)
+        return false;
+      header_ = static_cast<header*>(base);
+      slots_ = reinterpret_cast<slot*>(header_ + 1);
+      mask_ = capacity - 1;
+      return true;
+    }
+
+    // function to add a record without waiting (any producer)
+    // input:  record - the record
+    // return: true if the record is added, false if the ring is full
+    bool try_push(const T& record) {
+      uint64_t position = header_->tail.load(std::memory_order_relaxed);
+      for (;;) {
+        slot& s = slots_[position & mask_];
+        const int64_t lag = static_cast<int64_t>(
+            s.sequence.load(std::memory_order_acquire) - position);
+        if (lag == 0) {
+          if (header_->tail.compare_exchange_weak(position, position + 1,
+              std::memory_order_relaxed))
+            break;
+        } else if (lag < 0) {
+          return false;
+        } else {
+          position = header_->tail.load(std::memory_order_relaxed);
+        }
+      }
+      slot& s = slots_[position & mask_];
+      s.record = record;
+      s.sequence.store(position + 1, std::memory_order_release);
+
+      // a sleeping consumer registered itself before checking the ring again
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (header_->consumer_sleeping.load(std::memory_order_relaxed)) {
+        header_->items_word.fetch_add(1, std::memory_order_release);
+        shm_futex_wake(&header_->items_word);
+      }
+      return true;
+    }
+
+    // function to add a record, waiting while the ring is full (any producer)
+    // inputs: record - the record
+    //         spin - the number of attempts before sleeping
+    //         timeout_ms - the longest sleep
+    // return: true if the record is added, false if no slot was freed within the timeout
+    bool push(const T& record, const std::size_t spin, const uint32_t timeout_ms) {
+      for (std::size_t i = 0; i < spin; ++i) {
+        if (try_push(record))
+          return true;
+      }
+      ++full_waits_;
+      header_->producers_sleeping.fetch_add(1, std::memory_order_seq_cst);
+      const uint32_t word = header_->space_word.load(std::memory_order_acquire);
+      bool pushed = try_push(record);
+      if (!pushed) {
+        shm_futex_wait(&header_->space_word, word, timeout_ms);
+        pushed = try_push(record);
+      }
+      header_->producers_sleeping.fetch_sub(1, std::memory_order_relaxed);
+      return pushed;
+    }
+
+    // function to take the oldest record without waiting (the consumer only)
+    // output: record - reference to the record
+    // return: true if a record is taken, false if the ring is empty
+    bool try_pop(T& record) {
+      const uint64_t position = header_->head.load(std::memory_order_relaxed);
+      slot& s = slots_[position & mask_];
+      if (s.sequence.load(std::memory_order_acquire) != position + 1)
+        return false;
+      record = s.record;
+      s.sequence.store(position + mask_ + 1, std::memory_order_release);
+      header_->head.store(position + 1, std::memory_order_relaxed);
+
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (header_->producers_sleeping.load(std::memory_order_relaxed) > 0) {
+        header_->space_word.fetch_add(1, std::memory_order_release);
+        shm_futex_wake(&header_->space_word);
+      }
+      return true;
+    }
+
+    // function to take the oldest record, waiting while the ring is empty
+    //          (the consumer only)
+    // inputs:  spin - the number of attempts before sleeping
+    //          timeout_ms - the longest sleep
+    // output:  record - reference to the record
+    // return:  true if a record is taken, false if none came within the timeout
+    bool pop(T& record, const std::size_t spin, const uint32_t timeout_ms) {
+      for (std::size_t i = 0; i < spin; ++i) {
+        if (try_pop(record))
+          return true;
+      }
+      ++sleeps_;
+      header_->consumer_sleeping.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      const uint32_t word = header_->items_word.load(std::memory_order_acquire);
+      bool taken = try_pop(record);
+      if (!taken) {
+        shm_futex_wait(&header_->items_word, word, timeout_ms);
+        taken = try_pop(record);
+      }
+      header_->consumer_sleeping.store(0, std::memory_order_relaxed);
+      return taken;
+    }
+
+    // function to count a producer in or out
+    void add_producer() {
+      header_->producers.fetch_add(1, std::memory_order_acq_rel);
+      header_->had_producers.store(1, std::memory_order_release);
+    }
+    void remove_producer() {
+      header_->producers.fetch_sub(1, std::memory_order_acq_rel);
+      // a consumer sleeping on an empty ring learns that the stream ended
+      header_->items_word.fetch_add(1, std::memory_order_release);
+      shm_futex_wake(&header_->items_word);
+    }
+
+    // function to check if every producer that attached has left
+    bool producers_gone() const {
+      return header_->had_producers.load(std::memory_order_acquire)
+          && header_->producers.load(std::memory_order_acquire) == 0;
+    }
+
+    // function to record that the consumer processed a record
+    void mark_processed() {
+      header_->processed.store(header_->processed.load(std::memory_order_relaxed) + 1,
+          std::memory_order_release);
+    }
+
+    uint64_t processed() const {return header_->processed.load(std::memory_order_acquire);}
+    uint64_t capacity() const {return mask_ + 1;}
+    std::size_t sleeps() const {return sleeps_;}
+    std::size_t full_waits() const {return full_waits_;}
+};
+
+template <typename T>
+constexpr char shm_ring<T>::magic_[8];
+
+#endif /* SHM_RING_H_ */
@@ -0,0 +1,186 @@
+/*
+ * spill_store.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <cstdio>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <limits>
+#include "spill_store.h"
+
+using namespace std;
+
+// header of a record: user id, the number of friends and the number of purchases,
+// followed by the friend ids and the purchases (time, order, amount), oldest first
+struct spill_record_header {
+  uint64_t user_id;
+  uint32_t n_friends;
+  uint32_t n_purchases;
+};
+
+// the bytes of a purchase in a record
+static const size_t purchase_bytes = sizeof(uint64_t) * 2 + sizeof(double);
+
+// function to append a value to a buffer
+template <typename T>
+static inline void append(vector<char>& buffer, const T& value) {
+  const size_t offset = buffer.size();
+  buffer.resize(offset + sizeof(T));
+  memcpy(buffer.data() + offset, &value, sizeof(T));
+}
+
+// function to read a value from a buffer
+template <typename T>
+static inline T extract(const char*& p) {
+  T value;
+  memcpy(&value, p, sizeof(T));
+  p += sizeof(T);
+  return value;
+}
+
+bool spill_store::open(const char* fname) {
+  fname_ = fname;
+  file_.open(fname, ios::in | ios::out | ios::binary | ios::trunc);
+  return file_.is_open();
+}
+
+bool spill_store::spill(const user_id_t user_id, const user_info& user) {
+  const friend_set& friends = user.get_friend_list();
+  const purchase_record& purchases = user.get_purchase_record();
+
+  buffer_.clear();
+  const spill_record_header header {user_id, static_cast<uint32_t>(friends.size()),
+      static_cast<uint32_t>(purchases.size())};
+  append(buffer_, header);
+  for (const user_id_t friend_id : friends)
+    append(buffer_, static_cast<uint64_t>(friend_id));
+  for (auto iter = purchases.rbegin(); iter != purchases.rend(); ++iter) {
+    append(buffer_, static_cast<uint64_t>(iter->tm_info.purchase_time));
+    append(buffer_, static_cast<uint64_t>(iter->tm_info.purchase_order));
+    append(buffer_, iter->amount);
+  }
+
+  // a user spilled again gets a new record; the old one was read back already
+  file_.seekp(file_bytes_);
+  file_.write(buffer_.data(), buffer_.size());
+  if (!file_) {
+    // the user stays in memory; the next record overwrites this one
+    file_.clear();
+    return false;
+  }
+  index_[user_id] = file_bytes_;
+  file_bytes_ += buffer_.size();
+  ++spilled_users_;
+  return true;
+}
+
+bool spill_store::fault_in(const user_id_t user_id, user_info& user) {
+  const auto iter_index = index_.find(user_id);
+  if (iter_index == index_.end())
+    return false;
+
+  const auto start_time = chrono::steady_clock::now();
+
+  // written records may still be in the stream buffer
+  file_.flush();
+  file_.seekg(iter_index->second);
+  spill_record_header header;
+  file_.read(reinterpret_cast<char*>(&header), sizeof(header));
+  const size_t body_bytes = header.n_friends * sizeof(uint64_t)
+      + header.n_purchases * purchase_bytes;
+  buffer_.resize(body_bytes);
+  file_.read(buffer_.data(), body_bytes);
+  if (!file_) {
+    file_.clear();
+    cerr << "Error: can not read user " << user_id << " from the spill file" << endl;
+    return false;
+  }
+
+  const char* p = buffer_.data();
+  for (uint32_t i = 0; i < header.n_friends; ++i)
+    user.add_friend(extract<uint64_t>(p));
+  for (uint32_t i = 0; i < header.n_purchases; ++i) {
+    const uint64_t purchase_time = extract<uint64_t>(p);
+    const uint64_t purchase_order = extract<uint64_t>(p);
+    const double amount = extract<double>(p);
+    user.update_purchases(purchase_time, purchase_order, amount,
+        numeric_limits<size_t>::max());
+  }
+
+  dead_bytes_ += sizeof(header) + body_bytes;
+  index_.erase(iter_index);
+  ++faulted_users_;
+
+  const double seconds = chrono::duration<double>(
+      chrono::steady_clock::now() - start_time).count();
+  fault_seconds_ += seconds;
+  if (seconds > max_fault_seconds_)
+    max_fault_seconds_ = seconds;
+  return true;
+}
+
+bool spill_store::compact() {
+  // the records are copied in file order
+  vector<pair<uint64_t, user_id_t>> records;
+  records.reserve(index_.size());
+  for (const auto& entry : index_)
+    records.emplace_back(entry.second, entry.first);
+  sort(records.begin(), records.end());
+
+  const string fname_new = fname_ + ".compact";
+  ofstream out(fname_new, ios::out | ios::binary | ios::trunc);
+  file_.flush();
+  vector<uint64_t> offsets;
+  offsets.reserve(records.size());
+  uint64_t new_bytes = 0;
+  for (const auto& record : records) {
+    file_.seekg(record.first);
+    spill_record_header header;
+    file_.read(reinterpret_cast<char*>(&header), sizeof(header));
+    const size_t body_bytes = header.n_friends * sizeof(uint64_t)
+        + header.n_purchases * purchase_bytes;
+    buffer_.resize(sizeof(header) + body_bytes);
+    memcpy(buffer_.data(), &header, sizeof(header));
+    file_.read(buffer_.data() + sizeof(header), body_bytes);
+    if (!file_ || !out.write(buffer_.data(), buffer_.size()))
+      break;
+    offsets.push_back(new_bytes);
+    new_bytes += buffer_.size();
+  }
+  out.close();
+  if (!file_ || offsets.size() != records.size() || out.fail()
+      || rename(fname_new.c_str(), fname_.c_str()) != 0) {
+    file_.clear();
+    remove(fname_new.c_str());
+    cerr << "Error: compacting the spill file " << fname_ << " failed" << endl;
+    return false;
+  }
+
+  // the old file is gone; continue with the new one
+  file_.close();
+  file_.open(fname_, ios::in | ios::out | ios::binary);
+  if (!file_.is_open()) {
+    cerr << "Error: the compacted spill file " << fname_ << " can not be opened" << endl;
+    return false;
+  }
+  for (size_t i = 0; i < records.size(); ++i)
+    index_[records[i].second] = offsets[i];
+  file_bytes_ = new_bytes;
+  dead_bytes_ = 0;
+  ++compactions_;
+  return true;
+}
+
+vector<user_id_t> spill_store::spilled_ids() const {
+  vector<user_id_t> ids;
+  ids.reserve(index_.size());
+  for (const auto& entry : index_)
+    ids.push_back(entry.first);
+  return ids;
+}
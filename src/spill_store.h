@@ -0,0 +1,83 @@
+/*
+ * spill_store.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef SPILL_STORE_H_
+#define SPILL_STORE_H_
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "user_info.h"
+
+// spill_store keeps evicted users in an append-only file. A user is written
+// as one record (id, friends, purchases) at the end of the file, and an
+// in-memory index maps the id to the record's position. Reading a user back
+// removes it from the index; its record stays in the file as dead bytes
+// until the live records are copied to a new file by compact().
+class spill_store {
+  private:
+    std::string fname_{};
+    std::fstream file_;
+    // position of the record of every user in the store
+    std::unordered_map<user_id_t, uint64_t> index_{};
+    // the length of the file
+    uint64_t file_bytes_ = 0;
+    // bytes of records that have been read back
+    uint64_t dead_bytes_ = 0;
+    // buffer holding a record while it is written or read
+    std::vector<char> buffer_{};
+
+    // counters
+    std::size_t spilled_users_ = 0;
+    std::size_t faulted_users_ = 0;
+    std::size_t compactions_ = 0;
+    double fault_seconds_ = 0.0;
+    double max_fault_seconds_ = 0.0;
+
+  public:
+    spill_store() = default;
+
+    // function to create the spill file (an existing file is truncated)
+    // input:  fname - name of the file
+    // return: true if the file is opened
+    bool open(const char* fname);
+
+    // function to check if a user is in the store
+    bool contains(const user_id_t user_id) const {return index_.count(user_id) > 0;}
+
+    // function to write a user to the store
+    // inputs: user_id - id of the user
+    //         user - the friends and purchases of the user
+    // return: true if the user is written (the user can be removed from memory)
+    bool spill(const user_id_t user_id, const user_info& user);
+
+    // function to read a user back and remove it from the store
+    // input:  user_id - id of the user
+    // output: user - reference to the user receiving the friends and purchases
+    // return: true if the user was in the store and is read
+    bool fault_in(const user_id_t user_id, user_info& user);
+
+    // function to copy the live records to a new file replacing the old one,
+    //          so the bytes of the records read back are given back
+    // return: true if the file is replaced (otherwise the old file is kept)
+    bool compact();
+
+    // function to obtain the ids of all users in the store
+    std::vector<user_id_t> spilled_ids() const;
+
+    std::size_t size() const {return index_.size();}
+    uint64_t file_bytes() const {return file_bytes_;}
+    uint64_t dead_bytes() const {return dead_bytes_;}
+    std::size_t spilled_users() const {return spilled_users_;}
+    std::size_t faulted_users() const {return faulted_users_;}
+    std::size_t compactions() const {return compactions_;}
+    double fault_seconds() const {return fault_seconds_;}
+    double max_fault_seconds() const {return max_fault_seconds_;}
+};
+
+#endif /* SPILL_STORE_H_ */
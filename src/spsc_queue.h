@@ -0,0 +1,71 @@
+/*
+ * spsc_queue.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef SPSC_QUEUE_H_
+#define SPSC_QUEUE_H_
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+// spsc_queue is a bounded lock-free queue for exactly one producer thread
+// and one consumer thread. The capacity is rounded up to a power of two.
+template <typename T>
+class spsc_queue {
+  private:
+    std::vector<T> buffer_;
+    std::size_t mask_;
+    // the indices are kept on separate cache lines, so the producer and
+    // the consumer do not invalidate each other's line on every operation
+    char pad_head_[64];
+    // index of the next element to pop (written by the consumer)
+    std::atomic<std::size_t> head_;
+    char pad_tail_[64];
+    // index of the next element to push (written by the producer)
+    std::atomic<std::size_t> tail_;
+    char pad_end_[64];
+
+  public:
+    // constructor
+    // input: capacity - minimum number of elements the queue can hold
+    explicit spsc_queue(const std::size_t capacity) : head_(0), tail_(0) {
+      std::size_t size = 2;
+      while (size < capacity)
+        size <<= 1;
+      buffer_.resize(size);
+      mask_ = size - 1;
+    }
+
+    spsc_queue(const spsc_queue&) = delete;
+    spsc_queue& operator=(const spsc_queue&) = delete;
+
+    // function to add an element (producer only)
+    // input:  value - the element
+    // return: true if the element is added, false if the queue is full
+    bool try_push(const T& value) {
+      const std::size_t tail = tail_.load(std::memory_order_relaxed);
+      if (tail - head_.load(std::memory_order_acquire) > mask_)
+        return false;
+      buffer_[tail & mask_] = value;
+      tail_.store(tail + 1, std::memory_order_release);
+      return true;
+    }
+
+    // function to remove the oldest element (consumer only)
+    // output: value - reference to the element
+    // return: true if an element is removed, false if the queue is empty
+    bool try_pop(T& value) {
+      const std::size_t head = head_.load(std::memory_order_relaxed);
+      if (head == tail_.load(std::memory_order_acquire))
+        return false;
+      value = buffer_[head & mask_];
+      head_.store(head + 1, std::memory_order_release);
+      return true;
+    }
+};
+
+#endif /* SPSC_QUEUE_H_ */
@@ -0,0 +1,194 @@
+/*
+ * stats_kernel.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <cstring>
+#include <initializer_list>
+#include "stats_kernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define STATS_KERNEL_X86 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+static void sum_amounts_scalar(const double* amounts, const size_t n,
+    const double shift, double& sum, double& sum2) {
+  sum_amounts_in_lanes(amounts, n, shift, sum, sum2);
+}
+
+#ifdef STATS_KERNEL_X86
+
+// The vector kernels keep the stats_lanes lanes in registers, W lanes per
+// register, and do the Kahan steps of add_to_lane in every lane:
+//   y = x - c;  t = s + y;  c = (t - s) - y;  s = t
+// The lanes are then stored and combined as in sum_amounts_in_lanes.
+
+// function to add the amounts after the full blocks and form the totals
+// inputs:  lanes, comp, lanes2, comp2 - the stored lanes
+//          filled - true if at least one block was added to the lanes
+//          tail, n_tail - amounts that did not fill a block
+//          shift - value subtracted from the tail amounts
+// outputs: sum, sum2 - references to the totals
+static inline void finish_sums(const double* lanes, const double* comp,
+    const double* lanes2, const double* comp2, const bool filled, const double* tail,
+    const size_t n_tail, const double shift, double& sum, double& sum2) {
+  double s = 0.0, c = 0.0, s2 = 0.0, c2 = 0.0;
+  if (filled)
+    combine_lanes(lanes, comp, lanes2, comp2, s, c, s2, c2);
+  for (size_t i = 0; i < n_tail; ++i) {
+    const double x = tail[i] - shift;
+    add_compensated(x, s, c);
+    add_compensated(x * x, s2, c2);
+  }
+  sum = s + c;
+  sum2 = s2 + c2;
+}
+
+__attribute__((target("sse2")))
+static void sum_amounts_sse2(const double* amounts, const size_t n,
+    const double shift, double& sum, double& sum2) {
+  static const size_t regs = stats_lanes / 2;
+  __m128d s[regs], c[regs], s2[regs], c2[regs];
+  for (size_t k = 0; k < regs; ++k)
+    s[k] = c[k] = s2[k] = c2[k] = _mm_setzero_pd();
+  const __m128d shift_v = _mm_set1_pd(shift);
+
+  size_t i = 0;
+  for (; i + stats_lanes <= n; i += stats_lanes) {
+    for (size_t k = 0; k < regs; ++k) {
+      const __m128d x = _mm_sub_pd(_mm_loadu_pd(amounts + i + k * 2), shift_v);
+      const __m128d y = _mm_sub_pd(x, c[k]);
+      const __m128d t = _mm_add_pd(s[k], y);
+      c[k] = _mm_sub_pd(_mm_sub_pd(t, s[k]), y);
+      s[k] = t;
+
+      const __m128d y2 = _mm_sub_pd(_mm_mul_pd(x, x), c2[k]);
+      const __m128d t2 = _mm_add_pd(s2[k], y2);
+      c2[k] = _mm_sub_pd(_mm_sub_pd(t2, s2[k]), y2);
+      s2[k] = t2;
+    }
+  }
+
+  double lanes[stats_lanes], comp[stats_lanes], lanes2[stats_lanes], comp2[stats_lanes];
+  for (size_t k = 0; k < regs; ++k) {
+    _mm_storeu_pd(lanes + k * 2, s[k]);
+    _mm_storeu_pd(comp + k * 2, c[k]);
+    _mm_storeu_pd(lanes2 + k * 2, s2[k]);
+    _mm_storeu_pd(comp2 + k * 2, c2[k]);
+  }
+  finish_sums(lanes, comp, lanes2, comp2, i > 0, amounts + i, n - i, shift, sum, sum2);
+}
+
+__attribute__((target("avx2")))
+static void sum_amounts_avx2(const double* amounts, const size_t n,
+    const double shift, double& sum, double& sum2) {
+  static const size_t regs = stats_lanes / 4;
+  __m256d s[regs], c[regs], s2[regs], c2[regs];
+  for (size_t k = 0; k < regs; ++k)
+    s[k] = c[k] = s2[k] = c2[k] = _mm256_setzero_pd();
+  const __m256d shift_v = _mm256_set1_pd(shift);
+
+  size_t i = 0;
+  for (; i + stats_lanes <= n; i += stats_lanes) {
+    for (size_t k = 0; k < regs; ++k) {
+      const __m256d x = _mm256_sub_pd(_mm256_loadu_pd(amounts + i + k * 4), shift_v);
+      const __m256d y = _mm256_sub_pd(x, c[k]);
+      const __m256d t = _mm256_add_pd(s[k], y);
+      c[k] = _mm256_sub_pd(_mm256_sub_pd(t, s[k]), y);
+      s[k] = t;
+
+      const __m256d y2 = _mm256_sub_pd(_mm256_mul_pd(x, x), c2[k]);
+      const __m256d t2 = _mm256_add_pd(s2[k], y2);
+      c2[k] = _mm256_sub_pd(_mm256_sub_pd(t2, s2[k]), y2);
+      s2[k] = t2;
+    }
+  }
+
+  double lanes[stats_lanes], comp[stats_lanes], lanes2[stats_lanes], comp2[stats_lanes];
+  for (size_t k = 0; k < regs; ++k) {
+    _mm256_storeu_pd(lanes + k * 4, s[k]);
+    _mm256_storeu_pd(comp + k * 4, c[k]);
+    _mm256_storeu_pd(lanes2 + k * 4, s2[k]);
+    _mm256_storeu_pd(comp2 + k * 4, c2[k]);
+  }
+  finish_sums(lanes, comp, lanes2, comp2, i > 0, amounts + i, n - i, shift, sum, sum2);
+}
+
+__attribute__((target("avx512f")))
+static void sum_amounts_avx512(const double* amounts, const size_t n,
+    const double shift, double& sum, double& sum2) {
+  static const size_t regs = stats_lanes / 8;
+  __m512d s[regs], c[regs], s2[regs], c2[regs];
+  for (size_t k = 0; k < regs; ++k)
+    s[k] = c[k] = s2[k] = c2[k] = _mm512_setzero_pd();
+  const __m512d shift_v = _mm512_set1_pd(shift);
+
+  size_t i = 0;
+  for (; i + stats_lanes <= n; i += stats_lanes) {
+    for (size_t k = 0; k < regs; ++k) {
+      const __m512d x = _mm512_sub_pd(_mm512_loadu_pd(amounts + i + k * 8), shift_v);
+      const __m512d y = _mm512_sub_pd(x, c[k]);
+      const __m512d t = _mm512_add_pd(s[k], y);
+      c[k] = _mm512_sub_pd(_mm512_sub_pd(t, s[k]), y);
+      s[k] = t;
+
+      const __m512d y2 = _mm512_sub_pd(_mm512_mul_pd(x, x), c2[k]);
+      const __m512d t2 = _mm512_add_pd(s2[k], y2);
+      c2[k] = _mm512_sub_pd(_mm512_sub_pd(t2, s2[k]), y2);
+      s2[k] = t2;
+    }
+  }
+
+  double lanes[stats_lanes], comp[stats_lanes], lanes2[stats_lanes], comp2[stats_lanes];
+  for (size_t k = 0; k < regs; ++k) {
+    _mm512_storeu_pd(lanes + k * 8, s[k]);
+    _mm512_storeu_pd(comp + k * 8, c[k]);
+    _mm512_storeu_pd(lanes2 + k * 8, s2[k]);
+    _mm512_storeu_pd(comp2 + k * 8, c2[k]);
+  }
+  finish_sums(lanes, comp, lanes2, comp2, i > 0, amounts + i, n - i, shift, sum, sum2);
+}
+
+#endif /* STATS_KERNEL_X86 */
+
+sum_kernel_t find_sum_kernel(const char* name) {
+#ifdef STATS_KERNEL_X86
+  __builtin_cpu_init();
+  if (!strcmp(name, "avx512"))
+    return __builtin_cpu_supports("avx512f") ? sum_amounts_avx512 : nullptr;
+  if (!strcmp(name, "avx2"))
+    return __builtin_cpu_supports("avx2") ? sum_amounts_avx2 : nullptr;
+  if (!strcmp(name, "sse2"))
+    return __builtin_cpu_supports("sse2") ? sum_amounts_sse2 : nullptr;
+#endif
+  if (!strcmp(name, "scalar"))
+    return sum_amounts_scalar;
+  return nullptr;
+}
+
+// function to select the widest variant supported by the CPU
+// return: name of the variant
+static const char* select_sum_kernel() {
+  for (const char* name : {"avx512", "avx2", "sse2"}) {
+    if (find_sum_kernel(name) != nullptr)
+      return name;
+  }
+  return "scalar";
+}
+
+const char* sum_kernel_name() {
+  // selected at the first call
+  static const char* const selected_name = select_sum_kernel();
+  return selected_name;
+}
+
+void sum_amounts(const double* amounts, const size_t n, const double shift,
+    double& sum, double& sum2) {
+  static const sum_kernel_t selected_kernel = find_sum_kernel(sum_kernel_name());
+  selected_kernel(amounts, n, shift, sum, sum2);
+}
@@ -0,0 +1,159 @@
+/*
+ * stats_kernel.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef STATS_KERNEL_H_
+#define STATS_KERNEL_H_
+
+#include <cstddef>
+#include <vector>
+#include "running_stats.h"
+
+// The sums of a network's purchase amounts are kept in stats_lanes lanes:
+// the amount i of every full block of stats_lanes amounts is added to lane
+// i % stats_lanes with compensated (Kahan) summation, then the lanes and the
+// remaining amounts are added in order. The scalar loop over the purchase
+// records and every vector kernel do exactly these operations, so they give
+// the same sums to the last bit, and the printed mean and standard deviation
+// do not depend on the path taken.
+static const std::size_t stats_lanes = 16;
+
+// networks with at least this many purchases copy the amounts into an array
+// for the vector kernel; for smaller ones the copy costs more than it saves
+// (measured with bench/bench_stats_kernel)
+static const std::size_t vector_kernel_min_length = 500;
+
+// signature of a kernel computing the sum and the sum of squares of amounts
+typedef void (*sum_kernel_t)(const double* amounts, const std::size_t n,
+    const double shift, double& sum, double& sum2);
+
+// function to obtain the amount of a purchase record or of an array element
+template <typename Record>
+inline double amount_of(const Record& record) {return record.amount;}
+inline double amount_of(const double amount) {return amount;}
+
+// function to add a value to the compensated sum of a lane (Kahan)
+// inputs:  value - the value to add
+// outputs: sum - reference to the sum of the lane
+//          compensation - reference to the rounding error of the lane
+inline void add_to_lane(const double value, double& sum, double& compensation) {
+  const double y = value - compensation;
+  const double t = sum + y;
+  compensation = (t - sum) - y;
+  sum = t;
+}
+
+// function to add a value to a compensated total (Neumaier's variant of Kahan)
+// inputs:  value - the value to add
+// outputs: sum - reference to the total
+//          compensation - reference to the accumulated rounding error
+inline void add_compensated(const double value, double& sum, double& compensation) {
+  const double t = sum + value;
+  if ((sum >= 0 ? sum : -sum) >= (value >= 0 ? value : -value))
+    compensation += (sum - t) + value;
+  else
+    compensation += (value - t) + sum;
+  sum = t;
+}
+
+// function to add the lanes to the totals, lane by lane (lanes that were
+//          never filled hold zeros and leave the totals unchanged, so they
+//          are not combined)
+// inputs:  lanes, comp, lanes2, comp2 - sums and compensations of the lanes
+// outputs: s, c, s2, c2 - references to the totals and their compensations
+inline void combine_lanes(const double* lanes, const double* comp, const double* lanes2,
+    const double* comp2, double& s, double& c, double& s2, double& c2) {
+  for (std::size_t k = 0; k < stats_lanes; ++k) {
+    add_compensated(lanes[k], s, c);
+    add_compensated(-comp[k], s, c);
+    add_compensated(lanes2[k], s2, c2);
+    add_compensated(-comp2[k], s2, c2);
+  }
+}
+
+// function to compute the sums of the amounts of a range of purchases in
+//          lanes, one record at a time (the scalar path of the kernels)
+// inputs:  first - the first record (a purchase or an amount)
+//          n - the number of records
+//          shift - value subtracted from every amount
+// outputs: sum - reference to the sum of (amount - shift)
+//          sum2 - reference to the sum of (amount - shift)^2
+template <typename Iterator>
+void sum_amounts_in_lanes(Iterator first, const std::size_t n, const double shift,
+    double& sum, double& sum2) {
+  double lanes[stats_lanes] = {}, comp[stats_lanes] = {};
+  double lanes2[stats_lanes] = {}, comp2[stats_lanes] = {};
+  std::size_t i = 0;
+  for (; i + stats_lanes <= n; i += stats_lanes) {
+    for (std::size_t k = 0; k < stats_lanes; ++k, ++first) {
+      const double x = amount_of(*first) - shift;
+      add_to_lane(x, lanes[k], comp[k]);
+      add_to_lane(x * x, lanes2[k], comp2[k]);
+    }
+  }
+
+  double s = 0.0, c = 0.0, s2 = 0.0, c2 = 0.0;
+  if (i > 0)
+    combine_lanes(lanes, comp, lanes2, comp2, s, c, s2, c2);
+  for (; i < n; ++i, ++first) {
+    const double x = amount_of(*first) - shift;
+    add_compensated(x, s, c);
+    add_compensated(x * x, s2, c2);
+  }
+  sum = s + c;
+  sum2 = s2 + c2;
+}
+
+// function to compute the sum and the sum of squares of purchase amounts
+//          minus a shift with the widest vector kernel the CPU supports
+//          (AVX-512, AVX2, SSE2 or scalar), selected when it is first called.
+//          The sums are those of sum_amounts_in_lanes.
+// inputs:  amounts - contiguous array of purchase amounts
+//          n - the number of amounts
+//          shift - value subtracted from every amount
+// outputs: sum - reference to the sum of (amount - shift)
+//          sum2 - reference to the sum of (amount - shift)^2
+void sum_amounts(const double* amounts, const std::size_t n, const double shift,
+    double& sum, double& sum2);
+
+// function to compute the statistics of the amounts of a range of purchases,
+//          shifting them by the first amount, so the variance keeps its
+//          digits when the amounts are large. Long ranges are copied into
+//          amounts and summed by sum_amounts, short ones by the scalar loop.
+// inputs:  first, last - the range of purchases (records with an amount member)
+//          amounts - buffer for the amounts of a long range
+// return:  the statistics of the amounts
+template <typename Iterator>
+running_stats compute_stats(Iterator first, const Iterator last,
+    std::vector<double>& amounts) {
+  running_stats stats;
+  if (first == last)
+    return stats;
+  const double shift = first->amount;
+  const std::size_t n = last - first;
+  double sum = 0.0, sum2 = 0.0;
+  if (n < vector_kernel_min_length) {
+    sum_amounts_in_lanes(first, n, shift, sum, sum2);
+  } else {
+    amounts.resize(n);
+    for (std::size_t i = 0; i < n; ++i, ++first)
+      amounts[i] = first->amount;
+    sum_amounts(amounts.data(), n, shift, sum, sum2);
+  }
+  stats.assign(n, shift, sum, sum2);
+  return stats;
+}
+
+// function to obtain the name of the variant used by sum_amounts
+// return: "avx512", "avx2", "sse2" or "scalar"
+const char* sum_kernel_name();
+
+// function to obtain a specific variant of the kernel (used for benchmarks)
+// input:  name - "avx512", "avx2", "sse2" or "scalar"
+// return: the kernel, nullptr if the variant is unknown or not supported by the CPU
+sum_kernel_t find_sum_kernel(const char* name);
+
+#endif /* STATS_KERNEL_H_ */
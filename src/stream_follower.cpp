@@ -0,0 +1,200 @@
+/*
+ * stream_follower.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/inotify.h>
+#include <sys/signalfd.h>
+#include "stream_follower.h"
+
+using namespace std;
+
+// the bytes read from the file at a time
+static const size_t read_bytes = 1 << 16;
+
+stream_follower::~stream_follower() {
+  for (const int fd : {fd_, inotify_fd_, signal_fd_}) {
+    if (fd >= 0)
+      close(fd);
+  }
+}
+
+bool stream_follower::open(const string& fname, const uint64_t offset,
+    const double idle_seconds) {
+  fname_ = fname;
+  const size_t slash = fname.rfind('/');
+  basename_ = slash == string::npos ? fname : fname.substr(slash + 1);
+  const string dir = slash == string::npos ? "." : fname.substr(0, slash + 1);
+  idle_timeout_ = chrono::duration_cast<chrono::steady_clock::duration>(
+      chrono::duration<double>(idle_seconds));
+
+  // the stop signals stay pending until the signalfd is read; threads
+  // started later inherit the mask, so none of them is interrupted either
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  if (sigprocmask(SIG_BLOCK, &signals, nullptr) != 0)
+    return false;
+  signal_fd_ = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (signal_fd_ < 0)
+    return false;
+
+  // the directory is watched, so a file created under the name after a
+  // rotation is noticed as well
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0 || inotify_add_watch(inotify_fd_, dir.c_str(),
+      IN_MODIFY | IN_CREATE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE) < 0)
+    return false;
+
+  last_data_time_ = chrono::steady_clock::now();
+  return open_file(offset);
+}
+
+bool stream_follower::open_file(const uint64_t offset) {
+  fd_ = ::open(fname_.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd_ < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || lseek(fd_, offset, SEEK_SET) < 0) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  device_ = st.st_dev;
+  inode_ = st.st_ino;
+  offset_ = offset;
+  buffer_.clear();
+  position_ = 0;
+  return true;
+}
+
+bool stream_follower::check_rotation() {
+  struct stat st_fd;
+  if (fd_ >= 0) {
+    if (fstat(fd_, &st_fd) != 0)
+      return false;
+    const off_t position = lseek(fd_, 0, SEEK_CUR);
+
+    // truncated in place (e.g. copytruncate): read it again from the start
+    if (st_fd.st_size < position) {
+      dropped_bytes_ += buffer_.size() - position_;
+      lseek(fd_, 0, SEEK_SET);
+      offset_ = 0;
+      buffer_.clear();
+      position_ = 0;
+      ++truncations_;
+      return true;
+    }
+    // appended to since the end was read
+    if (st_fd.st_size > position)
+      return true;
+  }
+
+  // the name refers to a new file once the old one is renamed or removed
+  struct stat st;
+  if (stat(fname_.c_str(), &st) != 0
+      || (fd_ >= 0 && st.st_dev == device_ && st.st_ino == inode_))
+    return false;
+
+  // the old file is drained; a line it left incomplete is never finished
+  dropped_bytes_ += buffer_.size() - position_;
+  if (fd_ >= 0)
+    close(fd_);
+  ++rotations_;
+  return open_file(0);
+}
+
+bool stream_follower::read_line(string& line) {
+  for (;;) {
+    const size_t newline = buffer_.find('\n', position_);
+    if (newline != string::npos) {
+      line.assign(buffer_, position_, newline - position_);
+      offset_ += newline - position_ + 1;
+      position_ = newline + 1;
+      ++lines_;
+      return true;
+    }
+
+    // keep the partial line and append the next bytes of the file
+    if (fd_ < 0)
+      return check_rotation() && read_line(line);
+    buffer_.erase(0, position_);
+    position_ = 0;
+    const size_t size = buffer_.size();
+    buffer_.resize(size + read_bytes);
+    ssize_t n_read;
+    do {
+      n_read = read(fd_, &buffer_[size], read_bytes);
+    } while (n_read < 0 && errno == EINTR);
+    buffer_.resize(size + (n_read > 0 ? n_read : 0));
+
+    if (n_read > 0) {
+      bytes_ += n_read;
+      read_time_ = last_data_time_ = chrono::steady_clock::now();
+    } else if (!check_rotation()) {
+      return false;
+    }
+  }
+}
+
+bool stream_follower::wait() {
+  char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  while (!stopped_) {
+    int timeout_ms = -1;
+    if (idle_timeout_.count() > 0) {
+      const auto remaining = last_data_time_ + idle_timeout_ - chrono::steady_clock::now();
+      if (remaining.count() <= 0)
+        break;
+      timeout_ms = chrono::duration_cast<chrono::milliseconds>(remaining).count() + 1;
+    }
+
+    struct pollfd fds[2] = {{inotify_fd_, POLLIN, 0}, {signal_fd_, POLLIN, 0}};
+    const int ready = poll(fds, 2, timeout_ms);
+    if (ready < 0 && errno != EINTR)
+      break;
+    if (ready <= 0)
+      continue;
+    if (fds[1].revents & POLLIN) {
+      struct signalfd_siginfo info;
+      if (read(signal_fd_, &info, sizeof(info)) == sizeof(info))
+        break;
+    }
+
+    // only the events of the followed name end the wait
+    bool relevant = false;
+    ssize_t n_read;
+    while ((n_read = read(inotify_fd_, events, sizeof(events))) > 0) {
+      for (const char* p = events; p < events + n_read;) {
+        const struct inotify_event* e = reinterpret_cast<const struct inotify_event*>(p);
+        if (e->len > 0 && basename_ == e->name)
+          relevant = true;
+        p += sizeof(struct inotify_event) + e->len;
+      }
+    }
+    if (relevant) {
+      ++wakeups_;
+      return true;
+    }
+  }
+  stopped_ = true;
+  return false;
+}
+
+void stream_follower::print_stats(ostream& out) const {
+  out << "followed lines: " << lines_ << "\n"
+      << "followed bytes: " << bytes_ << "\n"
+      << "follow wakeups: " << wakeups_ << "\n"
+      << "rotations: " << rotations_ << ", truncations: " << truncations_ << "\n"
+      << "dropped partial line bytes: " << dropped_bytes_ << "\n";
+}
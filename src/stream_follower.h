@@ -0,0 +1,102 @@
+/*
+ * stream_follower.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef STREAM_FOLLOWER_H_
+#define STREAM_FOLLOWER_H_
+
+#include <cstdint>
+#include <string>
+#include <chrono>
+#include <iosfwd>
+#include <sys/types.h>
+
+// stream_follower reads the complete lines of a file that keeps being
+// appended to, like tail -F. At the end of the file it sleeps on inotify
+// events of the file's directory (no polling), so it wakes up when the file
+// is written, replaced (log rotation: renamed away and created again) or
+// truncated. A trailing line without its newline is held until it is
+// completed. SIGINT and SIGTERM are received through a signalfd, so they end
+// the wait instead of the process.
+class stream_follower {
+  private:
+    std::string fname_{};
+    // the name of the file within its directory, matched against inotify events
+    std::string basename_{};
+    int fd_ = -1;
+    int inotify_fd_ = -1;
+    int signal_fd_ = -1;
+    // inode of the open file, to notice that the name refers to a new file
+    dev_t device_ = 0;
+    ino_t inode_ = 0;
+    // bytes read and not yet returned as lines, starting at position_
+    std::string buffer_{};
+    std::size_t position_ = 0;
+    // byte offset of the next line in the current file
+    uint64_t offset_ = 0;
+    // time of the read() that returned the end of the last line
+    std::chrono::steady_clock::time_point read_time_{};
+    // stop after the file has not grown for this long (0: never)
+    std::chrono::steady_clock::duration idle_timeout_{};
+    std::chrono::steady_clock::time_point last_data_time_{};
+    bool stopped_ = false;
+
+    // counters
+    std::size_t lines_ = 0;
+    uint64_t bytes_ = 0;
+    std::size_t wakeups_ = 0;
+    std::size_t rotations_ = 0;
+    std::size_t truncations_ = 0;
+    uint64_t dropped_bytes_ = 0;
+
+    // function to open the file and move to an offset
+    // input:  offset - byte offset to read from
+    // return: true if the file is opened
+    bool open_file(const uint64_t offset);
+
+    // function to check if the name now refers to another file or the file
+    //          was truncated, and start reading it from the beginning
+    // return:  true if the file was switched
+    bool check_rotation();
+
+  public:
+    stream_follower() = default;
+    // destructor: closes the file and the descriptors
+    ~stream_follower();
+
+    stream_follower(const stream_follower&) = delete;
+    stream_follower& operator=(const stream_follower&) = delete;
+
+    // function to start following a file; SIGINT and SIGTERM are blocked, so
+    //          call it before any thread is started
+    // inputs: fname - name of the file
+    //         offset - byte offset of the first line to read
+    //         idle_seconds - stop once the file has not grown for this long
+    //                        (0: follow until SIGINT or SIGTERM)
+    // return: true if the file and the watches are opened
+    bool open(const std::string& fname, const uint64_t offset, const double idle_seconds);
+
+    // function to obtain the next complete line without waiting
+    // output: line - reference to the line (without the newline)
+    // return: true if a line is returned, false if none is complete yet
+    bool read_line(std::string& line);
+
+    // function to sleep until the file is written, rotated or truncated
+    // return: false when following ends (a stop signal or the idle timeout)
+    bool wait();
+
+    // function to obtain the byte offset of the next line in the current file
+    uint64_t offset() const {return offset_;}
+
+    // function to obtain the time when the last line returned was read
+    std::chrono::steady_clock::time_point read_time() const {return read_time_;}
+
+    // function to write the counters of the follower to a stream
+    // input: out - output stream
+    void print_stats(std::ostream& out) const;
+};
+
+#endif /* STREAM_FOLLOWER_H_ */
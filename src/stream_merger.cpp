@@ -0,0 +1,228 @@
+/*
+ * stream_merger.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <functional>
+#include <chrono>
+#include "stream_merger.h"
+#include "event_scanner.h"
+#include "decompressor.h"
+
+using namespace std;
+using namespace rapidjson;
+
+// the lines parsed into a batch, and the batches an input's thread may hold
+// before the merge takes them
+static const size_t batch_lines = 1024;
+static const size_t max_batches = 4;
+
+stream_merger::~stream_merger() {
+  close();
+}
+
+bool stream_merger::open(const vector<const char*>& fnames, const bool use_scanner,
+    const bool trusted_input) {
+  close();
+  inputs_.clear();
+  heads_.clear();
+  started_ = false;
+  use_scanner_ = use_scanner;
+  trusted_input_ = trusted_input;
+  for (const char* fname : fnames) {
+    unique_ptr<input> in(new input());
+    in->fname = fname;
+    const compression_format compression = detect_compression(fname);
+    if (compression != compression_format::none) {
+      unique_ptr<decompressing_istream> stream(new decompressing_istream());
+      if (!stream->open(fname, compression))
+        return false;
+      in->stream = std::move(stream);
+    } else {
+      unique_ptr<ifstream> stream(new ifstream(fname));
+      if (stream->fail())
+        return false;
+      in->stream = std::move(stream);
+    }
+    inputs_.push_back(std::move(in));
+  }
+  // the threads are started once every input is opened
+  for (auto& in : inputs_)
+    in->thread = thread(&stream_merger::read_input, this, std::ref(*in));
+  return true;
+}
+
+void stream_merger::close() {
+  for (auto& in : inputs_) {
+    if (!in->thread.joinable())
+      continue;
+    {
+      lock_guard<mutex> lock(in->mutex);
+      in->stopping = true;
+    }
+    in->emptied.notify_all();
+    in->thread.join();
+  }
+}
+
+void stream_merger::read_input(input& in) {
+  const auto start = chrono::steady_clock::now();
+  line_batch batch;
+  ostringstream err;
+  size_t D, T;
+  bool stopped = false;
+
+  // function to hand the batch to the merge and take an empty one, waiting
+  // while the merge holds enough
+  auto push_batch = [&] {
+    unique_lock<mutex> lock(in.mutex);
+    if (in.full_batches.size() >= max_batches && !in.stopping) {
+      const auto wait_start = chrono::steady_clock::now();
+      in.emptied.wait(lock, [&in] {return in.full_batches.size() < max_batches
+          || in.stopping;});
+      in.reader_wait_seconds += chrono::duration<double>(
+          chrono::steady_clock::now() - wait_start).count();
+    }
+    stopped = in.stopping;
+    in.full_batches.push_back(std::move(batch));
+    batch = line_batch();
+    if (!in.free_batches.empty()) {
+      batch = std::move(in.free_batches.back());
+      in.free_batches.pop_back();
+    }
+    lock.unlock();
+    in.filled.notify_one();
+    batch.count = 0;
+  };
+
+  while (!stopped) {
+    if (batch.count == batch.lines.size())
+      batch.lines.resize(batch_lines);
+    parsed_line& p = batch.lines[batch.count];
+    string& line = p.e.line;
+    if (!getline(*in.stream, line))
+      break;
+    ++in.lines;
+    if (line.empty())
+      continue;
+    ++batch.count;
+
+    // the same checks as process_stream_line, with the messages kept for the merge
+    p.errors.clear();
+    p.is_event = false;
+    if (use_scanner_ && scan_event_line(line, p.e, D, T, trusted_input_) == scan_result::event) {
+      p.is_event = true;
+    } else {
+      Document doc;
+      doc.Parse(line.c_str());
+      if (!doc.IsObject()) {
+        p.errors = "Error: doc is not object\n";
+        p.error = input_error::not_object;
+      } else if (!doc.HasMember("event_type")) {
+        p.errors = "Error: event_type is present in this line\n";
+        p.error = input_error::missing_event_type;
+      } else if (!read_event(doc, p.e, err, p.error)) {
+        p.errors = err.str();
+        err.str("");
+      } else {
+        p.is_event = true;
+      }
+    }
+    in.events += p.is_event;
+    if (batch.count == batch_lines)
+      push_batch();
+  }
+  if (batch.count > 0 && !stopped)
+    push_batch();
+
+  lock_guard<mutex> lock(in.mutex);
+  in.parse_seconds = chrono::duration<double>(
+      chrono::steady_clock::now() - start).count() - in.reader_wait_seconds;
+  in.finished = true;
+  in.filled.notify_one();
+}
+
+bool stream_merger::advance(const size_t k) {
+  input& in = *inputs_[k];
+  for (;;) {
+    for (; in.position < in.batch.count; ++in.position) {
+      const parsed_line& p = in.batch.lines[in.position];
+      if (p.is_event)
+        return true;
+      if (errors_ != nullptr)
+        errors_->reject(p.error, p.errors, p.e.line);
+      else
+        cerr << p.errors << flush;
+    }
+
+    // give the merged batch back and take the next one, if there is one
+    unique_lock<mutex> lock(in.mutex);
+    if (in.batch.count > 0) {
+      in.free_batches.push_back(std::move(in.batch));
+      in.batch = line_batch();
+    }
+    if (in.full_batches.empty() && !in.finished) {
+      const auto start = chrono::steady_clock::now();
+      in.filled.wait(lock, [&in] {return !in.full_batches.empty() || in.finished;});
+      in.merger_wait_seconds += chrono::duration<double>(
+          chrono::steady_clock::now() - start).count();
+    }
+    in.position = 0;
+    if (in.full_batches.empty())
+      return false;
+    in.batch = std::move(in.full_batches.front());
+    in.full_batches.pop_front();
+    lock.unlock();
+    in.emptied.notify_one();
+  }
+}
+
+bool stream_merger::next(event& e) {
+  // the heap puts the earliest time, then the lowest input, on top
+  typedef greater<pair<uint64_t, size_t>> later;
+  if (!started_) {
+    for (size_t k = 0; k < inputs_.size(); ++k) {
+      if (advance(k))
+        heads_.emplace_back(inputs_[k]->batch.lines[inputs_[k]->position].e.time, k);
+    }
+    make_heap(heads_.begin(), heads_.end(), later());
+    started_ = true;
+  }
+  if (heads_.empty())
+    return false;
+
+  pop_heap(heads_.begin(), heads_.end(), later());
+  const size_t k = heads_.back().second;
+  heads_.pop_back();
+  input& in = *inputs_[k];
+  swap(e, in.batch.lines[in.position].e);
+  ++in.position;
+  if (advance(k)) {
+    heads_.emplace_back(in.batch.lines[in.position].e.time, k);
+    push_heap(heads_.begin(), heads_.end(), later());
+  }
+
+  ++merged_events_;
+  input_switches_ += last_input_ != SIZE_MAX && k != last_input_;
+  last_input_ = k;
+  return true;
+}
+
+void stream_merger::print_stats(ostream& out) {
+  close();
+  for (size_t k = 0; k < inputs_.size(); ++k) {
+    const input& in = *inputs_[k];
+    out << "stream input " << k + 1 << " (" << in.fname << "): lines " << in.lines
+        << ", events " << in.events << ", reading seconds " << in.parse_seconds
+        << " (waiting for the merge " << in.reader_wait_seconds
+        << ", merge waiting for it " << in.merger_wait_seconds << ")\n";
+  }
+  out << "merged events: " << merged_events_ << " (input switches " << input_switches_
+      << ")\n";
+}
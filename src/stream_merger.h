@@ -0,0 +1,132 @@
+/*
+ * stream_merger.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef STREAM_MERGER_H_
+#define STREAM_MERGER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <iosfwd>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "event.h"
+#include "error_reporter.h"
+
+// stream_merger reads several stream logs at once and hands out their events
+// as one feed ordered by time. Every input has a thread that reads it ahead
+// (decompressing a gzip or zstd log) and parses its lines into batches, so
+// the inputs are read and parsed in parallel. The feed is a k-way merge of
+// the inputs: the earliest event of the inputs' next events comes first, and
+// events of the same second come in the order of the inputs on the command
+// line, then of their lines. Within one input the order of the lines is
+// kept, so an input that is not in time order is merged as it is. A line that
+// is not a valid event is reported when the feed reaches it (to an
+// error_reporter if one is set, otherwise on cerr), so the messages come in
+// the same order on every run.
+class stream_merger {
+  private:
+    // a line of an input after parsing: an event or the errors it caused
+    struct parsed_line {
+      bool is_event = false;
+      event e;
+      std::string errors;
+      input_error error = input_error::not_object;
+    };
+
+    // the lines parsed at a time; a batch is handed back once merged, so its
+    // events keep their strings' buffers for the next lines
+    struct line_batch {
+      std::vector<parsed_line> lines;
+      std::size_t count = 0;
+    };
+
+    // an input, its reading thread and the batches it has parsed
+    struct input {
+      std::string fname;
+      std::unique_ptr<std::istream> stream;
+      std::thread thread;
+      std::mutex mutex;
+      std::condition_variable filled;
+      std::condition_variable emptied;
+      std::deque<line_batch> full_batches;
+      std::vector<line_batch> free_batches;
+      bool finished = false;
+      bool stopping = false;
+      // the batch being merged and the position of its next line
+      line_batch batch;
+      std::size_t position = 0;
+      // counters; those of the thread are read after it is joined
+      uint64_t lines = 0;
+      uint64_t events = 0;
+      double parse_seconds = 0.0;
+      double reader_wait_seconds = 0.0;
+      double merger_wait_seconds = 0.0;
+    };
+
+    std::vector<std::unique_ptr<input>> inputs_{};
+    bool use_scanner_ = true;
+    bool trusted_input_ = false;
+    // the inputs whose next event is known, by its time and the input's index
+    std::vector<std::pair<uint64_t, std::size_t>> heads_{};
+    bool started_ = false;
+    uint64_t merged_events_ = 0;
+    // the events taken from an input other than the previous one's
+    uint64_t input_switches_ = 0;
+    std::size_t last_input_ = SIZE_MAX;
+    // counters and sampled messages of the lines that are not events
+    // (nullptr: every message is written to cerr)
+    error_reporter* errors_ = nullptr;
+
+    // function run by the thread of an input: read and parse its lines
+    void read_input(input& in);
+
+    // function to move to the next event of an input, reporting the lines
+    //          that are not events on the way
+    // input:  k - the index of the input
+    // return: true if the input has another event
+    bool advance(const std::size_t k);
+
+  public:
+    stream_merger() = default;
+    // destructor: stops the threads
+    ~stream_merger();
+
+    stream_merger(const stream_merger&) = delete;
+    stream_merger& operator=(const stream_merger&) = delete;
+
+    // function to open the inputs and start reading them
+    // inputs: fnames - names of the stream logs, in the order of the tie-break
+    //         use_scanner - true to read the lines with the event scanner when they allow
+    //         trusted_input - true to read the lines in the trusted layout first
+    // return: true if every input is opened
+    bool open(const std::vector<const char*>& fnames, const bool use_scanner,
+        const bool trusted_input);
+
+    // function to report the lines that are not events to an error_reporter
+    // input: errors - the reporter, nullptr to write every message to cerr
+    void set_error_reporter(error_reporter* errors) {errors_ = errors;}
+
+    // function to obtain the next event of the feed
+    // output: e - reference to the event, with its line (its previous
+    //             contents are taken to reuse their buffers)
+    // return: false once every input is exhausted
+    bool next(event& e);
+
+    // function to stop the threads and close the inputs
+    void close();
+
+    // function to write the counters of the inputs and of the merge to a stream
+    // input: out - output stream
+    void print_stats(std::ostream& out);
+};
+
+#endif /* STREAM_MERGER_H_ */
@@ -0,0 +1,95 @@
+/*
+ * test_shm_ring.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ *
+ * checks that a producer attaches to a ring file made by create() and refuses
+ * a file that is truncated, shorter than its capacity field says, or has a
+ * capacity that is not a power of two, without leaking a descriptor
+ */
+
+#include <iostream>
+#include <string>
+#include <cstdint>
+#include <cstdlib>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include "../shm_ring.h"
+
+using namespace std;
+
+// the capacity field follows the 8-byte magic in the ring header
+static const off_t capacity_offset = 8;
+
+// function to count the open descriptors of the process
+static int open_descriptors() {
+  int n = 0;
+  DIR* dir = opendir("/proc/self/fd");
+  if (dir == nullptr)
+    return -1;
+  while (readdir(dir) != nullptr)
+    ++n;
+  closedir(dir);
+  return n;
+}
+
+// function to create a ring file of 1024 records
+static bool create_ring(const string& path) {
+  shm_ring<shm_event_record> ring;
+  return ring.create(path, 1024);
+}
+
+// function to attach to a ring file
+static bool attach_ring(const string& path) {
+  shm_ring<shm_event_record> ring;
+  return ring.attach(path);
+}
+
+// function to overwrite the capacity field of a ring file
+static bool write_capacity(const string& path, const uint64_t capacity) {
+  const int fd = open(path.c_str(), O_WRONLY);
+  if (fd < 0)
+    return false;
+  const bool written = pwrite(fd, &capacity, sizeof(capacity), capacity_offset)
+      == static_cast<ssize_t>(sizeof(capacity));
+  close(fd);
+  return written;
+}
+
+// function to report a check
+static bool check(const char* what, const bool passed) {
+  cout << (passed ? "PASS" : "FAIL") << ": " << what << "\n";
+  return passed;
+}
+
+int main() {
+  const char* dir = getenv("TMPDIR");
+  const string path = string(dir != nullptr ? dir : "/tmp") + "/test_shm_ring."
+      + to_string(getpid());
+  bool passed = true;
+
+  const int descriptors = open_descriptors();
+  passed &= check("a new ring can be attached", create_ring(path) && attach_ring(path));
+
+  passed &= check("a truncated ring is refused",
+      create_ring(path) && truncate(path.c_str(), 4096) == 0 && !attach_ring(path));
+
+  passed &= check("a ring shorter than its header is refused",
+      create_ring(path) && truncate(path.c_str(), 16) == 0 && !attach_ring(path));
+
+  passed &= check("a ring shorter than its capacity field says is refused",
+      create_ring(path) && write_capacity(path, 1 << 20) && !attach_ring(path));
+
+  passed &= check("a capacity that is not a power of two is refused",
+      create_ring(path) && write_capacity(path, 1000) && !attach_ring(path));
+
+  passed &= check("an overflowing capacity is refused",
+      create_ring(path) && write_capacity(path, UINT64_C(1) << 62) && !attach_ring(path));
+
+  passed &= check("no descriptor is left open", open_descriptors() == descriptors);
+
+  unlink(path.c_str());
+  return passed ? EXIT_SUCCESS : EXIT_FAILURE;
+}
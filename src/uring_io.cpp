@@ -0,0 +1,517 @@
+/*
+ * uring_io.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+#include "uring_io.h"
+
+using namespace std;
+
+// the buffers of a reader or a writer: each is a request in flight
+static const size_t n_buffers = 4;
+static const size_t buffer_size = 1 << 20;
+// the writes in flight at most (a flush writes a part of a buffer)
+static const unsigned max_writes = 16;
+
+uring::~uring() {
+  close();
+}
+
+bool uring::open(const unsigned entries) {
+  close();
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (fd_ < 0)
+    return false;
+  entries_ = params.sq_entries;
+
+  // the rings are mapped from the instance; recent kernels map both at once
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (single_mmap) {
+    sq_ring_size_ = max(sq_ring_size_, cq_ring_size_);
+    cq_ring_size_ = 0;
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    close();
+    return false;
+  }
+  cq_ring_ = single_mmap ? sq_ring_ : mmap(nullptr, cq_ring_size_,
+      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+  if (cq_ring_ == MAP_FAILED) {
+    cq_ring_ = nullptr;
+    close();
+    return false;
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    close();
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  char* sq = static_cast<char*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  char* cq = static_cast<char*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  unsubmitted_ = 0;
+  registered_ = false;
+  return true;
+}
+
+void uring::close() {
+  if (sqes_ != nullptr)
+    munmap(sqes_, sqes_size_);
+  if (cq_ring_ != nullptr && cq_ring_ != sq_ring_)
+    munmap(cq_ring_, cq_ring_size_);
+  if (sq_ring_ != nullptr)
+    munmap(sq_ring_, sq_ring_size_);
+  sqes_ = nullptr;
+  sq_ring_ = cq_ring_ = nullptr;
+  if (fd_ >= 0)
+    ::close(fd_);
+  fd_ = -1;
+}
+
+bool uring::register_buffers(vector<vector<char>>& buffers) {
+  vector<iovec> iovecs(buffers.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    iovecs[i].iov_base = buffers[i].data();
+    iovecs[i].iov_len = buffers[i].size();
+  }
+  registered_ = syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS,
+      iovecs.data(), static_cast<unsigned>(iovecs.size())) == 0;
+  return registered_;
+}
+
+bool uring::queue(const bool write, const int fd, const unsigned buffer, char* data,
+    const size_t length, const uint64_t offset, const uint64_t tag) {
+  // the kernel advances the head as it consumes the entries
+  const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+  const unsigned tail = *sq_tail_;
+  if (tail - head >= entries_)
+    return false;
+  const unsigned index = tail & *sq_mask_;
+  io_uring_sqe* sqe = &sqes_[index];
+  memset(sqe, 0, sizeof(*sqe));
+  if (registered_) {
+    sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+    sqe->buf_index = static_cast<uint16_t>(buffer);
+  } else {
+    sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+  }
+  sqe->fd = fd;
+  sqe->addr = reinterpret_cast<uint64_t>(data);
+  sqe->len = static_cast<uint32_t>(length);
+  sqe->off = offset;
+  sqe->user_data = tag;
+  sq_array_[index] = index;
+  __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+  ++unsubmitted_;
+  return true;
+}
+
+bool uring::submit(const bool wait) {
+  if (unsubmitted_ == 0 && !wait)
+    return true;
+  for (;;) {
+    const long submitted = syscall(__NR_io_uring_enter, fd_, unsubmitted_, wait ? 1 : 0,
+        wait ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+    if (submitted >= 0) {
+      unsubmitted_ -= min<unsigned>(unsubmitted_, static_cast<unsigned>(submitted));
+      return true;
+    }
+    if (errno != EINTR)
+      return false;
+  }
+}
+
+bool uring::complete(uint64_t& tag, int& result) {
+  const unsigned head = *cq_head_;
+  if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE))
+    return false;
+  const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+  tag = cqe.user_data;
+  result = cqe.res;
+  __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+bool uring_available() {
+  static const bool available = [] {
+    uring ring;
+    return ring.open(2);
+  }();
+  return available;
+}
+
+uring_istream::uring_istream() : istream(nullptr), buffer_(*this) {
+  rdbuf(&buffer_);
+}
+
+uring_istream::~uring_istream() {
+  close();
+}
+
+bool uring_istream::open(const string& fname, const uint64_t offset) {
+  close();
+  fd_ = ::open(fname.c_str(), O_RDONLY);
+  if (fd_ < 0)
+    return false;
+  struct stat st;
+  if (fstat(fd_, &st) != 0 || !ring_.open(2 * n_buffers)) {
+    close();
+    return false;
+  }
+  size_ = st.st_size;
+  next_offset_ = min<uint64_t>(offset, size_);
+  buffers_.assign(n_buffers, vector<char>(buffer_size));
+  ring_.register_buffers(buffers_);
+  reads_.assign(n_buffers, pending_read());
+  first_read_ = n_reads_ = 0;
+  current_buffer_ = -1;
+  failed_ = false;
+  bytes_ = submitted_reads_ = short_reads_ = 0;
+  wait_seconds_ = 0.0;
+  clear();
+
+  // every buffer is read ahead from the start
+  for (unsigned b = 0; b < n_buffers; ++b)
+    submit_read(b);
+  ring_.submit(false);
+  return true;
+}
+
+void uring_istream::close() {
+  if (fd_ < 0)
+    return;
+  // the kernel may still be writing into the buffers
+  uint64_t tag;
+  int result;
+  while (n_reads_ > 0) {
+    while (ring_.complete(tag, result)) {
+      for (size_t i = 0; i < n_reads_; ++i) {
+        pending_read& r = reads_[(first_read_ + i) % n_buffers];
+        if (r.buffer == tag && !r.done)
+          r.done = true;
+      }
+    }
+    if (reads_[first_read_].done) {
+      first_read_ = (first_read_ + 1) % n_buffers;
+      --n_reads_;
+    } else if (!ring_.submit(true)) {
+      break;
+    }
+  }
+  ring_.close();
+  ::close(fd_);
+  fd_ = -1;
+}
+
+void uring_istream::submit_read(const unsigned buffer) {
+  if (next_offset_ >= size_)
+    return;
+  const size_t length = static_cast<size_t>(min<uint64_t>(buffer_size, size_ - next_offset_));
+  pending_read& r = reads_[(first_read_ + n_reads_) % n_buffers];
+  r.buffer = buffer;
+  r.offset = next_offset_;
+  r.length = length;
+  r.done = false;
+  r.result = 0;
+  if (!ring_.queue(false, fd_, buffer, buffers_[buffer].data(), length, next_offset_, buffer))
+    return;
+  ++n_reads_;
+  next_offset_ += length;
+  ++submitted_reads_;
+}
+
+bool uring_istream::next_buffer() {
+  // the buffer the stream has finished is read again further on
+  if (current_buffer_ >= 0) {
+    submit_read(current_buffer_);
+    current_buffer_ = -1;
+    ring_.submit(false);
+  }
+  if (n_reads_ == 0 || failed_)
+    return false;
+
+  // the reads complete in any order; the stream takes them in file order
+  pending_read& next = reads_[first_read_];
+  while (!next.done) {
+    uint64_t tag;
+    int result;
+    while (ring_.complete(tag, result)) {
+      for (size_t i = 0; i < n_reads_; ++i) {
+        pending_read& r = reads_[(first_read_ + i) % n_buffers];
+        if (r.buffer == tag && !r.done) {
+          r.done = true;
+          r.result = result;
+        }
+      }
+    }
+    if (next.done)
+      break;
+    const auto start = chrono::steady_clock::now();
+    if (!ring_.submit(true)) {
+      failed_ = true;
+      cerr << "Error: io_uring_enter failed: " << strerror(errno) << endl;
+      return false;
+    }
+    wait_seconds_ += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  }
+  first_read_ = (first_read_ + 1) % n_buffers;
+  --n_reads_;
+  current_buffer_ = next.buffer;
+
+  if (next.result < 0) {
+    failed_ = true;
+    cerr << "Error: reading failed: " << strerror(-next.result) << endl;
+    return false;
+  }
+  // a short read is completed synchronously, so the buffers stay contiguous
+  size_t length = next.result;
+  char* data = buffers_[next.buffer].data();
+  if (length < next.length) {
+    ++short_reads_;
+    while (length < next.length) {
+      const ssize_t n = pread(fd_, data + length, next.length - length, next.offset + length);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        break;
+      length += n;
+    }
+  }
+  bytes_ += length;
+  buffer_.set_area(data, length);
+  return length > 0;
+}
+
+uring_istream::read_buffer::int_type uring_istream::read_buffer::underflow() {
+  if (gptr() < egptr())
+    return traits_type::to_int_type(*gptr());
+  if (!owner_.next_buffer()) {
+    setg(nullptr, nullptr, nullptr);
+    return traits_type::eof();
+  }
+  return traits_type::to_int_type(*gptr());
+}
+
+void uring_istream::print_stats(ostream& out, const char* name) const {
+  out << name << " io_uring reads: " << submitted_reads_ << " (short " << short_reads_
+      << "), bytes: " << bytes_ << ", waiting seconds: " << wait_seconds_ << "\n";
+}
+
+uring_ostream::uring_ostream() : ostream(nullptr), buffer_(*this) {
+  rdbuf(&buffer_);
+}
+
+uring_ostream::~uring_ostream() {
+  close();
+}
+
+bool uring_ostream::open(const string& fname, const bool append) {
+  close();
+  fd_ = ::open(fname.c_str(), O_WRONLY | O_CREAT | (append ? 0 : O_TRUNC), 0644);
+  if (fd_ >= 0 && !ring_.open(max_writes)) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+  // the stream fails as an ofstream does
+  if (fd_ < 0) {
+    setstate(ios::failbit);
+    return false;
+  }
+  buffers_.assign(n_buffers, vector<char>(buffer_size));
+  ring_.register_buffers(buffers_);
+  free_buffers_.clear();
+  for (unsigned b = n_buffers; b > 0; --b)
+    free_buffers_.push_back(b - 1);
+  buffer_writes_.assign(n_buffers, 0);
+  writes_.assign(max_writes, pending_write());
+  free_writes_.clear();
+  for (unsigned w = max_writes; w > 0; --w)
+    free_writes_.push_back(w - 1);
+  current_buffer_ = -1;
+  failed_ = false;
+  bytes_ = submitted_writes_ = 0;
+  wait_seconds_ = 0.0;
+  clear();
+  offset_ = append ? lseek(fd_, 0, SEEK_END) : 0;
+  take_buffer();
+  return true;
+}
+
+void uring_ostream::seek_end() {
+  if (fd_ < 0)
+    return;
+  drain();
+  offset_ = lseek(fd_, 0, SEEK_END);
+}
+
+void uring_ostream::close() {
+  if (fd_ < 0)
+    return;
+  if (!drain())
+    setstate(ios::badbit);
+  buffer_.set_area(nullptr, 0);
+  current_buffer_ = -1;
+  ring_.close();
+  ::close(fd_);
+  fd_ = -1;
+}
+
+bool uring_ostream::write_unwritten() {
+  if (current_buffer_ < 0)
+    return true;
+  char* end = buffer_.filled_end();
+  if (end == unwritten_)
+    return true;
+  while (free_writes_.empty()) {
+    if (!reap_writes(true))
+      return false;
+  }
+  const unsigned w = free_writes_.back();
+  free_writes_.pop_back();
+  pending_write& write = writes_[w];
+  write.buffer = current_buffer_;
+  write.data = unwritten_;
+  write.length = end - unwritten_;
+  write.offset = offset_;
+  // there is an entry in the ring for every write
+  ring_.queue(true, fd_, write.buffer, write.data, write.length, write.offset, w);
+  ++buffer_writes_[write.buffer];
+  offset_ += write.length;
+  bytes_ += write.length;
+  ++submitted_writes_;
+  unwritten_ = end;
+  return ring_.submit(false);
+}
+
+void uring_ostream::complete_write(const unsigned tag, const int result) {
+  pending_write& write = writes_[tag];
+  if (result < 0) {
+    failed_ = true;
+    cerr << "Error: writing failed: " << strerror(-result) << endl;
+  } else {
+    // a short write is completed synchronously
+    size_t written = result;
+    while (written < write.length && !failed_) {
+      const ssize_t n = pwrite(fd_, write.data + written, write.length - written,
+          write.offset + written);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0) {
+        failed_ = true;
+        cerr << "Error: writing failed: " << strerror(errno) << endl;
+      } else {
+        written += n;
+      }
+    }
+  }
+  free_writes_.push_back(tag);
+  if (--buffer_writes_[write.buffer] == 0
+      && static_cast<int>(write.buffer) != current_buffer_)
+    free_buffers_.push_back(write.buffer);
+}
+
+bool uring_ostream::reap_writes(const bool wait) {
+  uint64_t tag;
+  int result;
+  bool reaped = false;
+  for (;;) {
+    while (ring_.complete(tag, result)) {
+      complete_write(static_cast<unsigned>(tag), result);
+      reaped = true;
+    }
+    if (reaped || !wait)
+      return true;
+    const auto start = chrono::steady_clock::now();
+    if (!ring_.submit(true)) {
+      failed_ = true;
+      cerr << "Error: io_uring_enter failed: " << strerror(errno) << endl;
+      return false;
+    }
+    wait_seconds_ += chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  }
+}
+
+bool uring_ostream::take_buffer() {
+  // the filled buffer is freed once its writes complete
+  if (current_buffer_ >= 0) {
+    const unsigned b = current_buffer_;
+    current_buffer_ = -1;
+    if (buffer_writes_[b] == 0)
+      free_buffers_.push_back(b);
+  }
+  buffer_.set_area(nullptr, 0);
+  while (free_buffers_.empty()) {
+    if (!reap_writes(true))
+      return false;
+  }
+  current_buffer_ = free_buffers_.back();
+  free_buffers_.pop_back();
+  unwritten_ = buffers_[current_buffer_].data();
+  buffer_.set_area(unwritten_, buffer_size);
+  return !failed_;
+}
+
+bool uring_ostream::drain() {
+  bool ok = write_unwritten();
+  while (ok && free_writes_.size() < max_writes)
+    ok = reap_writes(true);
+  return ok && !failed_;
+}
+
+uring_ostream::write_buffer::int_type uring_ostream::write_buffer::overflow(int_type c) {
+  if (!owner_.write_unwritten() || !owner_.take_buffer())
+    return traits_type::eof();
+  if (!traits_type::eq_int_type(c, traits_type::eof()))
+    return sputc(traits_type::to_char_type(c));
+  return traits_type::not_eof(c);
+}
+
+int uring_ostream::write_buffer::sync() {
+  if (owner_.flush_waits_)
+    return owner_.drain() ? 0 : -1;
+  // the completed writes are collected without waiting; while a write is still
+  // in flight the flushed bytes are left to the next write, so that a flush on
+  // every line does not become a write on every line
+  if (!owner_.reap_writes(false))
+    return -1;
+  if (owner_.free_writes_.size() == max_writes && !owner_.write_unwritten())
+    return -1;
+  return owner_.failed_ ? -1 : 0;
+}
+
+void uring_ostream::print_stats(ostream& out, const char* name) const {
+  out << name << " io_uring writes: " << submitted_writes_ << ", bytes: " << bytes_
+      << ", waiting seconds: " << wait_seconds_ << "\n";
+}
@@ -0,0 +1,282 @@
+/*
+ * uring_io.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef URING_IO_H_
+#define URING_IO_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+// uring is a minimal io_uring instance set up with the raw system calls
+// (there is no liburing here): a submission and a completion ring shared
+// with the kernel, and buffers registered once so that the reads and
+// writes of fixed buffers skip mapping them on every request.
+class uring {
+  private:
+    int fd_ = -1;
+    unsigned entries_ = 0;
+    // the mapped rings
+    void* sq_ring_ = nullptr;
+    void* cq_ring_ = nullptr;
+    std::size_t sq_ring_size_ = 0;
+    std::size_t cq_ring_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    std::size_t sqes_size_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_mask_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned* cq_mask_ = nullptr;
+    io_uring_cqe* cqes_ = nullptr;
+    // requests queued in the submission ring but not yet submitted
+    unsigned unsubmitted_ = 0;
+    bool registered_ = false;
+
+  public:
+    uring() = default;
+    ~uring();
+
+    uring(const uring&) = delete;
+    uring& operator=(const uring&) = delete;
+
+    // function to set up the rings
+    // input:  entries - the number of requests the submission ring holds
+    // return: true if io_uring is available
+    bool open(const unsigned entries);
+
+    // function to tear down the rings
+    void close();
+
+    // function to register buffers for the fixed reads and writes
+    // input:  buffers - the buffers (their addresses must not change)
+    // return: true if they are registered (pinned memory may be refused)
+    bool register_buffers(std::vector<std::vector<char>>& buffers);
+
+    // function to queue a read or a write of a buffer at an offset of a file;
+    //          a registered buffer is read or written as a fixed buffer
+    // inputs: write - true for a write
+    //         fd - the file
+    //         buffer - index of the buffer in the registered ones
+    //         data, length - the bytes of the buffer to read or write
+    //         offset - the offset in the file
+    //         tag - returned with the completion
+    // return: false if the submission ring is full
+    bool queue(const bool write, const int fd, const unsigned buffer, char* data,
+        const std::size_t length, const uint64_t offset, const uint64_t tag);
+
+    // function to submit the queued requests, waiting for a completion if asked
+    // input:  wait - true to wait for at least one completion
+    // return: false on an error of io_uring_enter
+    bool submit(const bool wait);
+
+    // function to take a completion
+    // outputs: tag - reference to the tag of the request
+    //          result - reference to its result (bytes, or -errno)
+    // return:  false if no completion is ready
+    bool complete(uint64_t& tag, int& result);
+};
+
+// function to check once if io_uring can be set up in this process
+// return: true if it can (the kernel supports it and it is not disabled)
+bool uring_available();
+
+// uring_istream reads a file through io_uring: it keeps a few large reads of
+// registered buffers in flight at consecutive offsets ahead of the reader,
+// and hands each buffer to the stream once its read completes, so the
+// reader parses one buffer while the kernel fills the next ones.
+class uring_istream : public std::istream {
+  private:
+    class read_buffer : public std::streambuf {
+      private:
+        uring_istream& owner_;
+
+      protected:
+        int_type underflow() override;
+
+      public:
+        explicit read_buffer(uring_istream& owner) : owner_(owner) {}
+        void set_area(char* data, const std::size_t length) {setg(data, data, data + length);}
+    };
+
+    read_buffer buffer_;
+    uring ring_{};
+    int fd_ = -1;
+    uint64_t size_ = 0;
+    // the offset of the next read to submit
+    uint64_t next_offset_ = 0;
+    std::vector<std::vector<char>> buffers_{};
+    // the reads in flight, in the order of their offsets: the buffer,
+    // its offset and length, and its result once it completes
+    struct pending_read {
+      unsigned buffer;
+      uint64_t offset;
+      std::size_t length;
+      bool done;
+      int result;
+    };
+    std::vector<pending_read> reads_{};
+    std::size_t first_read_ = 0;
+    std::size_t n_reads_ = 0;
+    // the buffer handed to the stream, returned when the next one is taken
+    int current_buffer_ = -1;
+    bool failed_ = false;
+
+    // counters
+    uint64_t bytes_ = 0;
+    uint64_t submitted_reads_ = 0;
+    uint64_t short_reads_ = 0;
+    double wait_seconds_ = 0.0;
+
+    // function to submit a read of a free buffer at the next offset
+    // input: buffer - the buffer
+    void submit_read(const unsigned buffer);
+
+    // function to take the next buffer in order, waiting for its read
+    // return: false at the end of the file or on an error
+    bool next_buffer();
+
+  public:
+    uring_istream();
+    ~uring_istream();
+
+    uring_istream(const uring_istream&) = delete;
+    uring_istream& operator=(const uring_istream&) = delete;
+
+    // function to open a file and start reading it
+    // inputs: fname - name of the file
+    //         offset - the offset to start reading from
+    // return: true if the file is opened and io_uring is set up
+    bool open(const std::string& fname, const uint64_t offset);
+
+    // function to stop the reads and close the file
+    void close();
+
+    // function to write the counters to a stream
+    // inputs: out - output stream
+    //         name - the name of the file in the messages
+    void print_stats(std::ostream& out, const char* name) const;
+};
+
+// uring_ostream writes a file through io_uring: the output is gathered in
+// large registered buffers, and the bytes of a buffer are written at their
+// offset by asynchronous writes, one when the buffer is full and one at every
+// flush, while the stream goes on filling the buffer (or the next one). A
+// flush hands the bytes to the kernel without waiting for the write, unless
+// the flushes are made to wait (for checkpoints that record the length of
+// the output); closing the stream waits for every write.
+class uring_ostream : public std::ostream {
+  private:
+    class write_buffer : public std::streambuf {
+      private:
+        uring_ostream& owner_;
+
+      protected:
+        int_type overflow(int_type c) override;
+        int sync() override;
+
+      public:
+        explicit write_buffer(uring_ostream& owner) : owner_(owner) {}
+        void set_area(char* data, const std::size_t length) {setp(data, data + length);}
+        char* filled_end() const {return pptr();}
+    };
+
+    // a write in flight: a range of a buffer and its offset in the file
+    struct pending_write {
+      unsigned buffer;
+      char* data;
+      std::size_t length;
+      uint64_t offset;
+    };
+
+    write_buffer buffer_;
+    uring ring_{};
+    int fd_ = -1;
+    // the offset in the file of the next byte to write
+    uint64_t offset_ = 0;
+    std::vector<std::vector<char>> buffers_{};
+    std::vector<unsigned> free_buffers_{};
+    // the writes in flight of every buffer
+    std::vector<std::size_t> buffer_writes_{};
+    // the buffer being filled, and its first byte not yet written
+    int current_buffer_ = -1;
+    char* unwritten_ = nullptr;
+    // the writes in flight, by tag
+    std::vector<pending_write> writes_{};
+    std::vector<unsigned> free_writes_{};
+    bool flush_waits_ = false;
+    bool failed_ = false;
+
+    // counters
+    uint64_t bytes_ = 0;
+    uint64_t submitted_writes_ = 0;
+    double wait_seconds_ = 0.0;
+
+    // function to write the bytes of the current buffer not yet written
+    // return: false on an error
+    bool write_unwritten();
+
+    // function to handle a completed write, freeing its buffer if it is
+    //          not filled any more and has no other write in flight
+    // inputs: tag - the tag of the write
+    //         result - its result
+    void complete_write(const unsigned tag, const int result);
+
+    // function to handle the completed writes, waiting for one if asked
+    // input:  wait - true to wait for at least one
+    // return: false on an error of io_uring_enter
+    bool reap_writes(const bool wait);
+
+    // function to start filling a free buffer, waiting for one if needed
+    // return: false on an error
+    bool take_buffer();
+
+    // function to write the rest and wait for every write
+    // return: false on an error
+    bool drain();
+
+  public:
+    uring_ostream();
+    ~uring_ostream();
+
+    uring_ostream(const uring_ostream&) = delete;
+    uring_ostream& operator=(const uring_ostream&) = delete;
+
+    // function to open a file for writing
+    // inputs: fname - name of the file
+    //         append - true to keep the contents and write at the end
+    // return: true if the file is opened and io_uring is set up (otherwise
+    //         the stream fails)
+    bool open(const std::string& fname, const bool append);
+
+    // function to make a flush wait until its bytes are written
+    // input: flush_waits - true to wait
+    void set_flush_waits(const bool flush_waits) {flush_waits_ = flush_waits;}
+
+    // function to continue writing at the current end of the file (after it
+    //          is truncated)
+    void seek_end();
+
+    // function to write the rest, wait for the writes and close the file
+    void close();
+
+    // function to write the counters to a stream
+    // inputs: out - output stream
+    //         name - the name of the file in the messages
+    void print_stats(std::ostream& out, const char* name) const;
+};
+
+#endif /* URING_IO_H_ */
@@ -0,0 +1,77 @@
+/*
+ * user_backend.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef USER_BACKEND_H_
+#define USER_BACKEND_H_
+
+#include <iosfwd>
+#include <vector>
+#include <unordered_set>
+#include "user_info.h"
+#include "memory_usage.h"
+
+// user_backend holds the users outside of network's user table, e.g. in
+// worker-thread shards or in memory-mapped files. Once network hands its users
+// to a backend, every stream update is sent to the backend, and the networks
+// and recent purchases of users are obtained from it.
+class user_backend {
+  public:
+    virtual ~user_backend() = default;
+
+    // function to add a purchase to a user
+    // inputs: user_id - the buyer
+    //         purchase - the purchase information
+    //         limit - the number of recent purchases kept per user
+    //         cutoff_time - purchases made before this time may be removed (0 keeps all)
+    virtual void add_purchase(const user_id_t user_id, const purchase_info& purchase,
+        const std::size_t limit, const uint64_t cutoff_time) = 0;
+
+    // function to add or remove a friendship between two different users
+    // inputs: id1, id2 - ids of the two users
+    //         befriend - true to add the friendship, false to remove it
+    virtual void change_friendship(const user_id_t id1, const user_id_t id2,
+        const bool befriend) = 0;
+
+    // function to obtain ids of all friends in a user's social network
+    // inputs: user_id - a user id
+    //         D - degree of separation
+    // return: friend ids of the user within D degree of separation
+    virtual std::unordered_set<user_id_t> get_friends_network(const user_id_t user_id,
+        const std::size_t D) = 0;
+
+    // function to obtain the recent purchases in a user's network
+    // inputs: friends_in_network - friend ids of a user within D degree of separation
+    //         cutoff_time - purchases made before this time are skipped (0 keeps all)
+    //         limit - the number of recent purchases to return
+    // return: the most recent purchases (most recent first)
+    virtual std::vector<purchase_info> friend_purchases(
+        const std::unordered_set<user_id_t>& friends_in_network,
+        const uint64_t cutoff_time, const std::size_t limit) = 0;
+
+    // function to estimate the memory used by the users
+    // output: usage - reference to the estimate the users are added to
+    virtual void add_memory_usage(memory_usage& usage) = 0;
+
+    // function to release the purchases of users whose last purchase was made
+    //          before a time
+    // inputs:  cutoff_time - users with no purchase at or after this time are inactive
+    // outputs: released_users, released_purchases - references to the numbers of
+    //          users and purchases released
+    virtual void release_inactive_purchases(const uint64_t cutoff_time,
+        std::size_t& released_users, std::size_t& released_purchases) = 0;
+
+    // function to obtain the bytes in blocks handed out by the backend's own
+    //          arenas (0 if it keeps no users in an arena); safe to call while
+    //          the backend's threads run
+    virtual std::size_t arena_bytes() const {return 0;}
+
+    // function to write counters of the backend to a stream
+    // input: out - output stream
+    virtual void print_stats(std::ostream& out) const = 0;
+};
+
+#endif /* USER_BACKEND_H_ */
@@ -9,53 +9,140 @@
 #include <iomanip>
 #include <sstream>
 #include <algorithm>
+#include <cstdio>
 #include "user_info.h"
 
-// function to convert a time in string type to uint64_t type
-uint64_t convert_string2timet(std::string timestamp) {
-  auto end = std::remove_if(timestamp.begin(), timestamp.end(), [] (const char c) {
-    return ! std::isdigit(c);
-  });
-  timestamp.resize(end - timestamp.begin());
-  uint64_t time = std::stol(timestamp);
-  return time;
+// function to count the days from 1970-01-01 to a date in the proleptic Gregorian calendar
+// inputs: year, month (1-12), day (1-31)
+// return: the number of days, negative for earlier dates
+static int64_t days_from_civil(int64_t year, const unsigned month, const unsigned day) {
+  year -= month <= 2;
+  const int64_t era = (year >= 0 ? year : year - 399) / 400;
+  const unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+  const unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+  const unsigned day_of_era = year_of_era * 365 + year_of_era / 4
+      - year_of_era / 100 + day_of_year;
+  return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+}
+
+uint64_t convert_string2timet(const std::string& timestamp) {
+  // collect the numeric fields of "YYYY-MM-DD hh:mm:ss"
+  int64_t fields[6] = {1970, 1, 1, 0, 0, 0};
+  std::size_t n_fields = 0;
+  bool in_number = false;
+  for (const char c : timestamp) {
+    if (std::isdigit(static_cast<unsigned char>(c))) {
+      if (!in_number) {
+        if (n_fields == 6)
+          break;
+        fields[n_fields++] = 0;
+        in_number = true;
+      }
+      fields[n_fields - 1] = fields[n_fields - 1] * 10 + (c - '0');
+    } else {
+      in_number = false;
+    }
+  }
+
+  const int64_t days = days_from_civil(fields[0],
+      static_cast<unsigned>(fields[1]), static_cast<unsigned>(fields[2]));
+  const int64_t seconds = days * 86400 + fields[3] * 3600 + fields[4] * 60 + fields[5];
+  return seconds > 0 ? static_cast<uint64_t>(seconds) : 0;
 }
 
-void user_info::update_purchases(const std::string& timestamp,
+// function to find the date of a day counted from 1970-01-01 (the inverse of days_from_civil)
+// input:   days - the number of days
+// outputs: year, month (1-12), day (1-31) - references to the date
+static void civil_from_days(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+  days += 719468;
+  const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+  const unsigned day_of_era = static_cast<unsigned>(days - era * 146097);
+  const unsigned year_of_era = (day_of_era - day_of_era / 1460 + day_of_era / 36524
+      - day_of_era / 146096) / 365;
+  const unsigned day_of_year = day_of_era - (365 * year_of_era + year_of_era / 4
+      - year_of_era / 100);
+  const unsigned month_index = (5 * day_of_year + 2) / 153;
+  day = day_of_year - (153 * month_index + 2) / 5 + 1;
+  month = month_index < 10 ? month_index + 3 : month_index - 9;
+  year = static_cast<int64_t>(year_of_era) + era * 400 + (month <= 2);
+}
+
+std::string convert_timet2string(const uint64_t time) {
+  int64_t year;
+  unsigned month, day;
+  civil_from_days(static_cast<int64_t>(time / 86400), year, month, day);
+  const unsigned seconds = static_cast<unsigned>(time % 86400);
+  char buffer[64];
+  snprintf(buffer, sizeof(buffer), "%04lld-%02u-%02u %02u:%02u:%02u",
+      static_cast<long long>(year), month, day, seconds / 3600, seconds / 60 % 60, seconds % 60);
+  return buffer;
+}
+
+bool comp_purchase_time(const purchase_info& purchase_1,
+    const purchase_info& purchase_2) {
+
+  // purchases reach the network in time order (out-of-order input is
+  // sorted by the reorder buffer first), so the purchase order is enough
+  std::size_t purchase1_order = purchase_1.tm_info.purchase_order;
+  std::size_t purchase2_order = purchase_2.tm_info.purchase_order;
+  return purchase1_order < purchase2_order;
+}
+
+void user_info::update_purchases(const uint64_t purchase_time,
     const std::size_t purchase_order,
     const double amount, const std::size_t T) {
 
-  // convert purchase time into C uint64_t type
-  uint64_t purchase_time = convert_string2timet(timestamp);
-
+  // purchases reach the user in time order (out-of-order input is sorted by
+  // the reorder buffer first), so the new purchase is always the most recent
   time_info purchase_time_info {purchase_time, purchase_order};
   purchase_info purchase_info {purchase_time_info, amount};
   recent_purchases_.push_front(purchase_info);
 
-//  // If purchases do not come in time order,
-//  // replace recent_purchases_.push_front(purchase_info) with the following codes
-//  if (recent_purchases_.empty() ||
-//      purchase_time >= recent_purchases_.front().tm_info.purchase_time) {
-//    // when the purchase is most recent, add it to the front of the record
-//    recent_purchases_.push_front(purchase_info);
-//
-//  } else if (purchase_time < recent_purchases_.back().tm_info.purchase_time) {
-//    // when the purchase is the oldest, add it to the back of the record
-//    recent_purchases_.push_front(purchase_info);
-//
-//  } else {
-//    // add the purchase in front of the one that has an equal or earlier time stamp
-//    for (auto iter = recent_purchases_.begin(); iter != recent_purchases_.end();
-//        ++iter) {
-//      if (purchase_time >= iter->time_info.purchase_time) {
-//        recent_purchases_.insert(iter, purchase_info);
-//        break;
-//      }
-//    } // end of for loop
-//  }
-
   // if the number of purchases is larger than T, remove the oldest purchase
   if (recent_purchases_.size() > T)
     recent_purchases_.pop_back();
 }
 
+std::size_t user_info::count_purchases_since(const uint64_t cutoff_time) const {
+  if (cutoff_time == 0)
+    return recent_purchases_.size();
+
+  // purchases are in time order, so the recent ones form a prefix
+  const auto iter_oldest = std::partition_point(recent_purchases_.begin(),
+      recent_purchases_.end(), [cutoff_time] (const purchase_info& purchase) {
+    return purchase.tm_info.purchase_time >= cutoff_time;
+  });
+  return iter_oldest - recent_purchases_.begin();
+}
+
+void user_info::remove_purchases_before(const uint64_t cutoff_time) {
+  // purchases are stored in time order, so the expired ones are at the back
+  while (!recent_purchases_.empty()
+      && recent_purchases_.back().tm_info.purchase_time < cutoff_time)
+    recent_purchases_.pop_back();
+}
+
+std::size_t user_info::release_purchases() {
+  const std::size_t n_purchases = recent_purchases_.size();
+  // clear() keeps the blocks, so swap with a new record in the same arena
+  purchase_record(recent_purchases_.get_allocator()).swap(recent_purchases_);
+  return n_purchases;
+}
+
+std::size_t user_info::friend_set_bytes() const {
+  // an empty set uses a bucket stored in the set object;
+  // every friend is a node holding the id and a link
+  const std::size_t bucket_bytes = friends_.bucket_count() > 1 ?
+      friends_.bucket_count() * sizeof(void*) : 0;
+  return bucket_bytes + friends_.size() * (sizeof(void*) + sizeof(user_id_t));
+}
+
+std::size_t user_info::purchase_record_bytes() const {
+  // a deque stores its purchases in 512-byte blocks and keeps an array of
+  // at least 8 pointers to the blocks; it allocates one block when it is
+  // created, and the first push_front adds another block before that one
+  const std::size_t per_block = sizeof(purchase_info) < 512 ? 512 / sizeof(purchase_info) : 1;
+  const std::size_t n_blocks = (recent_purchases_.size() + per_block - 1) / per_block + 1;
+  return n_blocks * per_block * sizeof(purchase_info)
+      + std::max<std::size_t>(8, n_blocks + 2) * sizeof(void*);
+}
@@ -11,6 +11,11 @@
 #include <deque>
 #include <unordered_set>
 #include <ctime>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <scoped_allocator>
+#include "pool_arena.h"
 #include "include/rapidjson/document.h"
 
 #ifndef USER_INFO_H_
@@ -18,9 +23,20 @@
 
 typedef std::size_t user_id_t;
 
+// function to convert a timestamp ("YYYY-MM-DD hh:mm:ss", UTC) to seconds since the epoch
+// input:  timestamp - time read from json file
+// return: the number of seconds since 1970-01-01 00:00:00
+uint64_t convert_string2timet(const std::string& timestamp);
+
+// function to convert seconds since the epoch to a timestamp ("YYYY-MM-DD hh:mm:ss", UTC)
+// input:  time - the number of seconds since 1970-01-01 00:00:00
+// return: the timestamp as written in the json files
+std::string convert_timet2string(const uint64_t time);
+
 // time_info stores the time information of a purchase:
 struct time_info {
-  // the time of a purchase (not necessary if purchases come in time order)
+  // the time of a purchase in seconds since the epoch
+  // (used by the time-window baseline; the order is enough otherwise)
   uint64_t purchase_time;
   // the order of a purchase when it is processed
   std::size_t purchase_order;
@@ -34,25 +50,92 @@ struct purchase_info {
   double amount;
 };
 
+// function to compare the time of two purchases
+// inputs: purchase_1 - purchase information of the first purchase
+//         purchase_2 - purchase information of the second purchase
+// return: true if the first purchase is made earlier than the second purchase
+//         false otherwise
+bool comp_purchase_time(const purchase_info& purchase_1,
+    const purchase_info& purchase_2);
+
+// function to merge purchases into a list of the most recent purchases,
+//          keeping at most limit purchases
+// inputs:  first, last - purchases to merge (most recent first)
+//          limit - the number of recent purchases to keep
+// output:  purchases - reference to the most recent purchases so far (most recent first)
+template <typename Iterator>
+void merge_recent_purchases(std::vector<purchase_info>& purchases,
+    const Iterator first, Iterator last, const std::size_t limit) {
+  // only the most recent `limit` purchases can stay in the list
+  if (static_cast<std::size_t>(last - first) > limit)
+    last = first + limit;
+  const std::size_t size_new_purchases = last - first;
+  if (size_new_purchases == 0)
+    return;
+
+  // resize purchases to be able to hold the previous and the new purchases,
+  // then merge them from the back using reverse iterators
+  purchases.resize(purchases.size() + size_new_purchases);
+  std::merge(purchases.rbegin() + size_new_purchases, purchases.rend(),
+      std::reverse_iterator<Iterator>(last), std::reverse_iterator<Iterator>(first),
+      purchases.rbegin(), comp_purchase_time);
+
+  // resize purchases
+  purchases.resize(std::min(limit, purchases.size()));
+}
+
+// friend_set stores the ids of a user's direct friends
+typedef std::unordered_set<user_id_t, std::hash<user_id_t>, std::equal_to<user_id_t>,
+    arena_allocator<user_id_t>> friend_set;
+
+// purchase_record stores a user's recent purchases (most recent first)
+typedef std::deque<purchase_info, arena_allocator<purchase_info>> purchase_record;
+
 // user_info class stores the user's direct friends (ids),
 // and all the purchases (time, order, and amount) made by the user
 class user_info {
   private:
-    std::unordered_set<user_id_t> friends_{};
-    std::deque<purchase_info> recent_purchases_{};
+    friend_set friends_{};
+    purchase_record recent_purchases_{};
 
   public:
+    // the containers of a user draw their memory from the allocator's arena;
+    // a user stored in a user_map gets the arena of the map
+    typedef arena_allocator<user_info> allocator_type;
+
     // default constructor
     user_info() = default;
 
+    // constructor with the allocator of the containers
+    explicit user_info(const allocator_type& alloc)
+        : friends_(friend_set::allocator_type(alloc)),
+          recent_purchases_(purchase_record::allocator_type(alloc)) {}
+
+    // copy constructor placing the containers in the allocator's arena
+    user_info(const user_info& other, const allocator_type& alloc)
+        : friends_(other.friends_, friend_set::allocator_type(alloc)),
+          recent_purchases_(other.recent_purchases_,
+              purchase_record::allocator_type(alloc)) {}
+
+    // move constructor placing the containers in the allocator's arena
+    user_info(user_info&& other, const allocator_type& alloc)
+        : friends_(std::move(other.friends_), friend_set::allocator_type(alloc)),
+          recent_purchases_(std::move(other.recent_purchases_),
+              purchase_record::allocator_type(alloc)) {}
+
+    user_info(const user_info&) = default;
+    user_info(user_info&&) = default;
+    user_info& operator=(const user_info&) = default;
+    user_info& operator=(user_info&&) = default;
+
     // function to get the ids of the user's direct friends
     // return: an unordered_set containing ids of all friends
-    const std::unordered_set<user_id_t>& get_friend_list() const {return friends_;}
+    const friend_set& get_friend_list() const {return friends_;}
 
     // function to get the most recent T purchases of the user
     // return: a deque containing the purchase information
     //         (purchase time, purchase order, and amount)
-    const std::deque<purchase_info>& get_purchase_record() const {return recent_purchases_;}
+    const purchase_record& get_purchase_record() const {return recent_purchases_;}
 
     // function to add a friend to a user's friend list
     // input: a friend id
@@ -64,12 +147,47 @@ class user_info {
 
     // function to add a recent purchase
     //         and remove the oldest one if the number of purchases is larger than T
-    // inputs: timestamp - purchase time read from json file
+    // inputs: purchase_time - purchase time in seconds since the epoch
     //         purchase_order - purchase order when the purchase is read from json file
     //         amount - purchase amount
     //         T - the number of the most recent purchases made in the user's network
-    void update_purchases(const std::string& timestamp, const std::size_t purchase_order,
+    void update_purchases(const uint64_t purchase_time, const std::size_t purchase_order,
         const double amount, const std::size_t T);
+
+    // function to count the purchases made at or after a time
+    // input:  cutoff_time - the earliest purchase time to count (0 counts all)
+    // return: the number of purchases at the front of the record made at or after cutoff_time
+    std::size_t count_purchases_since(const uint64_t cutoff_time) const;
+
+    // function to remove the purchases made before a time
+    // input: cutoff_time - purchases with an earlier time are removed
+    void remove_purchases_before(const uint64_t cutoff_time);
+
+    // function to remove all purchases and release the memory of the record
+    // return: the number of purchases removed
+    std::size_t release_purchases();
+
+    // function to estimate the bytes held by the friend set
+    // (bucket array and nodes, excluding the set object itself)
+    std::size_t friend_set_bytes() const;
+
+    // function to estimate the bytes held by the purchase record
+    // (blocks and block map, excluding the deque object itself)
+    std::size_t purchase_record_bytes() const;
 };
 
+// user_map stores all users by id; the map passes its allocator to the users,
+// so the nodes and every user's containers come from the same arena
+typedef std::unordered_map<user_id_t, user_info, std::hash<user_id_t>,
+    std::equal_to<user_id_t>, std::scoped_allocator_adaptor<
+    arena_allocator<std::pair<const user_id_t, user_info>>>> user_map;
+
+// function to obtain the allocator of a user_map drawing from an arena
+// input:  arena - the arena, nullptr to use operator new
+// return: the allocator
+inline user_map::allocator_type user_map_allocator(pool_arena* arena) {
+  return user_map::allocator_type(
+      arena_allocator<std::pair<const user_id_t, user_info>>(arena));
+}
+
 #endif /* USER_INFO_H_ */
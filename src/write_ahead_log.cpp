@@ -0,0 +1,182 @@
+/*
+ * write_ahead_log.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#include <iostream>
+#include <cstddef>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include "write_ahead_log.h"
+
+using namespace std;
+
+// function to write a whole buffer to a file, exiting if the log cannot be written
+// inputs: fd - file descriptor
+//         data, size - the buffer
+static void write_all(const int fd, const char* data, size_t size) {
+  while (size > 0) {
+    const ssize_t written = write(fd, data, size);
+    if (written < 0) {
+      if (errno == EINTR)
+        continue;
+      // continuing would apply events that a restart cannot recover
+      cerr << "Error: write-ahead log write failed: " << strerror(errno) << endl;
+      exit(EXIT_FAILURE);
+    }
+    data += written;
+    size -= written;
+  }
+}
+
+write_ahead_log::~write_ahead_log() {
+  if (fd_ >= 0) {
+    commit();
+    close(fd_);
+  }
+}
+
+uint32_t write_ahead_log::checksum(const record& r) {
+  // FNV-1a over the bytes before the checksum field
+  const unsigned char* p = reinterpret_cast<const unsigned char*>(&r);
+  uint32_t hash = 2166136261u;
+  for (size_t i = 0; i < offsetof(record, checksum); ++i) {
+    hash ^= p[i];
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+bool write_ahead_log::read_record(istream& in, const uint64_t expected_sequence,
+    record& r) {
+  if (!in.read(reinterpret_cast<char*>(&r), sizeof(r)))
+    return false;
+  return r.checksum == checksum(r)
+      && (expected_sequence == 0 || r.sequence == expected_sequence)
+      && r.kind <= static_cast<uint32_t>(event_kind::unfriend);
+}
+
+bool write_ahead_log::open(const string& fname, const bool keep_records,
+    const size_t group_size, const wal_sync sync, const uint64_t sync_interval_ms) {
+  group_size_ = group_size > 0 ? group_size : 1;
+  sync_ = sync;
+  sync_interval_ = chrono::milliseconds(sync_interval_ms);
+  fname_ = fname;
+  pending_.reserve(group_size_);
+
+  // find the end of the valid records; a torn record left by a crash is cut off
+  off_t valid_bytes = 0;
+  if (keep_records) {
+    ifstream in(fname, ios::binary);
+    record r;
+    uint64_t expected_sequence = 0;
+    while (read_record(in, expected_sequence, r)) {
+      last_sequence_ = r.sequence;
+      expected_sequence = r.sequence + 1;
+      valid_bytes += sizeof(r);
+    }
+  }
+
+  fd_ = ::open(fname.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+  if (fd_ < 0)
+    return false;
+  if (ftruncate(fd_, valid_bytes) != 0) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  last_sync_ = chrono::steady_clock::now();
+  return true;
+}
+
+void write_ahead_log::append(const event& e, const uint64_t stream_offset) {
+  record r;
+  // zero the padding, so the checksum covers defined bytes only
+  memset(&r, 0, sizeof(r));
+  r.sequence = ++last_sequence_;
+  r.time = e.time;
+  r.id1 = e.id1;
+  r.id2 = e.id2;
+  r.amount = e.amount;
+  r.stream_offset = stream_offset;
+  r.kind = static_cast<uint32_t>(e.kind);
+  r.checksum = checksum(r);
+  pending_.push_back(r);
+  ++records_;
+
+  if (pending_.size() >= group_size_)
+    commit();
+}
+
+void write_ahead_log::commit() {
+  if (pending_.empty())
+    return;
+
+  const auto start_time = chrono::steady_clock::now();
+  write_all(fd_, reinterpret_cast<const char*>(pending_.data()),
+      pending_.size() * sizeof(record));
+  pending_.clear();
+  ++commits_;
+
+  if (sync_ == wal_sync::commit
+      || (sync_ == wal_sync::periodic && start_time - last_sync_ >= sync_interval_)) {
+    if (fdatasync(fd_) != 0) {
+      cerr << "Error: write-ahead log sync failed: " << strerror(errno) << endl;
+      exit(EXIT_FAILURE);
+    }
+    last_sync_ = chrono::steady_clock::now();
+    ++syncs_;
+  }
+  commit_seconds_ += chrono::duration<double>(
+      chrono::steady_clock::now() - start_time).count();
+}
+
+void write_ahead_log::truncate() {
+  commit();
+  if (ftruncate(fd_, 0) != 0)
+    cerr << "Error: write-ahead log truncation failed: " << strerror(errno) << endl;
+}
+
+void write_ahead_log::truncate_through(const uint64_t sequence) {
+  commit();
+
+  // copy the records after the sequence number to a new log
+  const string fname_tmp = fname_ + ".tmp";
+  const int fd = ::open(fname_tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+  if (fd < 0) {
+    cerr << "Error: write-ahead log truncation failed: " << strerror(errno) << endl;
+    return;
+  }
+  ifstream in(fname_, ios::binary);
+  vector<record> kept;
+  record r;
+  while (read_record(in, 0, r)) {
+    if (r.sequence > sequence)
+      kept.push_back(r);
+  }
+  write_all(fd, reinterpret_cast<const char*>(kept.data()), kept.size() * sizeof(record));
+
+  // the kept records must be durable before they replace the log
+  if ((sync_ != wal_sync::never && fdatasync(fd) != 0)
+      || rename(fname_tmp.c_str(), fname_.c_str()) != 0) {
+    cerr << "Error: write-ahead log truncation failed: " << strerror(errno) << endl;
+    close(fd);
+    remove(fname_tmp.c_str());
+    return;
+  }
+  close(fd_);
+  fd_ = fd;
+}
+
+void write_ahead_log::print_stats(ostream& out) const {
+  out << "wal records: " << records_ << "\n"
+      << "wal group commits: " << commits_ << "\n"
+      << "wal syncs: " << syncs_ << "\n"
+      << "wal commit seconds: " << commit_seconds_ << "\n";
+}
@@ -0,0 +1,163 @@
+/*
+ * write_ahead_log.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: jinmei
+ */
+
+#ifndef WRITE_AHEAD_LOG_H_
+#define WRITE_AHEAD_LOG_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <fstream>
+#include <iosfwd>
+#include "event.h"
+
+// wal_sync chooses when the log is forced to disk with fdatasync
+enum class wal_sync {
+  never,     // left to the OS: survives a crash of the process, not of the machine
+  commit,    // after every group commit
+  periodic   // after a group commit, at most once per sync interval
+};
+
+// write_ahead_log appends the stream events applied to the network to a file,
+// so a restarted process can load the latest snapshot and apply only the
+// events logged after it. Records are buffered and written together (group
+// commit); a crash loses at most the events of the unwritten group.
+// Each record carries a sequence number and a checksum, so a torn record at
+// the end of the file is detected and dropped.
+class write_ahead_log {
+  private:
+    // record is one event as written to the file
+    struct record {
+      uint64_t sequence;
+      uint64_t time;
+      uint64_t id1;
+      uint64_t id2;
+      double amount;
+      // byte offset of the stream log after the event
+      uint64_t stream_offset;
+      uint32_t kind;
+      uint32_t checksum;
+    };
+
+    int fd_ = -1;
+    std::string fname_{};
+    // the number of records written together
+    std::size_t group_size_ = 1;
+    wal_sync sync_ = wal_sync::commit;
+    std::chrono::steady_clock::duration sync_interval_{};
+    std::chrono::steady_clock::time_point last_sync_{};
+    // records waiting for the next group commit
+    std::vector<record> pending_{};
+    // sequence number of the last record appended
+    uint64_t last_sequence_ = 0;
+
+    // counters
+    std::size_t records_ = 0;
+    std::size_t commits_ = 0;
+    std::size_t syncs_ = 0;
+    double commit_seconds_ = 0.0;
+
+    // function to compute the checksum of a record (all fields before checksum)
+    static uint32_t checksum(const record& r);
+
+    // function to read the next valid record of a log
+    // inputs:  in - the log, positioned at a record
+    //          expected_sequence - sequence number of the record (0 accepts any)
+    // outputs: r - reference to the record
+    // return:  true if a complete record with a valid checksum and the expected
+    //          sequence number was read
+    static bool read_record(std::istream& in, const uint64_t expected_sequence, record& r);
+
+  public:
+    write_ahead_log() = default;
+    // destructor: commits the pending records
+    ~write_ahead_log();
+
+    write_ahead_log(const write_ahead_log&) = delete;
+    write_ahead_log& operator=(const write_ahead_log&) = delete;
+
+    // function to open the log for appending
+    // inputs: fname - name of the log file
+    //         keep_records - true to keep the valid records of an existing log
+    //                        (a torn record at the end is cut off), false to empty it
+    //         group_size - the number of records written together
+    //         sync - when the log is forced to disk
+    //         sync_interval_ms - minimum milliseconds between two periodic syncs
+    // return: true if the log is opened
+    bool open(const std::string& fname, const bool keep_records, const std::size_t group_size,
+        const wal_sync sync, const uint64_t sync_interval_ms);
+
+    // function to append an event, committing the group when it is full
+    // inputs: e - the event
+    //         stream_offset - byte offset of the stream log after the event
+    void append(const event& e, const uint64_t stream_offset);
+
+    // function to write the pending records and sync them as the policy requires
+    void commit();
+
+    // function to remove all records once a snapshot holds their effect;
+    //          the sequence numbers continue
+    void truncate();
+
+    // function to remove the records up to a sequence number once a snapshot
+    //          holds their effect, keeping the later ones; the log is rewritten
+    //          under a temporary name and renamed
+    // input:   sequence - sequence number of the last record to remove
+    void truncate_through(const uint64_t sequence);
+
+    // function to make the next record follow a sequence number
+    //          (e.g. of a snapshot taken after the log was truncated)
+    // input: sequence - a sequence number
+    void skip_to(const uint64_t sequence) {
+      if (last_sequence_ < sequence)
+        last_sequence_ = sequence;
+    }
+
+    // function to obtain the sequence number of the last appended record
+    uint64_t last_sequence() const {return last_sequence_;}
+
+    // function to read the events of a log
+    // inputs: fname - name of the log file
+    //         after_sequence - only the records with a larger sequence number are read
+    //         f - function called with every event and the stream offset after it,
+    //             in order
+    // return: the number of events read
+    template <typename F>
+    static std::size_t replay(const std::string& fname, const uint64_t after_sequence, F f);
+
+    // function to write the counters of the log to a stream
+    // input: out - output stream
+    void print_stats(std::ostream& out) const;
+};
+
+template <typename F>
+std::size_t write_ahead_log::replay(const std::string& fname,
+    const uint64_t after_sequence, F f) {
+  std::ifstream in(fname, std::ios::binary);
+  std::size_t n_events = 0;
+  record r;
+  // the first record may have any sequence number (the log may have been truncated)
+  uint64_t expected_sequence = 0;
+  while (read_record(in, expected_sequence, r)) {
+    expected_sequence = r.sequence + 1;
+    if (r.sequence <= after_sequence)
+      continue;
+
+    event e;
+    e.kind = static_cast<event_kind>(r.kind);
+    e.time = r.time;
+    e.id1 = r.id1;
+    e.id2 = r.id2;
+    e.amount = r.amount;
+    f(e, r.stream_offset);
+    ++n_events;
+  }
+  return n_events;
+}
+
+#endif /* WRITE_AHEAD_LOG_H_ */